@@ -2,70 +2,135 @@
 #define AGENTMONITOR_H
 
 #include <map>
+#include <set>
 #include <string>
 
-#include "toaster-lib/TRBuffer.h"
 #include "toaster-lib/Entity.h"
 #include "toaster-lib/Human.h"
 #include "toaster-lib/Robot.h"
 #include "toaster-lib/Object.h"
 
 #include "toaster_msgs/FactList.h"
+#include "toaster_msgs/EntityReader.h"
 
 #include "AgentManager.h"
+#include "EntityHistory.h"
+#include "MotionKernel.h"
 
 class AgentMonitor
 {
 public:
+  AgentMonitor();
+
   void init(ros::NodeHandle* node);
 
-  void setHumanMap(const std::map<std::string, Human*>& map) { humansMap_ = map; }
-  void setRobotMap(const std::map<std::string, Robot*>& map) { robotsMap_ = map; }
-  void setObjectMap(const std::map<std::string, Object*>& map) { objectsMap_ = map; }
+  // Entities are read from the readers maps, they are updated in place by the readers
+  void setHumanReader(const EntityReader<Human>& reader) { humansReader_ = &reader; humansMap_ = &reader.lastConfig_; }
+  void setRobotReader(const EntityReader<Robot>& reader) { robotsReader_ = &reader; robotsMap_ = &reader.lastConfig_; }
+  void setObjectReader(const EntityReader<Object>& reader) { objectsReader_ = &reader; objectsMap_ = &reader.lastConfig_; }
 
 public:
 
-  // Map of Timed Ring Buffer Entities
-  std::map<std::string, TRBuffer < Entity* > > mapTRBEntity_;
+  // Pose history of each entity
+  std::map<std::string, EntityHistory> mapEntityHistory_;
+  unsigned int historySize_;
+
+  // Noise of the motion filters of all histories
+  MotionNoise_t motionNoise_;
+
+  // Head joint of the agents, by agent id, LookingFact::DEFAULT_HEAD_JOINT for the others
+  std::map<std::string, std::string> headJoints_;
 
-  std::map<std::string, Human*> humansMap_;
-  std::map<std::string, Robot*> robotsMap_;
-  std::map<std::string, Object*> objectsMap_;
+  const std::map<std::string, Human*>* humansMap_;
+  const std::map<std::string, Robot*>* robotsMap_;
+  const std::map<std::string, Object*>* objectsMap_;
+
+  // Entities whose time did not change for this duration (s) are not present, 0 if they always are
+  double presenceTimeout_;
 
   AgentManager agentsManager_;
   std::vector<std::string> agentsMonitored_;
   std::map<std::string, std::vector<std::string> > mapAgentToJointsMonitored_;
+  // Slots of the monitored joints in the agent history, resolved once per agent
+  std::map<std::string, std::vector<std::pair<std::string, int> > > mapAgentToJointSlots_;
 
   void updateMonitored();
   void updateUnmonitoredEntitieTRBuffer();
   bool updateAgentTRBuffer(Agent* agent);
 
+  // Agent id if it is present, nullptr for objects and agents not present
   Agent* getMonitoredAgent(const std::string id);
 
-  void computeLookingFacts(Agent* agent, double lookTwdDeltaDist_, double lookTwdAngularAperture_, toaster_msgs::FactList& factList_msg);
+  void computeLookingFacts(Agent* agent, const MotionKernel& kernel, double lookTwdDeltaDist_, double lookTwdAngularAperture_,
+                           double lookOccluderRadius_, toaster_msgs::FactList& factList_msg);
+
+  // Histories of the entities not present are dropped, they start again when the entities come back
+  template<typename T>
+  void updateUnmonitoredEntitieTRBuffer(const EntityReader<T>* reader)
+  {
+    if (reader == NULL)
+      return;
+
+    for (auto it = reader->lastConfig_.begin(); it != reader->lastConfig_.end(); ++it)
+      if (!isPresent(*reader, it->first))
+        forget(it->first);
+      else if (std::find(agentsMonitored_.begin(), agentsMonitored_.end(), it->first) == agentsMonitored_.end())
+        pushHistory(it->first, it->second, getSkeleton(it->second));
+  }
+private:
+  template<typename T>
+  bool isPresent(const EntityReader<T>& reader, const std::string& id) const
+  {
+    return presenceTimeout_ <= 0.0 || reader.isPresent(id, presenceTimeout_);
+  }
 
+  // Monitors the present agents of reader, and stops monitoring the agents
+  // it monitored this way which are not present anymore
   template<typename T>
-  void updateUnmonitoredEntitieTRBuffer(const std::map<std::string, T*>& entity_map)
+  void monitorPresent(const EntityReader<T>& reader)
   {
-    for (auto it = entity_map.begin(); it != entity_map.end(); ++it)
+    for (auto it = reader.lastConfig_.begin(); it != reader.lastConfig_.end(); ++it)
     {
-      if (std::find(agentsMonitored_.begin(), agentsMonitored_.end(), it->first) == agentsMonitored_.end())
+      if (it->second->getId() == "")
+        continue;
+
+      bool monitored = std::find(agentsMonitored_.begin(), agentsMonitored_.end(), it->first) != agentsMonitored_.end();
+      if (isPresent(reader, it->first))
       {
-        std::map<std::string, TRBuffer < Entity* > >::iterator itTRB = mapTRBEntity_.find(it->first);
-        T* ent = it->second;
-
-        if(itTRB == mapTRBEntity_.end()) // If 1st data
-        {
-          TRBuffer<Entity*> buff;
-          buff.push_back(ent->getTime(), ent);
-          mapTRBEntity_[it->first] = buff;
-        }
-        else if(mapTRBEntity_[it->first].back()->getTime() < it->second->getTime())
-          mapTRBEntity_[it->first].push_back(ent->getTime(), ent);
+        if (!monitored && agentsManager_.addMonitoredAgent(it->first))
+          autoMonitored_.insert(it->first);
       }
+      else if (monitored && autoMonitored_.erase(it->first) > 0)
+        agentsManager_.removeMonitoredAgent(it->first);
     }
   }
-private:
+
+  // Drops the history of entity id
+  void forget(const std::string& id);
+
+  const EntityReader<Human>* humansReader_;
+  const EntityReader<Robot>* robotsReader_;
+  const EntityReader<Object>* objectsReader_;
+
+  // Set by the monitor all services, agents are then monitored while they are present
+  bool monitorAllHumans_;
+  bool monitorAllRobots_;
+  std::set<std::string> autoMonitored_;
+
+  // Registers the monitored joints of agent in its history
+  void resolveJointSlots(const std::string& agentId, EntityHistory& history);
+
+  // Reports the monitored joints missing from the last configuration of agent
+  void checkMissingJoints(const std::string& agentId, const EntityHistory& history);
+
+  // Monitored joints currently missing, by agent id
+  std::map<std::string, std::set<std::string> > missingJoints_;
+
+  // Takes a snapshot of entity, returns false if this is not a new data
+  bool pushHistory(const std::string& id, Entity* entity, const std::map<std::string, Joint*>* skeleton);
+
+  static const std::map<std::string, Joint*>* getSkeleton(Agent* agent) { return &agent->skeleton_; }
+  static const std::map<std::string, Joint*>* getSkeleton(Entity* entity) { return NULL; }
 };
 
 #endif // AGENTMONITOR_H
@@ -0,0 +1,19 @@
+#ifndef AGENTMONITORNODE_H
+#define AGENTMONITORNODE_H
+
+#include <ros/ros.h>
+
+namespace agent_monitor
+{
+
+/**
+ * Loop of agent_monitor, run by the agent_monitor executable and by the
+ * agent_monitor/AgentMonitorNodelet nodelet. Computes the facts of the monitored
+ * agents until node is shut down. Callbacks run on the queue of node,
+ * privateNode holds the dynamic parameters.
+ */
+int run(ros::NodeHandle& node, ros::NodeHandle& privateNode);
+
+} // namespace agent_monitor
+
+#endif // AGENTMONITORNODE_H
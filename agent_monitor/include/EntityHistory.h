@@ -0,0 +1,112 @@
+#ifndef ENTITYHISTORY_H
+#define ENTITYHISTORY_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "toaster-lib/Entity.h"
+#include "toaster-lib/Joint.h"
+
+#include "MotionFilter.h"
+
+// Copy of an entity pose at a given time
+struct PoseSnapshot_t
+{
+  double position[3];
+  double orientation[3]; // roll, pitch, yaw
+  bool valid; // false when a joint was not received with this sample
+};
+
+/**
+ * Timed ring buffer of pose snapshots.
+ * Unlike TRBuffer<Entity*>, the history owns copies of the poses, so it is not
+ * affected by the readers updating their entities in place.
+ * Samples are stored in contiguous preallocated arrays: one time per sample and,
+ * for each sample, the body pose followed by one pose per joint slot.
+ * A joint gets a slot the first time it is received, or when it is registered,
+ * so that lagged lookups of monitored joints are array indexing.
+ * The body and each joint slot also have a motion filter, updated with each sample.
+ */
+class EntityHistory
+{
+public:
+  static const unsigned int DEFAULT_CAPACITY = 300;
+
+  // Slot of the body in getPose
+  static const int BODY_SLOT = -1;
+
+  // noise is read at each sample, default noise is used if NULL
+  EntityHistory(unsigned int capacity = DEFAULT_CAPACITY, const MotionNoise_t* noise = NULL);
+
+  static const MotionNoise_t DEFAULT_NOISE;
+
+  /**
+   * @brief Adds a snapshot of entity and of its skeleton if not NULL.
+   *        The oldest sample is overwritten when the buffer is full.
+   * @return false if entity is not newer than the last sample
+   */
+  bool push_back(Entity* entity, const std::map<std::string, Joint*>* skeleton = NULL);
+
+  unsigned int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  unsigned int capacity() const { return capacity_; }
+
+  // Index 0 is the oldest sample and size() - 1 the newest
+  unsigned long getTimeFromIndex(unsigned int index) const { return times_[physicalIndex(index)]; }
+  const PoseSnapshot_t& getBodyFromIndex(unsigned int index) const { return poses_[physicalIndex(index) * stride_]; }
+  const PoseSnapshot_t& getJointFromIndex(unsigned int index, int slot) const { return poses_[physicalIndex(index) * stride_ + 1 + slot]; }
+
+  unsigned long backTime() const { return getTimeFromIndex(size_ - 1); }
+  const PoseSnapshot_t& back() const { return getBodyFromIndex(size_ - 1); }
+
+  // Binary search of the first sample taken at or after time, -1 if none
+  int getIndexAfter(unsigned long time) const;
+
+  // Slot of a joint, -1 if it was never received nor registered
+  int getJointSlot(const std::string& jointName) const;
+
+  // Slot of a joint, assigned now if the joint was never received
+  int registerJoint(const std::string& jointName);
+
+  /**
+   * @brief Body pose (jointName == "") or joint pose at index
+   * @return NULL if the joint was not received with this sample
+   */
+  const PoseSnapshot_t* getPose(unsigned int index, const std::string& jointName) const;
+
+  // Motion filter of the body (slot == BODY_SLOT) or of a joint
+  const MotionFilter& getFilter(int slot) const { return filters_[1 + slot]; }
+
+  /**
+   * @brief Body pose (slot == BODY_SLOT) or joint pose at index
+   * @return NULL if the joint was not received with this sample
+   */
+  const PoseSnapshot_t* getPose(unsigned int index, int slot) const
+  {
+    if (slot == BODY_SLOT)
+      return &getBodyFromIndex(index);
+
+    const PoseSnapshot_t& joint = getJointFromIndex(index, slot);
+    return joint.valid ? &joint : NULL;
+  }
+
+private:
+  unsigned int physicalIndex(unsigned int index) const { return (head_ + index) % capacity_; }
+  int addJointSlot(const std::string& jointName);
+  static void fillSnapshot(Entity* entity, PoseSnapshot_t& snapshot);
+
+  unsigned int capacity_;
+  unsigned int head_; // physical index of the oldest sample
+  unsigned int size_;
+  unsigned int stride_; // 1 + number of joint slots
+
+  std::vector<unsigned long> times_;
+  std::vector<PoseSnapshot_t> poses_;
+  std::map<std::string, int> jointSlots_;
+
+  const MotionNoise_t* noise_;
+  std::vector<MotionFilter> filters_; // body then joint slots
+};
+
+#endif // ENTITYHISTORY_H
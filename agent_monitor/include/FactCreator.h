@@ -1,7 +1,7 @@
 #include "toaster_msgs/Fact.h"
 #include "toaster-lib/Joint.h"
-#include "toaster-lib/Entity.h"
-#include "toaster-lib/TRBuffer.h"
+
+#include "EntityHistory.h"
 
 #include <map>
 #include <vector>
@@ -13,7 +13,7 @@ class FactCreator
 {
 public:
   static toaster_msgs::Fact setFactBase(Joint* joint);
-  static toaster_msgs::Fact setFactBase(string agent, map<string, TRBuffer < Entity* > >& mapTRBEntity);
+  static toaster_msgs::Fact setFactBase(const string& agent, const map<string, EntityHistory>& mapEntityHistory);
 
   static toaster_msgs::Fact setMotionFact(toaster_msgs::Fact baseFact, double speed, double max_speed, const std::string& type = "agent");
   static toaster_msgs::Fact setDirectionFact(toaster_msgs::Fact baseFact, string target, double confidence);
@@ -0,0 +1,45 @@
+#ifndef FACTSCHEDULER_H
+#define FACTSCHEDULER_H
+
+#include <vector>
+
+// Families of facts computed by agent_monitor, each one has its own rate
+enum FactFamily_t
+{
+  LOOKING_FACTS = 0,  // IsLookingToward, IsLookingAt
+  MOTION_FACTS,       // IsMoving of bodies and joints
+  TOWARD_FACTS,       // IsMovingToward and delta distances
+  DISTANCE_FACTS,     // Distance of joints
+  NB_FACT_FAMILIES
+};
+
+/**
+ * Decides each loop which fact families are computed.
+ * A family is due once its period elapsed, and a due family makes its
+ * dependencies due as well, so that it is computed from fresh data.
+ * Facts of the other families are carried forward from their last computation.
+ */
+class FactScheduler
+{
+public:
+  FactScheduler();
+
+  // Rate in Hz of family, 0 to compute it each loop
+  void setRate(FactFamily_t family, double rate);
+
+  // dependency is computed each time family is
+  void addDependency(FactFamily_t family, FactFamily_t dependency);
+
+  // Decides the families due at time now, in seconds
+  void update(double now);
+
+  bool isDue(FactFamily_t family) const { return due_[family]; }
+
+private:
+  double period_[NB_FACT_FAMILIES];
+  double lastRun_[NB_FACT_FAMILIES];
+  bool due_[NB_FACT_FAMILIES];
+  std::vector<FactFamily_t> dependencies_[NB_FACT_FAMILIES];
+};
+
+#endif // FACTSCHEDULER_H
@@ -1,36 +1,72 @@
+#ifndef LOOKINGFACT_H
+#define LOOKINGFACT_H
+
 #include <map>
 #include <string>
+#include <vector>
 
-#include "toaster-lib/TRBuffer.h"
-#include "toaster-lib/Entity.h"
 #include "toaster_msgs/FactList.h"
 
+#include "EntityHistory.h"
+#include "MotionKernel.h"
+
 using namespace std;
 
+// Apex and unit axis of the cone of visual attention of an agent
+struct LookingHead_t
+{
+  double position[3];
+  double axis[3];
+};
+
 class LookingFact
 {
 public:
+  // Head joint of the agents missing from the head joint map
+  static const string DEFAULT_HEAD_JOINT;
+
+  static const string& getHeadJoint(const map<string, string>& headJoints, const string& entityId);
+
+  /**
+   * @brief Computes the cone apex and axis from the head joint of an agent,
+   *        to be shared by all the cones of this agent
+   * @return false if the head joint is not in the last configuration
+   */
+  static bool computeHead(const EntityHistory& history, const string& headJoint, LookingHead_t& head);
+
   /**
    * @brief This function compute the map required by the fact "IsLookingToward"
-   *        by testing if an entity is lying in the 3D cone of agent visual attention
-   * @param Entity map containing all entity involved in the joint action & their
+   *        by testing if an entity is lying in the 3D cone of agent visual attention.
+   *        Agents are tested with their head joint when they have one, other
+   *        entities with their body.
+   * @param Head of the monitored agent, from computeHead
+   * @param Entity histories containing all entity involved in the joint action & their
    *        respective ids
+   * @param Kernel of the loop, only its targets close to the agent head are tested
    * @param Monitored agent id
+   * @param Head joint of the agents, by agent id
    * @param Distance between center of basement circle and agent head position
    * @param Angular aperture of the cone in radians
+   * @param Radius of the sphere hiding what is behind each entity, 0 to ignore occlusions
    * @return Map required by the fact "IsLookingToward" containing all entities
    *         lying in the cone and all normalized angles beetween entities and cone axis
    */
-  static map<string, double> compute(map<string, TRBuffer < Entity* > > mapEnts,
-                                      string agentMonitored, double deltaDist,
-                                      double angularAperture);
+  static map<string, double> compute(const LookingHead_t& head,
+                                     const map<string, EntityHistory>& mapEnts,
+                                     const MotionKernel& kernel,
+                                     const string& agentMonitored,
+                                     const map<string, string>& headJoints,
+                                     double deltaDist, double angularAperture,
+                                     double occluderRadius);
 
-  static void createTowardFact(map<string, double> mapIdValue, toaster_msgs::FactList &factList_msg,
-                                double angle, string subjectId, Entity* entity);
+  static void createTowardFact(const map<string, double>& mapIdValue, toaster_msgs::FactList &factList_msg,
+                                double angle, const string& subjectId, unsigned long time);
 
-  static void createAtFact(map<string, double> mapIdValue, toaster_msgs::FactList &factList_msg,
-                          double angle, string subjectId, Entity* entity);
+  static void createAtFact(const map<string, double>& mapIdValue, toaster_msgs::FactList &factList_msg,
+                          double angle, const string& subjectId, unsigned long time);
 
-  static void createFact(map<string, double> mapIdValue, toaster_msgs::FactList &factList_msg,
-                        double angle, string subjectId, Entity* entity, string property);
+  static void createFact(const map<string, double>& mapIdValue, toaster_msgs::FactList &factList_msg,
+                        double angle, const string& subjectId, unsigned long time, const string& property);
 };
+
+#endif // LOOKINGFACT_H
@@ -1,31 +1,22 @@
-#include <string>
-#include <map>
+#ifndef MOTION2D_H
+#define MOTION2D_H
 
-#include "toaster-lib/TRBuffer.h"
-#include "toaster-lib/Entity.h"
+#include "EntityHistory.h"
 
 using namespace std;
 
 class Motion2D
 {
 public:
-  static map<string, double> computeToward(map<string, TRBuffer < Entity* > > mapEnts,
-                                          string agentMonitored,
-                                          double towardAngle, double angleThreshold,
-                                          string jointName = "");
+  /**
+   * @brief Confidence that target lies in the direction angle seen from subject,
+   *        same as MathFunctions::isInAngle but on snapshots
+   * @return (angleThreshold - deviation) / angleThreshold, 0 if target is out of the threshold
+   */
+  static double isInAngle(const PoseSnapshot_t& subject, const PoseSnapshot_t& target,
+                          double angle, double angleThreshold, double& deviation);
 
-  /*Compute Motion angle for agents (jointName == "") or joints (jointName != "")*/
-  static double computeDirection(TRBuffer< Entity* > confBuffer, unsigned long timelapse,
-                                string jointName = "");
-
-  /*Compute Motion speed for agents (jointName == "") or joints (jointName != "")*/
-  static double compute(TRBuffer< Entity* > confBuffer, unsigned long timelapse,
-                        string jointName = "");
-
-  /*Compute if is moving for agents (jointName == "") or joints (jointName != "")*/
-  static bool computeIsMoving(TRBuffer< Entity* > confBuffer, unsigned long timelapse,
-                              double distanceThreshold, string jointName = "");
-
-private:
-  static Entity* getEntityOrJoint(Entity* entity, string jointName);
+  static double distance2D(const PoseSnapshot_t& first, const PoseSnapshot_t& second);
 };
+
+#endif // MOTION2D_H
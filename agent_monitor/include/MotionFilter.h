@@ -0,0 +1,61 @@
+#ifndef MOTIONFILTER_H
+#define MOTIONFILTER_H
+
+// Noise of the motion filters, shared by the histories
+struct MotionNoise_t
+{
+  double bodyAcceleration;  // standard deviation of the body acceleration, in m/s^2
+  double jointAcceleration; // standard deviation of the joint acceleration, in m/s^2
+  double position;          // standard deviation of the perceived positions, in m
+};
+
+/**
+ * Constant velocity Kalman filter of a 2D position.
+ * x and y are filtered independently, with the same noise and the same
+ * sample times, so they share the covariance.
+ * The filter is updated with each new sample and gives the speed and the
+ * heading without going back in the history.
+ */
+class MotionFilter
+{
+public:
+  // A gap longer than this restarts the filter, in ns
+  static const unsigned long RESET_TIME = 1000000000UL;
+
+  MotionFilter();
+
+  void update(unsigned long time, double x, double y, double accelerationNoise, double positionNoise);
+
+  // Speed and heading need two samples
+  bool hasVelocity() const { return nbUpdates_ > 1; }
+
+  double getX() const { return x_; }
+  double getY() const { return y_; }
+  double getVx() const { return vx_; }
+  double getVy() const { return vy_; }
+
+  // Speed in m/s, 0 until hasVelocity()
+  double getSpeed() const;
+
+  // Heading in rad, in ]-pi, pi]
+  double getHeading() const;
+
+  // Standard deviation of the position predicted dt seconds after the last sample, in m
+  double getPredictedStdDev(double dt, double accelerationNoise) const;
+
+private:
+  unsigned long time_;
+  unsigned int nbUpdates_; // up to 2
+
+  double x_;
+  double y_;
+  double vx_;
+  double vy_;
+
+  // Covariance of (position, velocity) on each axis
+  double pPos_;
+  double pPosVel_;
+  double pVel_;
+};
+
+#endif // MOTIONFILTER_H
@@ -0,0 +1,107 @@
+#ifndef MOTIONKERNEL_H
+#define MOTIONKERNEL_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "EntityHistory.h"
+#include "SpatialGrid.h"
+
+/**
+ * Computes the motion relations of all monitored bodies and joints at once.
+ * Each loop, the current position of every entity (the targets) and the current
+ * and past positions of the monitored bodies and joints (the subjects) are
+ * gathered in arrays. Distances, delta distances and alignment with the motion
+ * direction are then computed for the targets close to each subject in loops
+ * without lookups nor branches, which the compiler can vectorize. acos is only
+ * computed for the targets found in the motion direction.
+ * Targets are found with a grid rebuilt each loop: a subject has a relation with
+ * each target closer than the radius given to setTargets.
+ */
+class MotionKernel
+{
+public:
+  MotionKernel() : radius_(0.0) {}
+
+  // Gathers the current body position of each entity, relations are limited to radius (no limit if 0)
+  void setTargets(const std::map<std::string, EntityHistory>& mapEnts, double radius);
+
+  /**
+   * @brief Gathers the positions of the body (slot == EntityHistory::BODY_SLOT) or of a joint of entityId.
+   *        Speed and motion direction are given by the motion filter of the history.
+   * @param deltaDistTime timelapse used to compute the delta distances
+   * @param angleThreshold maximum angle between the motion direction and a target
+   * @return index of the subject, -1 if there is no data for this body or joint
+   */
+  int addSubject(const std::string& entityId, const EntityHistory& history, int slot,
+                 unsigned long deltaDistTime, double angleThreshold);
+
+  void clearSubjects();
+
+  // Computes the relations of each subject, to call once subjects are added
+  void compute();
+
+  unsigned int getNbTargets() const { return targetIds_.size(); }
+  const std::string& getTargetId(unsigned int target) const { return targetIds_[target]; }
+
+  // Targets closer than radius to (x, y) in 2D, in the order of their ids
+  void getNeighbours(double x, double y, double radius, std::vector<unsigned int>& targets) const { grid_.query(x, y, radius, targets); }
+
+  // Index of the subject entity in the targets, -1 if it is not a target
+  int getSelfTarget(int subject) const { return selfTarget_[subject]; }
+
+  // Filtered speed in m/s
+  double getSpeed(int subject) const { return speed_[subject]; }
+
+  // Relations of a subject are indexed from 0 to getNbRelations(subject) - 1, in the order of the target ids
+  unsigned int getNbRelations(int subject) const { return relationStart_[subject + 1] - relationStart_[subject]; }
+  unsigned int getRelationTarget(int subject, unsigned int relation) const { return relationTarget_[relationStart_[subject] + relation]; }
+
+  // 3D distance between subject and target
+  double getDistance(int subject, unsigned int relation) const { return distance_[relationStart_[subject] + relation]; }
+
+  // Decrease of the 2D distance between subject and target during deltaDistTime
+  double getDeltaDist(int subject, unsigned int relation) const { return deltaDist_[relationStart_[subject] + relation]; }
+
+  // Confidence of moving toward target, see Motion2D::isInAngle. 0 if target is not in the motion direction.
+  double getToward(int subject, unsigned int relation) const { return toward_[relationStart_[subject] + relation]; }
+
+private:
+  // Targets
+  std::vector<std::string> targetIds_;
+  std::map<std::string, int> targetIndex_;
+  std::vector<double> targetX_;
+  std::vector<double> targetY_;
+  std::vector<double> targetZ_;
+  double radius_;
+  SpatialGrid grid_;
+
+  // Subjects
+  std::vector<int> selfTarget_;
+  std::vector<double> curX_;
+  std::vector<double> curY_;
+  std::vector<double> curZ_;
+  std::vector<double> prevX_; // position deltaDistTime ago
+  std::vector<double> prevY_;
+  std::vector<double> headingX_; // unit motion direction
+  std::vector<double> headingY_;
+  std::vector<double> angleThreshold_;
+  std::vector<double> cosThreshold_; // above 1 when there is no motion direction
+  std::vector<double> speed_;
+
+  // Relations, relationStart_[s] is the first relation of subject s
+  std::vector<unsigned int> relationStart_;
+  std::vector<unsigned int> relationTarget_;
+  std::vector<double> distance_;
+  std::vector<double> deltaDist_;
+  std::vector<double> toward_;
+
+  // Positions of the neighbours of the current subject
+  std::vector<unsigned int> neighbours_;
+  std::vector<double> neighbourX_;
+  std::vector<double> neighbourY_;
+  std::vector<double> neighbourZ_;
+};
+
+#endif // MOTIONKERNEL_H
@@ -0,0 +1,43 @@
+#ifndef MOTIONPREDICTOR_H
+#define MOTIONPREDICTOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "toaster_msgs/Prediction.h"
+
+#include "EntityHistory.h"
+#include "MotionKernel.h"
+
+/**
+ * Short horizon prediction of the agents body position.
+ * The constant velocity extrapolation of the motion filter is blended with a
+ * motion toward the entity the agent is moving toward, weighted by the
+ * confidence of moving toward it.
+ */
+class MotionPredictor
+{
+public:
+  /**
+   * @brief Predicts the position of agentId at each horizon after its last configuration
+   * @param horizons in s
+   * @param angleThreshold maximum angle between the motion direction and the goal, in rad
+   * @param maxGoalDistance goals are searched closer than this distance, in m
+   * @param accelerationNoise of the motion filter, used for the confidence
+   * @param kernel if not NULL, goals are searched with its grid, else among all entities
+   * @return false if there is no data for agentId
+   */
+  static bool predict(const std::map<std::string, EntityHistory>& mapEnts, const std::string& agentId,
+                      const std::vector<double>& horizons, double angleThreshold, double maxGoalDistance,
+                      double accelerationNoise, const MotionKernel* kernel,
+                      toaster_msgs::Prediction& prediction);
+
+private:
+  // Entity with the highest confidence of being moved toward, "" if none
+  static std::string findGoal(const std::map<std::string, EntityHistory>& mapEnts, const std::string& agentId,
+                              const PoseSnapshot_t& position, double heading, double angleThreshold,
+                              double maxGoalDistance, const MotionKernel* kernel, double& confidence);
+};
+
+#endif // MOTIONPREDICTOR_H
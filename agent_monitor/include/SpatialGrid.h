@@ -0,0 +1,37 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <vector>
+
+/**
+ * Uniform 2D grid over a set of points, rebuilt each loop.
+ * Points are sorted by cell (counting sort) in flat arrays, so a build does not
+ * allocate once the arrays reached their size. query() only visits the cells
+ * overlapping the search circle.
+ */
+class SpatialGrid
+{
+public:
+  SpatialGrid();
+
+  // Sorts the points in cells of cellSize. cellSize is increased if the grid would be too large.
+  void build(const std::vector<double>& x, const std::vector<double>& y, double cellSize);
+
+  // Sets in neighbours the indexes of the points closer than radius to (x, y), in increasing order
+  void query(double x, double y, double radius, std::vector<unsigned int>& neighbours) const;
+
+private:
+  double minX_;
+  double minY_;
+  double cellSize_;
+  unsigned int nbCellsX_;
+  unsigned int nbCellsY_;
+
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<unsigned int> cellStart_; // nbCells + 1 offsets in cellPoints_
+  std::vector<unsigned int> cellPoints_;
+  std::vector<unsigned int> pointCell_;
+};
+
+#endif // SPATIALGRID_H
@@ -92,9 +92,11 @@ bool AgentManager::addMonitoredAgent(string id)
     {
       ROS_INFO("[agent_monitor][INFO] Agent %s now monitored", id.c_str());
       agentsMonitored_.push_back(id);
+      return true;
     }
     else
       ROS_INFO("[agent_monitor][INFO] Agent %s is already monitored", id.c_str());
+    return false;
 }
 
 bool AgentManager::addAgent(toaster_msgs::AddAgent::Request &req,
@@ -164,9 +166,11 @@ bool AgentManager::removeMonitoredAgent(string id)
   {
     ROS_INFO("[agent_monitor][INFO] Agent %s no more monitored", id.c_str());
     agentsMonitored_.erase(it);
+    return true;
   }
   else
     ROS_INFO("[agent_monitor][INFO] Agent %s is already not monitored", id.c_str());
+  return false;
 }
 
 bool AgentManager::removeAgent(toaster_msgs::RemoveAgent::Request &req,
@@ -262,8 +266,11 @@ bool AgentManager::printAllMonitoredAgents(toaster_msgs::Empty::Request &req,
     for (std::vector<std::string>::iterator it = agentsMonitored_.begin(); it != agentsMonitored_.end(); ++it)
     {
         ROS_INFO("[agent_monitor][Request][PRINT] Agent id: %s", (*it).c_str());
-        for (vector<string>::iterator itJoint = mapAgentToJointsMonitored_[*it].begin();
-                itJoint != mapAgentToJointsMonitored_[*it].end(); ++itJoint) {
+        map<string, vector<string> >::iterator itJoints = mapAgentToJointsMonitored_.find(*it);
+        if (itJoints == mapAgentToJointsMonitored_.end())
+            continue;
+        for (vector<string>::iterator itJoint = itJoints->second.begin();
+                itJoint != itJoints->second.end(); ++itJoint) {
             ROS_INFO("[agent_monitor][Request][PRINT] Joint Monitored name: %s", (*itJoint).c_str());
         }
     }
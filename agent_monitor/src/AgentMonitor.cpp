@@ -2,39 +2,81 @@
 
 #include "LookingFact.h"
 
+AgentMonitor::AgentMonitor() : historySize_(EntityHistory::DEFAULT_CAPACITY), motionNoise_(EntityHistory::DEFAULT_NOISE),
+                               humansMap_(NULL), robotsMap_(NULL), objectsMap_(NULL), presenceTimeout_(5.0),
+                               humansReader_(NULL), robotsReader_(NULL), objectsReader_(NULL),
+                               monitorAllHumans_(false), monitorAllRobots_(false)
+{
+
+}
+
 void AgentMonitor::init(ros::NodeHandle* node)
 {
   agentsManager_.init(node);
+
+  int historySize;
+  if (node->getParam("/agent_monitor/historySize", historySize) && historySize > 0)
+    historySize_ = historySize;
+  ROS_INFO("[agent_monitor] Keeping %u poses per entity", historySize_);
+
+  node->param("/agent_monitor/presenceTimeout", presenceTimeout_, presenceTimeout_);
+
+  if (!node->getParam("/agent_monitor/headJoints", headJoints_))
+    headJoints_["pr2"] = "head_tilt_link";
+  for (std::map<std::string, std::string>::iterator it = headJoints_.begin(); it != headJoints_.end(); ++it)
+    ROS_INFO("[agent_monitor] Head joint of %s is %s", it->first.c_str(), it->second.c_str());
 }
 
 void AgentMonitor::updateMonitored()
 {
   agentsMonitored_ = agentsManager_.getMonitoredAgents();
-  mapAgentToJointsMonitored_ = agentsManager_.getMonitoredJoints();
 
-  // If we start to monitor all humans, we add them to the agentsMonitored_ vector
-  if (agentsManager_.startMonitorAllHumans())
-      for (std::map<std::string, Human*>::iterator it = humansMap_.begin(); it != humansMap_.end(); ++it)
-          if ((it->second->getId() != "") && (std::find(agentsMonitored_.begin(), agentsMonitored_.end(), it->second->getId()) == agentsMonitored_.end()))
-              agentsManager_.addMonitoredAgent(it->first);
+  // Joints are resolved again in the histories only when they changed
+  std::map<std::string, std::vector<std::string> > monitoredJoints = agentsManager_.getMonitoredJoints();
+  if (monitoredJoints != mapAgentToJointsMonitored_)
+  {
+    mapAgentToJointsMonitored_.swap(monitoredJoints);
+    mapAgentToJointSlots_.clear();
+    missingJoints_.clear();
+  }
+
+  if (humansReader_ == NULL || robotsReader_ == NULL)
+    return;
 
-  // If we start to monitor all robots, we add them to the agentsMonitored_ vector
+  if (agentsManager_.startMonitorAllHumans())
+    monitorAllHumans_ = true;
   if (agentsManager_.startMonitorAllRobots())
-      for (std::map<std::string, Robot*>::iterator it = robotsMap_.begin(); it != robotsMap_.end(); ++it)
-          if ((it->second->getId() != "") && (std::find(agentsMonitored_.begin(), agentsMonitored_.end(), it->second->getId()) == agentsMonitored_.end()))
-              agentsManager_.addMonitoredAgent(it->first);
+    monitorAllRobots_ = true;
 
-  // If we stop to monitor all humans, we add them to the agentsMonitored_ vector
+  // If we stop to monitor all humans, we remove them from the agentsMonitored_ vector
   if (agentsManager_.stopMonitorAllHumans())
-      for (std::map<std::string, Human*>::iterator it = humansMap_.begin(); it != humansMap_.end(); ++it)
-          if ((it->second->getId() != "") && (std::find(agentsMonitored_.begin(), agentsMonitored_.end(), it->second->getId()) != agentsMonitored_.end()))
-              agentsManager_.removeMonitoredAgent(it->first);
+  {
+    monitorAllHumans_ = false;
+    for (std::map<std::string, Human*>::const_iterator it = humansMap_->begin(); it != humansMap_->end(); ++it)
+    {
+      autoMonitored_.erase(it->first);
+      if ((it->second->getId() != "") && (std::find(agentsMonitored_.begin(), agentsMonitored_.end(), it->second->getId()) != agentsMonitored_.end()))
+        agentsManager_.removeMonitoredAgent(it->first);
+    }
+  }
 
-  // If we stop to monitor all robots, we add them to the agentsMonitored_ vector
+  // If we stop to monitor all robots, we remove them from the agentsMonitored_ vector
   if (agentsManager_.stopMonitorAllRobots())
-      for (std::map<std::string, Robot*>::iterator it = robotsMap_.begin(); it != robotsMap_.end(); ++it)
-          if ((it->second->getId() != "") && (std::find(agentsMonitored_.begin(), agentsMonitored_.end(), it->second->getId()) != agentsMonitored_.end()))
-              agentsManager_.removeMonitoredAgent(it->first);
+  {
+    monitorAllRobots_ = false;
+    for (std::map<std::string, Robot*>::const_iterator it = robotsMap_->begin(); it != robotsMap_->end(); ++it)
+    {
+      autoMonitored_.erase(it->first);
+      if ((it->second->getId() != "") && (std::find(agentsMonitored_.begin(), agentsMonitored_.end(), it->second->getId()) != agentsMonitored_.end()))
+        agentsManager_.removeMonitoredAgent(it->first);
+    }
+  }
+
+  // While all humans or robots are monitored, arriving ones are added and departed ones removed
+  if (monitorAllHumans_)
+    monitorPresent(*humansReader_);
+  if (monitorAllRobots_)
+    monitorPresent(*robotsReader_);
 
   // Reload monitored agents
   agentsMonitored_ = agentsManager_.getMonitoredAgents();
@@ -42,61 +84,123 @@ void AgentMonitor::updateMonitored()
 
 void AgentMonitor::updateUnmonitoredEntitieTRBuffer()
 {
-  updateUnmonitoredEntitieTRBuffer(humansMap_);
-  updateUnmonitoredEntitieTRBuffer(robotsMap_);
-  updateUnmonitoredEntitieTRBuffer(objectsMap_);
+  updateUnmonitoredEntitieTRBuffer(humansReader_);
+  updateUnmonitoredEntitieTRBuffer(robotsReader_);
+  updateUnmonitoredEntitieTRBuffer(objectsReader_);
+}
+
+void AgentMonitor::forget(const std::string& id)
+{
+  mapEntityHistory_.erase(id);
+  mapAgentToJointSlots_.erase(id);
+  missingJoints_.erase(id);
 }
 
 bool AgentMonitor::updateAgentTRBuffer(Agent* agent)
 {
-  std::map<std::string, TRBuffer < Entity* > >::iterator itTRB = mapTRBEntity_.find(agent->getId());
-  if (itTRB == mapTRBEntity_.end())
+  if (agent->getId() == "")
+    return false;
+
+  std::map<std::string, EntityHistory>::iterator itHistory = mapEntityHistory_.find(agent->getId());
+  if (itHistory == mapEntityHistory_.end())
   {
     //1st time, we initialize variables
-    TRBuffer<Entity*> buffAgnt;
-    buffAgnt.push_back(agent->getTime(), agent);
-    mapTRBEntity_[agent->getId()] = buffAgnt;
+    pushHistory(agent->getId(), agent, getSkeleton(agent));
 
     // This module is made for temporal reasoning.
     // We need more data to make computation, so we will end the loop here.
+    return false;
   }
-  else // Agent is present in agentsMonitor_.mapTRBEntity_
+
+  if (mapAgentToJointSlots_.find(agent->getId()) == mapAgentToJointSlots_.end())
+    resolveJointSlots(agent->getId(), itHistory->second);
+
+  // If this is a new data we add it to the buffer
+  if (!itHistory->second.push_back(agent, getSkeleton(agent)))
+    return false;
+
+  checkMissingJoints(agent->getId(), itHistory->second);
+  return true;
+}
+
+void AgentMonitor::resolveJointSlots(const std::string& agentId, EntityHistory& history)
+{
+  std::vector<std::pair<std::string, int> >& slots = mapAgentToJointSlots_[agentId];
+  slots.clear();
+
+  std::map<std::string, std::vector<std::string> >::const_iterator itJoints = mapAgentToJointsMonitored_.find(agentId);
+  if (itJoints == mapAgentToJointsMonitored_.end())
+    return;
+
+  for (std::vector<std::string>::const_iterator itJnt = itJoints->second.begin(); itJnt != itJoints->second.end(); ++itJnt)
+    slots.push_back(std::make_pair(*itJnt, history.registerJoint(*itJnt)));
+}
+
+void AgentMonitor::checkMissingJoints(const std::string& agentId, const EntityHistory& history)
+{
+  const std::vector<std::pair<std::string, int> >& slots = mapAgentToJointSlots_[agentId];
+  for (std::vector<std::pair<std::string, int> >::const_iterator itJnt = slots.begin(); itJnt != slots.end(); ++itJnt)
   {
-    // If this is a new data we add it to the buffer
-    if(agent->getId() != "")
-    {
-      if(mapTRBEntity_[agent->getId()].back()->getTime() < agent->getTime())
-      {
-        mapTRBEntity_[agent->getId()].push_back(agent->getTime(), agent);
-        return true;
-      }
-    }
+    bool missing = history.getPose(history.size() - 1, itJnt->second) == NULL;
+    std::set<std::string>& missingJoints = missingJoints_[agentId];
+    if (missing && missingJoints.insert(itJnt->first).second)
+      ROS_WARN("[agent_monitor] Monitored joint %s of agent %s is not received", itJnt->first.c_str(), agentId.c_str());
+    else if (!missing && missingJoints.erase(itJnt->first) > 0)
+      ROS_INFO("[agent_monitor] Monitored joint %s of agent %s is received", itJnt->first.c_str(), agentId.c_str());
   }
-  return false;
+}
+
+bool AgentMonitor::pushHistory(const std::string& id, Entity* entity, const std::map<std::string, Joint*>* skeleton)
+{
+  std::map<std::string, EntityHistory>::iterator itHistory = mapEntityHistory_.find(id);
+  if (itHistory == mapEntityHistory_.end())
+    itHistory = mapEntityHistory_.insert(std::make_pair(id, EntityHistory(historySize_, &motionNoise_))).first;
+
+  return itHistory->second.push_back(entity, skeleton);
 }
 
 Agent* AgentMonitor::getMonitoredAgent(const std::string id)
 {
-  if (robotsMap_.find(id) != robotsMap_.end())
-    return robotsMap_[id];
-  else if (humansMap_.find(id) != humansMap_.end())
-    return humansMap_[id];
-  else
-    return nullptr; // objects
+  if (robotsReader_ != NULL)
+  {
+    std::map<std::string, Robot*>::const_iterator itRobot = robotsMap_->find(id);
+    if (itRobot != robotsMap_->end())
+      return isPresent(*robotsReader_, id) ? itRobot->second : nullptr;
+  }
+  if (humansReader_ != NULL)
+  {
+    std::map<std::string, Human*>::const_iterator itHuman = humansMap_->find(id);
+    if (itHuman != humansMap_->end())
+      return isPresent(*humansReader_, id) ? itHuman->second : nullptr;
+  }
+  return nullptr; // objects
 }
 
-void AgentMonitor::computeLookingFacts(Agent* agent, double lookTwdDeltaDist, double lookTwdAngularAperture, toaster_msgs::FactList& factList_msg)
+void AgentMonitor::computeLookingFacts(Agent* agent, const MotionKernel& kernel, double lookTwdDeltaDist, double lookTwdAngularAperture,
+                                       double lookOccluderRadius, toaster_msgs::FactList& factList_msg)
 {
+  std::map<std::string, EntityHistory>::iterator itHistory = mapEntityHistory_.find(agent->getId());
+  if (itHistory == mapEntityHistory_.end() || itHistory->second.empty())
+    return;
+  unsigned long time = itHistory->second.backTime();
+
+  // Both cones share the head of the agent
+  LookingHead_t head;
+  if (!LookingFact::computeHead(itHistory->second, LookingFact::getHeadJoint(headJoints_, agent->getId()), head))
+    return;
+
   std::map<std::string, double> mapIdValue;
-  mapIdValue = LookingFact::compute(mapTRBEntity_, agent->getId(), lookTwdDeltaDist, lookTwdAngularAperture);
+  mapIdValue = LookingFact::compute(head, mapEntityHistory_, kernel, agent->getId(), headJoints_,
+                                    lookTwdDeltaDist, lookTwdAngularAperture, lookOccluderRadius);
   LookingFact::createTowardFact(mapIdValue, factList_msg,
                                 lookTwdAngularAperture,
                                 agent->getId(),
-                                mapTRBEntity_[agent->getId()].back());
+                                time);
 
-  mapIdValue = LookingFact::compute(mapTRBEntity_, agent->getId(), lookTwdDeltaDist*0.5, lookTwdAngularAperture*0.25);
+  mapIdValue = LookingFact::compute(head, mapEntityHistory_, kernel, agent->getId(), headJoints_,
+                                    lookTwdDeltaDist*0.5, lookTwdAngularAperture*0.25, lookOccluderRadius);
   LookingFact::createAtFact(mapIdValue, factList_msg,
                                 lookTwdAngularAperture*0.25,
                                 agent->getId(),
-                                mapTRBEntity_[agent->getId()].back());
+                                time);
 }
@@ -0,0 +1,138 @@
+#include "EntityHistory.h"
+
+using namespace std;
+
+const MotionNoise_t EntityHistory::DEFAULT_NOISE = {2.0, 5.0, 0.03};
+
+EntityHistory::EntityHistory(unsigned int capacity, const MotionNoise_t* noise) :
+  capacity_(capacity > 0 ? capacity : 1), head_(0), size_(0), stride_(1),
+  times_(capacity_, 0), poses_(capacity_), noise_(noise != NULL ? noise : &DEFAULT_NOISE), filters_(1)
+{
+}
+
+bool EntityHistory::push_back(Entity* entity, const map<string, Joint*>* skeleton)
+{
+  unsigned long time = entity->getTime();
+  if (size_ > 0 && time <= backTime())
+    return false;
+
+  // Joints received for the first time get a slot before we take the sample
+  if (skeleton != NULL)
+    for (map<string, Joint*>::const_iterator it = skeleton->begin(); it != skeleton->end(); ++it)
+      if (it->second != NULL)
+        registerJoint(it->first);
+
+  unsigned int physical;
+  if (size_ < capacity_)
+  {
+    physical = physicalIndex(size_);
+    size_++;
+  }
+  else
+  {
+    // Full: the oldest sample is overwritten
+    physical = head_;
+    head_ = (head_ + 1) % capacity_;
+  }
+
+  times_[physical] = time;
+  PoseSnapshot_t* sample = &poses_[physical * stride_];
+  fillSnapshot(entity, sample[0]);
+  for (unsigned int i = 1; i < stride_; i++)
+    sample[i].valid = false;
+
+  filters_[0].update(time, sample[0].position[0], sample[0].position[1],
+                     noise_->bodyAcceleration, noise_->position);
+
+  if (skeleton != NULL)
+    for (map<string, Joint*>::const_iterator it = skeleton->begin(); it != skeleton->end(); ++it)
+      if (it->second != NULL)
+      {
+        int slot = getJointSlot(it->first);
+        fillSnapshot(it->second, sample[1 + slot]);
+        filters_[1 + slot].update(time, sample[1 + slot].position[0], sample[1 + slot].position[1],
+                                  noise_->jointAcceleration, noise_->position);
+      }
+
+  return true;
+}
+
+int EntityHistory::getIndexAfter(unsigned long time) const
+{
+  // times are increasing from logical index 0 to size_ - 1
+  unsigned int first = 0;
+  unsigned int last = size_;
+  while (first < last)
+  {
+    unsigned int middle = first + (last - first) / 2;
+    if (getTimeFromIndex(middle) < time)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+
+  if (first == size_)
+    return -1;
+  return first;
+}
+
+int EntityHistory::getJointSlot(const string& jointName) const
+{
+  map<string, int>::const_iterator it = jointSlots_.find(jointName);
+  if (it == jointSlots_.end())
+    return -1;
+  return it->second;
+}
+
+int EntityHistory::registerJoint(const string& jointName)
+{
+  int slot = getJointSlot(jointName);
+  if (slot == -1)
+    slot = addJointSlot(jointName);
+  return slot;
+}
+
+const PoseSnapshot_t* EntityHistory::getPose(unsigned int index, const string& jointName) const
+{
+  if (jointName == "")
+    return &getBodyFromIndex(index);
+
+  int slot = getJointSlot(jointName);
+  if (slot == -1)
+    return NULL;
+
+  return getPose(index, slot);
+}
+
+int EntityHistory::addJointSlot(const string& jointName)
+{
+  int slot = stride_ - 1;
+  unsigned int newStride = stride_ + 1;
+
+  // Joints set is stable after the first messages, so we only pay this copy once per joint
+  vector<PoseSnapshot_t> poses(capacity_ * newStride);
+  for (unsigned int i = 0; i < capacity_; i++)
+  {
+    for (unsigned int j = 0; j < stride_; j++)
+      poses[i * newStride + j] = poses_[i * stride_ + j];
+    poses[i * newStride + stride_].valid = false;
+  }
+
+  poses_.swap(poses);
+  stride_ = newStride;
+  filters_.resize(stride_);
+  jointSlots_[jointName] = slot;
+  return slot;
+}
+
+void EntityHistory::fillSnapshot(Entity* entity, PoseSnapshot_t& snapshot)
+{
+  snapshot.position[0] = entity->getPosition().get<0>();
+  snapshot.position[1] = entity->getPosition().get<1>();
+  snapshot.position[2] = entity->getPosition().get<2>();
+
+  for (unsigned int i = 0; i < 3; i++)
+    snapshot.orientation[i] = (i < entity->orientation_.size()) ? entity->orientation_[i] : 0.0;
+
+  snapshot.valid = true;
+}
@@ -12,11 +12,13 @@ toaster_msgs::Fact FactCreator::setFactBase(Joint* joint)
   return fact_msg;
 }
 
-toaster_msgs::Fact FactCreator::setFactBase(string agent, map<string, TRBuffer < Entity* > >& mapTRBEntity)
+toaster_msgs::Fact FactCreator::setFactBase(const string& agent, const map<string, EntityHistory>& mapEntityHistory)
 {
   toaster_msgs::Fact fact_msg;
   fact_msg.subjectId = agent;
-  fact_msg.time = mapTRBEntity[agent].back()->getTime();
+  map<string, EntityHistory>::const_iterator it = mapEntityHistory.find(agent);
+  if (it != mapEntityHistory.end() && !it->second.empty())
+    fact_msg.time = it->second.backTime();
   fact_msg.subjectOwnerId = "";
 
   return fact_msg;
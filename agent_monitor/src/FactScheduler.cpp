@@ -0,0 +1,43 @@
+#include "FactScheduler.h"
+
+using namespace std;
+
+// Tolerance on the period, so that a loop a bit early does not skip a whole period
+static const double PERIOD_TOLERANCE = 0.005;
+
+FactScheduler::FactScheduler()
+{
+  for (unsigned int f = 0; f < NB_FACT_FAMILIES; f++)
+  {
+    period_[f] = 0.0;
+    lastRun_[f] = 0.0;
+    due_[f] = true;
+  }
+}
+
+void FactScheduler::setRate(FactFamily_t family, double rate)
+{
+  period_[family] = (rate > 0.0) ? 1.0 / rate : 0.0;
+}
+
+void FactScheduler::addDependency(FactFamily_t family, FactFamily_t dependency)
+{
+  dependencies_[family].push_back(dependency);
+}
+
+void FactScheduler::update(double now)
+{
+  for (unsigned int f = 0; f < NB_FACT_FAMILIES; f++)
+    due_[f] = period_[f] == 0.0 || now < lastRun_[f] || now - lastRun_[f] >= period_[f] - PERIOD_TOLERANCE;
+
+  // Dependencies of dependencies are reached after at most NB_FACT_FAMILIES passes
+  for (unsigned int pass = 0; pass < NB_FACT_FAMILIES; pass++)
+    for (unsigned int f = 0; f < NB_FACT_FAMILIES; f++)
+      if (due_[f])
+        for (vector<FactFamily_t>::const_iterator it = dependencies_[f].begin(); it != dependencies_[f].end(); ++it)
+          due_[*it] = true;
+
+  for (unsigned int f = 0; f < NB_FACT_FAMILIES; f++)
+    if (due_[f])
+      lastRun_[f] = now;
+}
@@ -1,8 +1,9 @@
 #include "LookingFact.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "toaster-lib/MathFunctions.h"
-#include "toaster-lib/Joint.h"
-#include "toaster-lib/Agent.h"
 
 #include "toaster_msgs/Fact.h"
 
@@ -10,116 +11,155 @@
 
 using namespace std;
 
-map<string, double> LookingFact::compute(map<string, TRBuffer < Entity* > > mapEnts,
-                                        string agentMonitored, double deltaDist,
-                                        double angularAperture)
+// Heads are compared with the body position of the entities in the grid
+static const double HEAD_TO_BODY_MARGIN = 1.0;
+
+const string LookingFact::DEFAULT_HEAD_JOINT = "head";
+
+// Point of an entity tested against the cone
+struct LookingTarget_t
 {
-    Map_t returnMap;
-    Entity * currentEntity;
-    Entity * monitoredAgentHead;
-    float halfAperture = angularAperture / 2.f;
-    Vec_t agentHeadPosition(3);
-    Vec_t agentHeadOrientation(3);
-    Vec_t entityPosition(3);
-    float entitytoAxisAngle;
-    Mat_t rotX(3);
-    Mat_t rotY(3);
-    Mat_t rotZ(3);
-
-    //Get the monitored agent head entity
-    //TODO add a rosparam for robot's head joint name
-    string jointName = "";
-    if (agentMonitored == "pr2")
-      jointName = "head_tilt_link";
-    else
-      jointName = "head";
-
-    map<string, Joint*> skelMap = ((Agent*) mapEnts[agentMonitored].back())->skeleton_;
-    if (skelMap.find(jointName) != skelMap.end())
-      monitoredAgentHead = skelMap[jointName];
-    else
-      return returnMap;
-
-    //Get 3d position from agent head
-    agentHeadPosition[0] = bg::get<0>(monitoredAgentHead->getPosition());
-    agentHeadPosition[1] = bg::get<1>(monitoredAgentHead->getPosition());
-    agentHeadPosition[2] = bg::get<2>(monitoredAgentHead->getPosition());
-    //Get 3d orientation (roll pitch yaw) from agent head
-    agentHeadOrientation = (Vec_t) monitoredAgentHead->getOrientation();
-    //Compute rotation matricies from agent head orientation
-    rotX = MathFunctions::matrixfromAngle(0, agentHeadOrientation[0]);
-    rotY = MathFunctions::matrixfromAngle(1, agentHeadOrientation[1]);
-    rotZ = MathFunctions::matrixfromAngle(2, agentHeadOrientation[2]);
-
-    for (map<string, TRBuffer < Entity*> >::iterator it = mapEnts.begin(); it != mapEnts.end(); ++it) {
-      if (it->first != agentMonitored)
-      {
-        //Get the current entity
-        string jointName = "";
-        if (it->first == "pr2")
-          jointName = "head_tilt_link";
-        else if(it->first == "HERAKLES_HUMAN1" || it->first == "HERAKLES_HUMAN2")
-          jointName = "head";
-
-        if(jointName != "") // robot or human
-        {
-          map<string, Joint*> skelMap = ((Agent*) it->second.back())->skeleton_;
-          if (skelMap.find(jointName) != skelMap.end())
-            currentEntity = skelMap[jointName];
-          else
-            break;
-        }
-        else //objects
-          currentEntity = it->second.back();
+  const string* id;
+  double position[3];
+  double dist;
+  double cosAngle;
+};
 
-        //Get the postion from current entity
-        entityPosition[0] = bg::get<0>(currentEntity->getPosition());
-        entityPosition[1] = bg::get<1>(currentEntity->getPosition());
-        entityPosition[2] = bg::get<2>(currentEntity->getPosition());
+const string& LookingFact::getHeadJoint(const map<string, string>& headJoints, const string& entityId)
+{
+  map<string, string>::const_iterator it = headJoints.find(entityId);
+  if (it != headJoints.end())
+    return it->second;
+  return DEFAULT_HEAD_JOINT;
+}
+
+bool LookingFact::computeHead(const EntityHistory& history, const string& headJoint, LookingHead_t& head)
+{
+  if (history.empty())
+    return false;
+
+  const PoseSnapshot_t* headPose = history.getPose(history.size() - 1, headJoint);
+  if (headPose == NULL)
+    return false;
+
+  head.position[0] = headPose->position[0];
+  head.position[1] = headPose->position[1];
+  head.position[2] = headPose->position[2];
+
+  // x axis of the head frame, from pitch and yaw
+  double cy = cos(headPose->orientation[2]);
+  double sy = sin(headPose->orientation[2]);
+  double cp = cos(headPose->orientation[1]);
+  double sp = sin(headPose->orientation[1]);
+  head.axis[0] = cp * cy;
+  head.axis[1] = cp * sy;
+  head.axis[2] = -sp;
+  return true;
+}
 
-        double dx = entityPosition[0] - agentHeadPosition[0];
-        double dy = entityPosition[1] - agentHeadPosition[1];
-        double dz = entityPosition[2] - agentHeadPosition[2];
-        double d = dx*dx + dy*dy + dz*dz;
+map<string, double> LookingFact::compute(const LookingHead_t& head,
+                                        const map<string, EntityHistory>& mapEnts,
+                                        const MotionKernel& kernel,
+                                        const string& agentMonitored,
+                                        const map<string, string>& headJoints,
+                                        double deltaDist, double angularAperture,
+                                        double occluderRadius)
+{
+    Map_t returnMap;
+    double cosHalfAperture = cos(angularAperture / 2.0);
+    double deltaDist2 = deltaDist * deltaDist;
+
+    // Only entities which can be closer than deltaDist to the head
+    vector<unsigned int> neighbours;
+    kernel.getNeighbours(head.position[0], head.position[1], deltaDist + HEAD_TO_BODY_MARGIN, neighbours);
+
+    // Entities in the sphere bounding the cone, candidates and occluders
+    vector<LookingTarget_t> inRange;
+    inRange.reserve(neighbours.size());
+    for (vector<unsigned int>::iterator itNeighbour = neighbours.begin(); itNeighbour != neighbours.end(); ++itNeighbour) {
+      map<string, EntityHistory>::const_iterator it = mapEnts.find(kernel.getTargetId(*itNeighbour));
+      if (it == mapEnts.end() || it->first == agentMonitored || it->second.empty())
+        continue;
+
+      // robot or human head, objects body
+      unsigned int last = it->second.size() - 1;
+      const PoseSnapshot_t* currentEntity = it->second.getPose(last, getHeadJoint(headJoints, it->first));
+      if (currentEntity == NULL)
+        currentEntity = it->second.getPose(last, "");
+      if (currentEntity == NULL)
+        continue;
+
+      LookingTarget_t target;
+      target.id = &it->first;
+      double d2 = 0.0;
+      double dot = 0.0;
+      for (unsigned int i = 0; i < 3; i++)
+      {
+        target.position[i] = currentEntity->position[i];
+        double delta = target.position[i] - head.position[i];
+        d2 += delta * delta;
+        dot += delta * head.axis[i];
+      }
+      if (d2 > deltaDist2 || d2 == 0.0)
+        continue;
 
-        if(d <= deltaDist*deltaDist)
-        {
-          float cy = cos(agentHeadOrientation[2]);
-          float sy = sin(agentHeadOrientation[2]);
-          float cp = cos(agentHeadOrientation[1]);
-          float sp = sin(agentHeadOrientation[1]);
+      target.dist = sqrt(d2);
+      target.cosAngle = dot / target.dist;
+      inRange.push_back(target);
+    }
 
-          std::vector<float> rot {cp*cy, cp*sy, -sp};
+    double occluderRadius2 = occluderRadius * occluderRadius;
+    for (vector<LookingTarget_t>::iterator itTarget = inRange.begin(); itTarget != inRange.end(); ++itTarget)
+    {
+      // Outside of the cone, no need for the angle
+      if (itTarget->cosAngle <= cosHalfAperture)
+        continue;
 
-          float X = dx*rot[0] + dy*rot[1] + dz*rot[2];
+      // Hidden if the line of sight crosses the sphere of a closer entity
+      bool occluded = false;
+      if (occluderRadius > 0.0)
+      {
+        double sight[3];
+        for (unsigned int i = 0; i < 3; i++)
+          sight[i] = (itTarget->position[i] - head.position[i]) / itTarget->dist;
 
-          double ang = acos(X/sqrt(d));
-          if (ang < halfAperture)
-              returnMap.insert(std::pair<string, double>(it->first, ang));
+        for (vector<LookingTarget_t>::iterator itOccluder = inRange.begin(); itOccluder != inRange.end() && !occluded; ++itOccluder)
+        {
+          if (itOccluder == itTarget || itOccluder->dist >= itTarget->dist)
+            continue;
+
+          double along = 0.0;
+          for (unsigned int i = 0; i < 3; i++)
+            along += (itOccluder->position[i] - head.position[i]) * sight[i];
+          occluded = along > 0.0 && along < itTarget->dist - occluderRadius
+              && itOccluder->dist * itOccluder->dist - along * along < occluderRadius2;
         }
       }
+
+      if (!occluded)
+        returnMap.insert(std::pair<string, double>(*itTarget->id, acos(min(itTarget->cosAngle, 1.0))));
     }
     return returnMap;
 }
 
-void LookingFact::createTowardFact(map<string, double> mapIdValue, toaster_msgs::FactList &factList_msg,
-                                  double angle, string subjectId, Entity* entity)
+void LookingFact::createTowardFact(const map<string, double>& mapIdValue, toaster_msgs::FactList &factList_msg,
+                                  double angle, const string& subjectId, unsigned long time)
 {
-  createFact(mapIdValue, factList_msg, angle, subjectId,entity, "IsLookingToward");
+  createFact(mapIdValue, factList_msg, angle, subjectId, time, "IsLookingToward");
 }
 
-void LookingFact::createAtFact(map<string, double> mapIdValue, toaster_msgs::FactList &factList_msg,
-                                  double angle, string subjectId, Entity* entity)
+void LookingFact::createAtFact(const map<string, double>& mapIdValue, toaster_msgs::FactList &factList_msg,
+                                  double angle, const string& subjectId, unsigned long time)
 {
-  createFact(mapIdValue, factList_msg, angle, subjectId,entity, "IsLookingAt");
+  createFact(mapIdValue, factList_msg, angle, subjectId, time, "IsLookingAt");
 }
 
-void LookingFact::createFact(map<string, double> mapIdValue, toaster_msgs::FactList &factList_msg,
-                            double angle, string subjectId, Entity* entity, string property)
+void LookingFact::createFact(const map<string, double>& mapIdValue, toaster_msgs::FactList &factList_msg,
+                            double angle, const string& subjectId, unsigned long time, const string& property)
 {
   if (!mapIdValue.empty())
   {
-    for (std::map<std::string, double>::iterator it = mapIdValue.begin(); it != mapIdValue.end(); ++it)
+    for (std::map<std::string, double>::const_iterator it = mapIdValue.begin(); it != mapIdValue.end(); ++it)
     {
       toaster_msgs::Fact fact_msg;
       fact_msg.property = property;
@@ -130,7 +170,7 @@ void LookingFact::createFact(map<string, double> mapIdValue, toaster_msgs::FactL
       fact_msg.targetId = it->first;
       fact_msg.confidence = (angle - it->second) / angle;
       fact_msg.doubleValue = it->second;
-      fact_msg.time = entity->getTime();
+      fact_msg.time = time;
       fact_msg.subjectOwnerId = "";
       fact_msg.targetOwnerId = "";
       fact_msg.valueType = 1;
@@ -0,0 +1,83 @@
+#include "MotionFilter.h"
+
+#include <cmath>
+
+using namespace std;
+
+// Variance of the velocity before the second sample, in (m/s)^2
+static const double INITIAL_VELOCITY_VARIANCE = 1.0;
+
+MotionFilter::MotionFilter() : time_(0), nbUpdates_(0), x_(0.0), y_(0.0), vx_(0.0), vy_(0.0),
+                               pPos_(0.0), pPosVel_(0.0), pVel_(0.0)
+{
+
+}
+
+void MotionFilter::update(unsigned long time, double x, double y, double accelerationNoise, double positionNoise)
+{
+  double r = positionNoise * positionNoise;
+
+  if (nbUpdates_ == 0 || time <= time_ || time - time_ > RESET_TIME)
+  {
+    x_ = x;
+    y_ = y;
+    vx_ = 0.0;
+    vy_ = 0.0;
+    pPos_ = r;
+    pPosVel_ = 0.0;
+    pVel_ = INITIAL_VELOCITY_VARIANCE;
+    time_ = time;
+    nbUpdates_ = 1;
+    return;
+  }
+
+  // Prediction, with a white noise acceleration
+  double dt = (time - time_) * 1e-9;
+  double q = accelerationNoise * accelerationNoise;
+  double dt2 = dt * dt;
+
+  x_ += vx_ * dt;
+  y_ += vy_ * dt;
+  double pPos = pPos_ + 2.0 * dt * pPosVel_ + dt2 * pVel_ + q * dt2 * dt2 / 4.0;
+  double pPosVel = pPosVel_ + dt * pVel_ + q * dt2 * dt / 2.0;
+  double pVel = pVel_ + q * dt2;
+
+  // Correction with the perceived position
+  double s = pPos + r;
+  double kPos = pPos / s;
+  double kVel = pPosVel / s;
+  double innovationX = x - x_;
+  double innovationY = y - y_;
+
+  x_ += kPos * innovationX;
+  y_ += kPos * innovationY;
+  vx_ += kVel * innovationX;
+  vy_ += kVel * innovationY;
+
+  pPos_ = (1.0 - kPos) * pPos;
+  pPosVel_ = (1.0 - kPos) * pPosVel;
+  pVel_ = pVel - kVel * pPosVel;
+
+  time_ = time;
+  if (nbUpdates_ < 2)
+    nbUpdates_++;
+}
+
+double MotionFilter::getSpeed() const
+{
+  if (!hasVelocity())
+    return 0.0;
+  return sqrt(vx_ * vx_ + vy_ * vy_);
+}
+
+double MotionFilter::getHeading() const
+{
+  return atan2(vy_, vx_);
+}
+
+double MotionFilter::getPredictedStdDev(double dt, double accelerationNoise) const
+{
+  double q = accelerationNoise * accelerationNoise;
+  double dt2 = dt * dt;
+  return sqrt(pPos_ + 2.0 * dt * pPosVel_ + dt2 * pVel_ + q * dt2 * dt2 / 4.0);
+}
@@ -0,0 +1,182 @@
+#include "MotionKernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// Rows do not overlap the targets, __restrict__ saves the aliasing checks that prevent vectorization
+static void computeRow(const double* tx, const double* ty, const double* tz, unsigned int nbTargets,
+                       double cx, double cy, double cz, double px, double py, double hx, double hy,
+                       double* __restrict__ distance, double* __restrict__ deltaDist, double* __restrict__ toward)
+{
+  for (unsigned int t = 0; t < nbTargets; t++)
+  {
+    double dx = tx[t] - cx;
+    double dy = ty[t] - cy;
+    double dz = tz[t] - cz;
+    double pdx = tx[t] - px;
+    double pdy = ty[t] - py;
+    double curDist2D = sqrt(dx * dx + dy * dy);
+
+    distance[t] = sqrt(dx * dx + dy * dy + dz * dz);
+    deltaDist[t] = sqrt(pdx * pdx + pdy * pdy) - curDist2D;
+    toward[t] = (hx * dx + hy * dy) / max(curDist2D, 1e-9);
+  }
+}
+
+void MotionKernel::setTargets(const map<string, EntityHistory>& mapEnts, double radius)
+{
+  targetIds_.clear();
+  targetIndex_.clear();
+  targetX_.clear();
+  targetY_.clear();
+  targetZ_.clear();
+
+  for (map<string, EntityHistory>::const_iterator it = mapEnts.begin(); it != mapEnts.end(); ++it)
+  {
+    if (it->second.empty())
+      continue;
+
+    const PoseSnapshot_t& pose = it->second.back();
+    targetIndex_[it->first] = targetIds_.size();
+    targetIds_.push_back(it->first);
+    targetX_.push_back(pose.position[0]);
+    targetY_.push_back(pose.position[1]);
+    targetZ_.push_back(pose.position[2]);
+  }
+
+  radius_ = radius;
+  grid_.build(targetX_, targetY_, radius_);
+}
+
+void MotionKernel::clearSubjects()
+{
+  selfTarget_.clear();
+  curX_.clear();
+  curY_.clear();
+  curZ_.clear();
+  prevX_.clear();
+  prevY_.clear();
+  headingX_.clear();
+  headingY_.clear();
+  angleThreshold_.clear();
+  cosThreshold_.clear();
+  speed_.clear();
+}
+
+int MotionKernel::addSubject(const string& entityId, const EntityHistory& history, int slot,
+                             unsigned long deltaDistTime, double angleThreshold)
+{
+  if (history.empty())
+    return -1;
+
+  const PoseSnapshot_t* cur = history.getPose(history.size() - 1, slot);
+  if (cur == NULL)
+    return -1;
+
+  unsigned long timeNew = history.backTime();
+
+  // Speed and motion direction from the filter
+  const MotionFilter& filter = history.getFilter(slot);
+  double speed = filter.getSpeed();
+  double headingX = 0.0;
+  double headingY = 0.0;
+  double cosThreshold = 2.0;
+  if (speed > 0.0 && angleThreshold > 0.0)
+  {
+    headingX = filter.getVx() / speed;
+    headingY = filter.getVy() / speed;
+    cosThreshold = cos(angleThreshold);
+  }
+
+  // Position deltaDistTime ago
+  const PoseSnapshot_t* prev = cur;
+  int index = history.getIndexAfter(timeNew - deltaDistTime);
+  if (index != -1 && history.getPose(index, slot) != NULL)
+    prev = history.getPose(index, slot);
+
+  map<string, int>::const_iterator itSelf = targetIndex_.find(entityId);
+  selfTarget_.push_back(itSelf != targetIndex_.end() ? itSelf->second : -1);
+  curX_.push_back(cur->position[0]);
+  curY_.push_back(cur->position[1]);
+  curZ_.push_back(cur->position[2]);
+  prevX_.push_back(prev->position[0]);
+  prevY_.push_back(prev->position[1]);
+  headingX_.push_back(headingX);
+  headingY_.push_back(headingY);
+  angleThreshold_.push_back(angleThreshold);
+  cosThreshold_.push_back(cosThreshold);
+  speed_.push_back(speed);
+
+  return speed_.size() - 1;
+}
+
+void MotionKernel::compute()
+{
+  unsigned int nbSubjects = speed_.size();
+
+  relationStart_.assign(1, 0);
+  relationTarget_.clear();
+  distance_.clear();
+  deltaDist_.clear();
+  toward_.clear();
+
+  for (unsigned int s = 0; s < nbSubjects; s++)
+  {
+    const double cx = curX_[s];
+    const double cy = curY_[s];
+
+    // Gather the targets close to the subject
+    if (radius_ > 0.0)
+      grid_.query(cx, cy, radius_, neighbours_);
+    else
+    {
+      neighbours_.resize(targetIds_.size());
+      for (unsigned int t = 0; t < neighbours_.size(); t++)
+        neighbours_[t] = t;
+    }
+
+    unsigned int nbNeighbours = neighbours_.size();
+    unsigned int first = relationTarget_.size();
+    relationStart_.push_back(first + nbNeighbours);
+    if (nbNeighbours == 0)
+      continue;
+
+    neighbourX_.resize(nbNeighbours);
+    neighbourY_.resize(nbNeighbours);
+    neighbourZ_.resize(nbNeighbours);
+    for (unsigned int n = 0; n < nbNeighbours; n++)
+    {
+      relationTarget_.push_back(neighbours_[n]);
+      neighbourX_[n] = targetX_[neighbours_[n]];
+      neighbourY_[n] = targetY_[neighbours_[n]];
+      neighbourZ_[n] = targetZ_[neighbours_[n]];
+    }
+
+    distance_.resize(first + nbNeighbours);
+    deltaDist_.resize(first + nbNeighbours);
+    toward_.resize(first + nbNeighbours);
+
+    double* toward = &toward_[first];
+
+    // Vectorizable pass: distances and cosine of the angle with the motion direction
+    computeRow(&neighbourX_[0], &neighbourY_[0], &neighbourZ_[0], nbNeighbours,
+               cx, cy, curZ_[s], prevX_[s], prevY_[s], headingX_[s], headingY_[s],
+               &distance_[first], &deltaDist_[first], toward);
+
+    // Only targets in the motion direction need the angle
+    const double cosThreshold = cosThreshold_[s];
+    const double angleThreshold = angleThreshold_[s];
+    for (unsigned int n = 0; n < nbNeighbours; n++)
+    {
+      if (toward[n] > cosThreshold)
+      {
+        double deviation = acos(min(toward[n], 1.0));
+        toward[n] = max((angleThreshold - deviation) / angleThreshold, 0.0);
+      }
+      else
+        toward[n] = 0.0;
+    }
+  }
+}
@@ -0,0 +1,126 @@
+#include "MotionPredictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Motion2D.h"
+
+using namespace std;
+
+bool MotionPredictor::predict(const map<string, EntityHistory>& mapEnts, const string& agentId,
+                              const vector<double>& horizons, double angleThreshold, double maxGoalDistance,
+                              double accelerationNoise, const MotionKernel* kernel,
+                              toaster_msgs::Prediction& prediction)
+{
+  map<string, EntityHistory>::const_iterator itAgent = mapEnts.find(agentId);
+  if (itAgent == mapEnts.end() || itAgent->second.empty())
+    return false;
+
+  const EntityHistory& history = itAgent->second;
+  const MotionFilter& filter = history.getFilter(EntityHistory::BODY_SLOT);
+  double speed = filter.getSpeed();
+
+  // Filtered position, at the height of the last configuration
+  PoseSnapshot_t position = history.back();
+  position.position[0] = filter.getX();
+  position.position[1] = filter.getY();
+
+  prediction.agentId = agentId;
+  prediction.time = history.backTime();
+  prediction.velocity.x = filter.hasVelocity() ? filter.getVx() : 0.0;
+  prediction.velocity.y = filter.hasVelocity() ? filter.getVy() : 0.0;
+  prediction.velocity.z = 0.0;
+
+  double goalConfidence = 0.0;
+  string goalId = "";
+  if (speed > 0.0)
+    goalId = findGoal(mapEnts, agentId, position, filter.getHeading(), angleThreshold,
+                      maxGoalDistance, kernel, goalConfidence);
+  prediction.goalId = goalId;
+  prediction.goalConfidence = goalConfidence;
+
+  double goalDirX = 0.0;
+  double goalDirY = 0.0;
+  double goalDist = 0.0;
+  if (goalId != "")
+  {
+    const PoseSnapshot_t& goal = mapEnts.find(goalId)->second.back();
+    goalDist = Motion2D::distance2D(position, goal);
+    if (goalDist > 0.0)
+    {
+      goalDirX = (goal.position[0] - position.position[0]) / goalDist;
+      goalDirY = (goal.position[1] - position.position[1]) / goalDist;
+    }
+  }
+
+  prediction.horizons = horizons;
+  prediction.positions.resize(horizons.size());
+  prediction.confidence.resize(horizons.size());
+  for (unsigned int h = 0; h < horizons.size(); h++)
+  {
+    double t = horizons[h];
+
+    // Constant velocity
+    double x = position.position[0] + prediction.velocity.x * t;
+    double y = position.position[1] + prediction.velocity.y * t;
+
+    // Toward the goal at the same speed, stopping on it
+    if (goalDist > 0.0)
+    {
+      double travel = min(speed * t, goalDist);
+      x = (1.0 - goalConfidence) * x + goalConfidence * (position.position[0] + goalDirX * travel);
+      y = (1.0 - goalConfidence) * y + goalConfidence * (position.position[1] + goalDirY * travel);
+    }
+
+    prediction.positions[h].x = x;
+    prediction.positions[h].y = y;
+    prediction.positions[h].z = position.position[2];
+
+    // 1 for a certain position, 0.5 for 1 m of standard deviation
+    prediction.confidence[h] = 1.0 / (1.0 + filter.getPredictedStdDev(t, accelerationNoise));
+  }
+  return true;
+}
+
+string MotionPredictor::findGoal(const map<string, EntityHistory>& mapEnts, const string& agentId,
+                                 const PoseSnapshot_t& position, double heading, double angleThreshold,
+                                 double maxGoalDistance, const MotionKernel* kernel, double& confidence)
+{
+  string goalId = "";
+  confidence = 0.0;
+
+  vector<const string*> candidates;
+  if (kernel != NULL)
+  {
+    vector<unsigned int> neighbours;
+    kernel->getNeighbours(position.position[0], position.position[1], maxGoalDistance, neighbours);
+    for (vector<unsigned int>::iterator it = neighbours.begin(); it != neighbours.end(); ++it)
+      candidates.push_back(&kernel->getTargetId(*it));
+  }
+  else
+    for (map<string, EntityHistory>::const_iterator it = mapEnts.begin(); it != mapEnts.end(); ++it)
+      candidates.push_back(&it->first);
+
+  for (vector<const string*>::iterator it = candidates.begin(); it != candidates.end(); ++it)
+  {
+    if (**it == agentId)
+      continue;
+
+    map<string, EntityHistory>::const_iterator itEnt = mapEnts.find(**it);
+    if (itEnt == mapEnts.end() || itEnt->second.empty())
+      continue;
+
+    const PoseSnapshot_t& target = itEnt->second.back();
+    if (Motion2D::distance2D(position, target) > maxGoalDistance)
+      continue;
+
+    double deviation = 0.0;
+    double curConf = Motion2D::isInAngle(position, target, heading, angleThreshold, deviation);
+    if (curConf > confidence)
+    {
+      confidence = curConf;
+      goalId = **it;
+    }
+  }
+  return goalId;
+}
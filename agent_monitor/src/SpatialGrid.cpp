@@ -0,0 +1,103 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+SpatialGrid::SpatialGrid() : minX_(0.0), minY_(0.0), cellSize_(1.0), nbCellsX_(0), nbCellsY_(0)
+{
+
+}
+
+void SpatialGrid::build(const vector<double>& x, const vector<double>& y, double cellSize)
+{
+  x_ = x;
+  y_ = y;
+  unsigned int nbPoints = x_.size();
+
+  if (nbPoints == 0)
+  {
+    nbCellsX_ = 0;
+    nbCellsY_ = 0;
+    cellStart_.assign(1, 0);
+    cellPoints_.clear();
+    return;
+  }
+
+  minX_ = *min_element(x_.begin(), x_.end());
+  minY_ = *min_element(y_.begin(), y_.end());
+  double width = *max_element(x_.begin(), x_.end()) - minX_;
+  double height = *max_element(y_.begin(), y_.end()) - minY_;
+
+  // No pruning wanted: one cell for everything
+  if (!(cellSize > 0.0))
+    cellSize = max(max(width, height), 1.0);
+
+  // Keep the grid in proportion with the number of points
+  double maxCells = max(16.0, 4.0 * nbPoints);
+  while ((floor(width / cellSize) + 1) * (floor(height / cellSize) + 1) > maxCells)
+    cellSize *= 2.0;
+
+  cellSize_ = cellSize;
+  nbCellsX_ = floor(width / cellSize_) + 1;
+  nbCellsY_ = floor(height / cellSize_) + 1;
+  unsigned int nbCells = nbCellsX_ * nbCellsY_;
+
+  // Counting sort of the points by cell
+  cellStart_.assign(nbCells + 1, 0);
+  cellPoints_.resize(nbPoints);
+  pointCell_.resize(nbPoints);
+  for (unsigned int i = 0; i < nbPoints; i++)
+  {
+    unsigned int cellX = min((unsigned int) ((x_[i] - minX_) / cellSize_), nbCellsX_ - 1);
+    unsigned int cellY = min((unsigned int) ((y_[i] - minY_) / cellSize_), nbCellsY_ - 1);
+    pointCell_[i] = cellY * nbCellsX_ + cellX;
+    cellStart_[pointCell_[i]]++;
+  }
+
+  for (unsigned int c = 1; c <= nbCells; c++)
+    cellStart_[c] += cellStart_[c - 1];
+
+  // cellStart_[c] is the end of cell c, filling backward leaves it at its start
+  for (unsigned int i = nbPoints; i-- > 0;)
+    cellPoints_[--cellStart_[pointCell_[i]]] = i;
+}
+
+void SpatialGrid::query(double x, double y, double radius, vector<unsigned int>& neighbours) const
+{
+  neighbours.clear();
+  if (nbCellsX_ == 0)
+    return;
+
+  double firstX = floor((x - radius - minX_) / cellSize_);
+  double lastX = floor((x + radius - minX_) / cellSize_);
+  double firstY = floor((y - radius - minY_) / cellSize_);
+  double lastY = floor((y + radius - minY_) / cellSize_);
+  if (lastX < 0.0 || lastY < 0.0 || firstX >= nbCellsX_ || firstY >= nbCellsY_)
+    return;
+
+  unsigned int cellX0 = max(firstX, 0.0);
+  unsigned int cellX1 = min(lastX, nbCellsX_ - 1.0);
+  unsigned int cellY0 = max(firstY, 0.0);
+  unsigned int cellY1 = min(lastY, nbCellsY_ - 1.0);
+
+  double radius2 = radius * radius;
+  for (unsigned int cellY = cellY0; cellY <= cellY1; cellY++)
+  {
+    for (unsigned int cellX = cellX0; cellX <= cellX1; cellX++)
+    {
+      unsigned int cell = cellY * nbCellsX_ + cellX;
+      for (unsigned int i = cellStart_[cell]; i < cellStart_[cell + 1]; i++)
+      {
+        unsigned int point = cellPoints_[i];
+        double dx = x_[point] - x;
+        double dy = y_[point] - y;
+        if (dx * dx + dy * dy <= radius2)
+          neighbours.push_back(point);
+      }
+    }
+  }
+
+  sort(neighbours.begin(), neighbours.end());
+}
@@ -8,23 +8,46 @@
 #include "toaster_msgs/Fact.h"
 #include "toaster_msgs/PointingTime.h"
 #include "toaster_msgs/Pointing.h"
+#include "toaster_msgs/PredictMotion.h"
+#include "toaster_msgs/PredictionList.h"
+
+#include "toaster_msgs/ThreadPool.h"
 
 #include "toaster-lib/MathFunctions.h"
 
+#include <ros/callback_queue.h>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <thread>
+
 #include <dynamic_reconfigure/server.h>
 #include <agent_monitor/agent_monitorConfig.h>
 
 #include "AgentMonitor.h"
-#include "Distances.h"
 #include "Motion2D.h"
+#include "MotionKernel.h"
 #include "FactCreator.h"
+#include "FactScheduler.h"
+#include "MotionPredictor.h"
+#include "AgentMonitorNode.h"
+
+namespace agent_monitor {
 
 AgentMonitor agentsMonitor_;
 
 //For convinience
 typedef dynamic_reconfigure::Server<agent_monitor::agent_monitorConfig> ParamServer_t;
 
-std::map<std::string, std::vector<toaster_msgs::Fact> > previousAgentsFactList_;
+// Last facts of each family, by agent, carried forward until the family is computed again
+std::map<std::string, std::vector<std::vector<toaster_msgs::Fact> > > previousAgentsFactList_;
+
+// Last motion state of the agents body, facts depending on it are computed when it changes
+std::map<std::string, bool> previousAgentsMoving_;
+
+FactScheduler factScheduler_;
+
+// Pointing and prediction requests read the histories and the motion parameters from the spinner threads
+boost::shared_mutex historyMutex_;
 
 // Compute motion:
 unsigned long oneSecond_ = pow(10, 9);
@@ -32,23 +55,21 @@ unsigned long oneSecond_ = pow(10, 9);
 //Dyn config params def values
 double lookTwdDeltaDist_ = 2.0;
 double lookTwdAngularAperture_ = 2 * PI / 3;
+bool lookOcclusion_ = false;
+double lookOccluderRadius_ = 0.15;
 
-//We consider motion when it moves more than 3 cm during 1/4 second, so when higher than 0.12 m/s
-unsigned long motion2DBodyTime_ = oneSecond_ / 4;
+//We consider motion when the filtered speed is higher than 0.12 m/s
 double motion2DBodySpeedThreshold_ = 0.12; // this are m/s
 
-double motion2DBodyDirTime_ = oneSecond_ / 2;
 double motionTwd2DBodyAngleThresold_ = 1.0;
 
 // We consider motion toward when it moves more than 3 cm during 1/4 second toward an item, so when higher than 0.12 m/s
 unsigned long motionTwdBodyDeltaDistTime_ = oneSecond_ / 4;
 double movingTwdBodyDeltaDistThreshold_ = 0.03;
 
-//We consider motion when it moves more than 3 cm during 1/4 second, so when higher than 0.12 m/s
-unsigned long motion2DJointTime_ = oneSecond_ / 4;
+//We consider motion when the filtered speed is higher than 0.12 m/s
 double motion2DJointSpeedThreshold_ = 0.12; // this are m/s
 
-double motion2DJointDirTime_ = oneSecond_;
 double motionTwd2DJointAngleThresold_ = 1.0;
 
 // We consider motion toward when it moves more than 3 cm during 1/4 second toward an item, so when higher than 0.12 m/s
@@ -62,6 +83,9 @@ double distClose_ = 0.2;
 double distMedium_ = 1.5;
 double distFar_ = 8.0;
 
+// Prediction horizons in s of the predictions topic and of requests without horizons
+std::vector<double> predictionHorizons_ = {0.5, 1.0, 1.5, 2.0, 2.5, 3.0};
+
 // Move this to a library?
 // create a fact
 
@@ -77,78 +101,63 @@ double distFar_ = 8.0;
     fact_msg.time = time;
 }*/
 
-bool isPointing(Agent* agent, std::string pointingJoint, double pointingDistThreshold) {
+bool isPointing(const PoseSnapshot_t& body, const PoseSnapshot_t& joint, double pointingDistThreshold) {
     // if distance from body > threshold
-    // TODO: check if agent got this joint
-    double distBodyJoint = bg::distance(MathFunctions::convert3dTo2d(agent->getPosition()),
-            MathFunctions::convert3dTo2d(agent->skeleton_[pointingJoint]->getPosition()));
+    double distBodyJoint = Motion2D::distance2D(body, joint);
     if (distBodyJoint > pointingDistThreshold)
         return true;
     else
         return false;
 }
 
-double computePointingAngle(Agent* agent, std::string pointingJoint) {
+double computePointingAngle(const PoseSnapshot_t& body, const PoseSnapshot_t& joint) {
     // If joint has orientation, use it
-    double orientation = agent->skeleton_[pointingJoint]->orientation_[2];
+    double orientation = joint.orientation[2];
     if (orientation != 0.0)
         return orientation;
     else
-        return acos(fabs(agent->getPosition().get<0>() - agent->skeleton_[pointingJoint]->getPosition().get<0>())
-            / bg::distance(MathFunctions::convert3dTo2d(agent->getPosition()),
-            MathFunctions::convert3dTo2d(agent->skeleton_[pointingJoint]->getPosition())));
+        return acos(fabs(body.position[0] - joint.position[0])
+            / Motion2D::distance2D(body, joint));
 }
 
-std::map<std::string, double> computePointingToward(std::map<std::string, TRBuffer < Entity* > > mapEnts,
-        std::string pointingAgent, std::string pointingJoint, unsigned long timePointing,
+std::map<std::string, double> computePointingToward(const std::map<std::string, EntityHistory>& mapEnts,
+        const PoseSnapshot_t& joint, unsigned long timePointing,
         double towardAngle, double angleThreshold) {
     std::map<std::string, double> towardConfidence;
 
     // This parameter won't be used here...
     double angleResult = 0.0;
 
-
-    Agent* agent;
-    int index = mapEnts[pointingAgent].getIndexAfter(timePointing);
-    if (index != -1) {
-        agent = (Agent*) mapEnts[pointingAgent].getDataFromIndex(index);
-
-        //For each entities in the same room
-        for (std::map<std::string, TRBuffer < Entity*> >::iterator it = mapEnts.begin(); it != mapEnts.end(); ++it) {
-            Entity* curEnt;
-            int index = mapEnts[it->first].getIndexAfter(timePointing);
-            if (index != -1) {
-                curEnt = mapEnts[it->first].getDataFromIndex(index);
-                // Can the agent point himself?
-                //if (it->first != agentMonitored)
-                double curConf = MathFunctions::isInAngle(agent->skeleton_[pointingJoint],
-                        curEnt, towardAngle, angleThreshold, angleResult);
-                if (curConf > 0.0)
-                    towardConfidence[it->first] = curConf;
-            }
+    //For each entities in the same room
+    for (std::map<std::string, EntityHistory>::const_iterator it = mapEnts.begin(); it != mapEnts.end(); ++it) {
+        int index = it->second.getIndexAfter(timePointing);
+        if (index != -1) {
+            // Can the agent point himself?
+            //if (it->first != agentMonitored)
+            double curConf = Motion2D::isInAngle(joint, it->second.getBodyFromIndex(index),
+                    towardAngle, angleThreshold, angleResult);
+            if (curConf > 0.0)
+                towardConfidence[it->first] = curConf;
         }
-
-    } else
-        std::cout << "WARNING, no data to compute agent " << pointingAgent << " pointing" << std::endl;
+    }
 
     return towardConfidence;
 }
 
-std::map<std::string, double> computePointingToward(std::map<std::string, TRBuffer < Entity* > > mapEnts,
-        std::string pointingAgent, std::string pointingJoint, double towardAngle, double angleThreshold) {
+std::map<std::string, double> computePointingToward(const std::map<std::string, EntityHistory>& mapEnts,
+        const PoseSnapshot_t& joint, double towardAngle, double angleThreshold) {
     std::map<std::string, double> towardConfidence;
 
     // This parameter won't be used here...
     double angleResult = 0.0;
 
-    Agent* agent = (Agent*) mapEnts[pointingAgent].back();
-
     //For each entities in the same room
-    for (std::map<std::string, TRBuffer < Entity*> >::iterator it = mapEnts.begin(); it != mapEnts.end(); ++it) {
-        Entity* curEnt = mapEnts[it->first].back();
+    for (std::map<std::string, EntityHistory>::const_iterator it = mapEnts.begin(); it != mapEnts.end(); ++it) {
+        if (it->second.empty())
+            continue;
         // Can the agent point himself?
         //if (it->first != agentMonitored)
-        double curConf = MathFunctions::isInAngle(agent->skeleton_[pointingJoint], curEnt,
+        double curConf = Motion2D::isInAngle(joint, it->second.back(),
                 towardAngle, angleThreshold, angleResult);
         if (curConf > 0.0)
             towardConfidence[it->first] = curConf;
@@ -181,15 +190,26 @@ bool pointingTowardTimeRequest(toaster_msgs::PointingTime::Request &req,
     if (req.pointingJoint != "") {
         res.answer = true;
 
-        Agent* agent;
-        int index = agentsMonitor_.mapTRBEntity_[req.pointingAgentId].getIndexAfter(req.timePointing);
+        // The main loop only writes the histories under the exclusive lock
+        boost::shared_lock<boost::shared_mutex> lock(historyMutex_);
+
+        std::map<std::string, EntityHistory>::const_iterator itAgent = agentsMonitor_.mapEntityHistory_.find(req.pointingAgentId);
+        if (itAgent == agentsMonitor_.mapEntityHistory_.end()) {
+            ROS_INFO("[agent_monitor][Request][WARNING] no data to compute agent %s pointing", req.pointingAgentId.c_str());
+            return true;
+        }
+
+        int index = itAgent->second.getIndexAfter(req.timePointing);
         if (index != -1) {
-            agent = (Agent*) agentsMonitor_.mapTRBEntity_[req.pointingAgentId].getDataFromIndex(index);
-            if (isPointing(agent, req.pointingJoint, req.pointingJointDistThreshold)) {
+            const PoseSnapshot_t& body = itAgent->second.getBodyFromIndex(index);
+            const PoseSnapshot_t* joint = itAgent->second.getPose(index, req.pointingJoint);
+            if (joint == NULL)
+                ROS_INFO("[agent_monitor][Request][WARNING] agent %s has no joint %s", req.pointingAgentId.c_str(), req.pointingJoint.c_str());
+            else if (isPointing(body, *joint, req.pointingJointDistThreshold)) {
                 double towardAngle = 0.0;
                 std::map < std::string, double> towardEnts;
-                towardAngle = computePointingAngle(agent, req.pointingJoint);
-                towardEnts = computePointingToward(agentsMonitor_.mapTRBEntity_, req.pointingAgentId, req.pointingJoint, req.timePointing, towardAngle, req.angleThreshold);
+                towardAngle = computePointingAngle(body, *joint);
+                towardEnts = computePointingToward(agentsMonitor_.mapEntityHistory_, *joint, req.timePointing, towardAngle, req.angleThreshold);
 
                 // Export result
                 for (std::map < std::string, double>::iterator it = towardEnts.begin(); it != towardEnts.end(); ++it) {
@@ -197,7 +217,8 @@ bool pointingTowardTimeRequest(toaster_msgs::PointingTime::Request &req,
                     res.confidence.push_back(it->second);
                 }
             }
-        }
+        } else
+            ROS_INFO("[agent_monitor][Request][WARNING] no data to compute agent %s pointing", req.pointingAgentId.c_str());
         return true;
     }
 }
@@ -215,13 +236,24 @@ bool pointingTowardRequest(toaster_msgs::Pointing::Request &req,
     if (req.pointingJoint != "") {
         res.answer = true;
 
-        // TODO: check if agent is tracked
-        Agent* agent = (Agent*) agentsMonitor_.mapTRBEntity_[req.pointingAgentId].back();
-        if (isPointing(agent, req.pointingJoint, req.pointingJointDistThreshold)) {
+        // The main loop only writes the histories under the exclusive lock
+        boost::shared_lock<boost::shared_mutex> lock(historyMutex_);
+
+        std::map<std::string, EntityHistory>::const_iterator itAgent = agentsMonitor_.mapEntityHistory_.find(req.pointingAgentId);
+        if (itAgent == agentsMonitor_.mapEntityHistory_.end() || itAgent->second.empty()) {
+            ROS_INFO("[agent_monitor][Request][WARNING] no data to compute agent %s pointing", req.pointingAgentId.c_str());
+            return true;
+        }
+
+        const PoseSnapshot_t& body = itAgent->second.back();
+        const PoseSnapshot_t* joint = itAgent->second.getPose(itAgent->second.size() - 1, req.pointingJoint);
+        if (joint == NULL)
+            ROS_INFO("[agent_monitor][Request][WARNING] agent %s has no joint %s", req.pointingAgentId.c_str(), req.pointingJoint.c_str());
+        else if (isPointing(body, *joint, req.pointingJointDistThreshold)) {
             double towardAngle = 0.0;
             std::map < std::string, double> towardEnts;
-            towardAngle = computePointingAngle(agent, req.pointingJoint);
-            towardEnts = computePointingToward(agentsMonitor_.mapTRBEntity_, req.pointingAgentId, req.pointingJoint, towardAngle, req.angleThreshold);
+            towardAngle = computePointingAngle(body, *joint);
+            towardEnts = computePointingToward(agentsMonitor_.mapEntityHistory_, *joint, towardAngle, req.angleThreshold);
 
             // Export result
             for (std::map < std::string, double>::iterator it = towardEnts.begin(); it != towardEnts.end(); ++it) {
@@ -233,26 +265,220 @@ bool pointingTowardRequest(toaster_msgs::Pointing::Request &req,
     }
 }
 
+/****************************************************
+ * @brief : Predicts the position of agents.
+ * Answered from the spinner threads, without the
+ * kernel of the main loop.
+ ****************************************************/
+bool predictMotionRequest(toaster_msgs::PredictMotion::Request &req,
+        toaster_msgs::PredictMotion::Response & res) {
+
+    std::vector<double> horizons = req.horizons.empty() ? predictionHorizons_ : req.horizons;
+    for (std::vector<double>::iterator it = horizons.begin(); it != horizons.end(); ++it) {
+        if (*it < 0.0) {
+            ROS_INFO("[agent_monitor][Request][WARNING] request to predict motion with a negative horizon, sending back response: false");
+            res.answer = false;
+            return true;
+        }
+    }
+
+    // The main loop only writes the histories and the parameters under the exclusive lock
+    boost::shared_lock<boost::shared_mutex> lock(historyMutex_);
+
+    const std::vector<std::string>& agentIds = req.agentIds.empty() ? agentsMonitor_.agentsMonitored_ : req.agentIds;
+    res.answer = true;
+    res.predictions.header.stamp = ros::Time::now();
+    for (std::vector<std::string>::const_iterator it = agentIds.begin(); it != agentIds.end(); ++it) {
+        toaster_msgs::Prediction prediction;
+        if (MotionPredictor::predict(agentsMonitor_.mapEntityHistory_, *it, horizons, motionTwd2DBodyAngleThresold_,
+                                     distFar_, agentsMonitor_.motionNoise_.bodyAcceleration, NULL, prediction))
+            res.predictions.predictionList.push_back(prediction);
+        else {
+            ROS_INFO("[agent_monitor][Request][WARNING] no data to predict agent %s motion", it->c_str());
+            res.answer = false;
+        }
+    }
+    return true;
+}
+
+/****************************************************
+ * @brief : Computes the facts of a monitored agent.
+ * Called from the worker threads, it only reads the
+ * histories and the kernel of the loop. Only the
+ * families in due are computed, in familyFacts.
+ ****************************************************/
+void computeAgentFacts(const std::string& agentId, Agent* agentMonitored, const MotionKernel& motionKernel,
+        int body, const std::vector<std::pair<std::string, int> >& joints, const std::vector<bool>& due,
+        std::vector<toaster_msgs::FactList>& familyFacts) {
+    toaster_msgs::Fact fact_msg;
+
+    ROS_DEBUG("[agent_monitor] computing facts for agent %s\n", agentId.c_str());
+
+    //looking facts
+    if (due[LOOKING_FACTS])
+      agentsMonitor_.computeLookingFacts(agentMonitored, motionKernel, lookTwdDeltaDist_, lookTwdAngularAperture_,
+              lookOcclusion_ ? lookOccluderRadius_ : 0.0, familyFacts[LOOKING_FACTS]);
+
+    // If the agent is moving
+    double speed = (body != -1) ? motionKernel.getSpeed(body) : 0.0;
+    if (speed > (motion2DBodySpeedThreshold_)) //if in movement
+    {
+      toaster_msgs::Fact fact_base = FactCreator::setFactBase(agentId, agentsMonitor_.mapEntityHistory_);
+
+      //Fact moving
+      if (due[MOTION_FACTS])
+      {
+        fact_msg = FactCreator::setMotionFact(fact_base, speed, 5.0);
+        familyFacts[MOTION_FACTS].factList.push_back(fact_msg);
+      }
+
+      if (due[TOWARD_FACTS])
+      {
+        // We compute the direction toward fact:
+        for (unsigned int r = 0; r < motionKernel.getNbRelations(body); r++)
+        {
+          int target = motionKernel.getRelationTarget(body, r);
+          double toward = motionKernel.getToward(body, r);
+          if (target != motionKernel.getSelfTarget(body) && toward > 0.0 && toward > movingTwdBodyDeltaDistThreshold_)
+          {
+            //Fact moving toward
+            fact_msg = FactCreator::setDirectionFact(fact_base, motionKernel.getTargetId(target), toward);
+            familyFacts[TOWARD_FACTS].factList.push_back(fact_msg);
+          }
+        }
+
+        // We compute /_\distance toward entities
+        for (unsigned int r = 0; r < motionKernel.getNbRelations(body); r++)
+        {
+          int target = motionKernel.getRelationTarget(body, r);
+          double deltaDist = motionKernel.getDeltaDist(body, r);
+          if (target != motionKernel.getSelfTarget(body) && deltaDist > movingTwdBodyDeltaDistThreshold_)
+          {
+            //Fact moving toward
+            fact_msg = FactCreator::setDistanceFact(fact_base, motionKernel.getTargetId(target), deltaDist);
+            familyFacts[TOWARD_FACTS].factList.push_back(fact_msg);
+          }
+        }
+      }
+    }
+    else // If agent is not moving, we compute his joint motion
+    {
+        double dist3D;
+        std::string dist3DString;
+
+        // What is the distance between joints and objects?
+        for (std::vector<std::pair<std::string, int> >::const_iterator itJnt = joints.begin(); itJnt != joints.end(); ++itJnt)
+        {
+            int joint = itJnt->second;
+            std::map<std::string, Joint*>::iterator itSkel = agentMonitored->skeleton_.find(itJnt->first);
+            if(itSkel == agentMonitored->skeleton_.end() || itSkel->second == nullptr)
+              continue; // emulated join
+
+            toaster_msgs::Fact fact_base = FactCreator::setFactBase(itSkel->second);
+            for (unsigned int r = 0; due[DISTANCE_FACTS] && r < motionKernel.getNbRelations(joint); r++)
+            {
+                // if in same room as monitored agent and not monitored joint
+                //if ((roomOfInterest == it->second.back()->getRoomId()) && (it->first != jointsMonitoredId[i])) {
+                dist3D = motionKernel.getDistance(joint, r);
+
+                if (dist3D < distReach_)
+                    dist3DString = "reach";
+                else if (dist3D < distClose_)
+                    dist3DString = "close";
+                else if (dist3D < distMedium_)
+                    dist3DString = "medium";
+                else if (dist3D < distFar_)
+                    dist3DString = "far";
+                else
+                    dist3DString = "out";
+
+                //Fact distance
+                fact_msg = fact_base;
+                fact_msg.property = "Distance";
+                fact_msg.propertyType = "position";
+                fact_msg.subProperty = "3D";
+                fact_msg.targetId = motionKernel.getTargetId(motionKernel.getRelationTarget(joint, r));
+
+                fact_msg.valueType = 0;
+                fact_msg.stringValue = dist3DString;
+                fact_msg.doubleValue = dist3D;
+                fact_msg.confidence = 0.90;
+
+                familyFacts[DISTANCE_FACTS].factList.push_back(fact_msg);
+                //}
+            }
+            // Is the joint moving?
+            speed = motionKernel.getSpeed(joint);
+
+            //We consider motion when it moves more than 3 cm during 1/4 second, so when higher than 0.12 m/s
+            if (speed > (motion2DJointSpeedThreshold_))
+            {
+                //Fact moving
+                if (due[MOTION_FACTS])
+                {
+                  fact_msg = fact_base;
+                  fact_msg = FactCreator::setMotionFact(fact_msg, speed, 20.0, "joint");
+                  familyFacts[MOTION_FACTS].factList.push_back(fact_msg);
+                }
+
+                if (!due[TOWARD_FACTS])
+                  continue;
+
+                // We compute the direction toward fact:
+                for (unsigned int r = 0; r < motionKernel.getNbRelations(joint); r++)
+                {
+                  int target = motionKernel.getRelationTarget(joint, r);
+                  double toward = motionKernel.getToward(joint, r);
+                  if (target != motionKernel.getSelfTarget(joint) && toward > 0.0)
+                  {
+                    fact_msg = fact_base;
+                    fact_msg = FactCreator::setDirectionFact(fact_msg, motionKernel.getTargetId(target), toward);
+                    familyFacts[TOWARD_FACTS].factList.push_back(fact_msg);
+                  }
+                }
+
+                // Then we compute /_\distance, joints facts keep the distance increase
+                for (unsigned int r = 0; r < motionKernel.getNbRelations(joint); r++)
+                {
+                  int target = motionKernel.getRelationTarget(joint, r);
+                  double deltaDist = -motionKernel.getDeltaDist(joint, r);
+                  if (target != motionKernel.getSelfTarget(joint) && deltaDist > movingTwdJointDeltaDistThreshold_)
+                  {
+                    fact_msg = fact_base;
+                    fact_msg = FactCreator::setDistanceFact(fact_msg, motionKernel.getTargetId(target), deltaDist);
+                    familyFacts[TOWARD_FACTS].factList.push_back(fact_msg);
+                  }
+                }
+            } // Joint moving
+        } // All monitored joints
+    } // Joints or full agent?
+}
+
 /****************************************************
  * @brief : Update reactive parameters
  ****************************************************/
 void dynParamCallback(agent_monitor::agent_monitorConfig &config, uint32_t level) {
+    // Prediction requests read the motion parameters from the spinner threads, under the shared lock
+    boost::unique_lock<boost::shared_mutex> lock(historyMutex_);
+
     lookTwdDeltaDist_ = config.lookTwdDeltaDist;
     lookTwdAngularAperture_ = config.lookTwdAngularAperture;
+    lookOcclusion_ = config.lookOcclusion;
+    lookOccluderRadius_ = config.lookOccluderRadius;
+
+    agentsMonitor_.motionNoise_.bodyAcceleration = config.filterBodyAccelerationNoise;
+    agentsMonitor_.motionNoise_.jointAcceleration = config.filterJointAccelerationNoise;
+    agentsMonitor_.motionNoise_.position = config.filterPositionNoise;
 
-    motion2DBodyTime_ = (unsigned long) (config.motion2DBodyTime * oneSecond_);
     motion2DBodySpeedThreshold_ = config.motion2DBodySpeedThreshold; // this is in m/s
 
-    motion2DBodyDirTime_ = (unsigned long) (config.motion2DBodyDirTime * oneSecond_);
     motionTwd2DBodyAngleThresold_ = config.motionTwd2DBodyAngleThresold;
 
     motionTwdBodyDeltaDistTime_ = (unsigned long) (config.motionTwdBodyDeltaDistTime * oneSecond_);
     movingTwdBodyDeltaDistThreshold_ = config.movingTwdBodyDeltaDistThreshold * movingTwdBodyDeltaDistThreshold_ / oneSecond_; // this is in m
 
-    motion2DJointTime_ = (unsigned long) (config.motion2DJointTime * oneSecond_);
     motion2DJointSpeedThreshold_ = config.motion2DJointSpeedThreshold; // this is in m
 
-    motion2DJointDirTime_ = (unsigned long) (config.motion2DJointDirTime * oneSecond_);
     motionTwd2DJointAngleThresold_ = config.motionTwd2DJointAngleThresold;
 
     motionTwdJointDeltaDistTime_ = (unsigned long) (config.motionTwdJointDeltaDistTime * oneSecond_);
@@ -262,13 +488,18 @@ void dynParamCallback(agent_monitor::agent_monitorConfig &config, uint32_t level
     distClose_ = config.distClose;
     distMedium_ = config.distMedium;
     distFar_ = config.distFar;
+
+    factScheduler_.setRate(LOOKING_FACTS, config.lookingRate);
+    factScheduler_.setRate(MOTION_FACTS, config.motionRate);
+    factScheduler_.setRate(TOWARD_FACTS, config.towardRate);
+    factScheduler_.setRate(DISTANCE_FACTS, config.distanceRate);
 }
 
 /////////////////////
 /////// Main ////////
 /////////////////////
 
-int main(int argc, char** argv) {
+int run(ros::NodeHandle& node, ros::NodeHandle& privateNode) {
     // Set this in a ros param
     const bool HUMAN_FULL_CONFIG = true; //If false we will use only position and orientation
     const bool ROBOT_FULL_CONFIG = true;
@@ -283,9 +514,6 @@ int main(int argc, char** argv) {
     //std::vector < unsigned int > jointsMonitoredId(1, 0);
     //bool humanMonitored = agentMonitored - 100;
 
-    ros::init(argc, argv, "agent_monitor");
-    ros::NodeHandle node;
-
     // TODO: add area_manager data reading to get the room of entities.
     //Data reading
     ToasterHumanReader humanRd(node, HUMAN_FULL_CONFIG);
@@ -295,205 +523,242 @@ int main(int argc, char** argv) {
     ToasterObjectReader objectRd(node);
     std::map<std::string, Object*> objectsMap;
 
-    ParamServer_t monitoring_dyn_param_srv;
+    ParamServer_t monitoring_dyn_param_srv(privateNode);
     monitoring_dyn_param_srv.setCallback(boost::bind(&dynParamCallback, _1, _2));
 
+    // Number of threads used to compute the facts of the agents and to answer pointing requests
+    int nbThreads = std::thread::hardware_concurrency();
+    if (node.hasParam("/agent_monitor/nbThreads"))
+        node.getParam("/agent_monitor/nbThreads", nbThreads);
+    if (nbThreads < 1)
+        nbThreads = 1;
+    ROS_INFO("[agent_monitor] Using %d threads", nbThreads);
+
+    ThreadPool agentPool(nbThreads);
+
     //Services
-    ros::ServiceServer servicePointingTime = node.advertiseService("agent_monitor/pointing_time", pointingTowardTimeRequest);
+    // Pointing requests are answered on their own queue so that
+    // they are not delayed by the fact computation of the main loop.
+    ros::CallbackQueue pointingQueue;
+
+    ros::AdvertiseServiceOptions pointingTimeOpts = ros::AdvertiseServiceOptions::create<toaster_msgs::PointingTime>(
+            "agent_monitor/pointing_time", pointingTowardTimeRequest, ros::VoidConstPtr(), &pointingQueue);
+    ros::ServiceServer servicePointingTime = node.advertiseService(pointingTimeOpts);
     ROS_INFO("[Request] Ready to receive timed request for pointing.");
 
-    ros::ServiceServer servicePointing = node.advertiseService("agent_monitor/pointing", pointingTowardRequest);
+    ros::AdvertiseServiceOptions pointingOpts = ros::AdvertiseServiceOptions::create<toaster_msgs::Pointing>(
+            "agent_monitor/pointing", pointingTowardRequest, ros::VoidConstPtr(), &pointingQueue);
+    ros::ServiceServer servicePointing = node.advertiseService(pointingOpts);
     ROS_INFO("[Request] Ready to receive request for pointing.");
 
+    ros::AdvertiseServiceOptions predictOpts = ros::AdvertiseServiceOptions::create<toaster_msgs::PredictMotion>(
+            "agent_monitor/predict_motion", predictMotionRequest, ros::VoidConstPtr(), &pointingQueue);
+    ros::ServiceServer servicePredict = node.advertiseService(predictOpts);
+    ROS_INFO("[Request] Ready to receive request for motion prediction.");
+
+    ros::AsyncSpinner pointingSpinner(nbThreads, &pointingQueue);
+    pointingSpinner.start();
 
     agentsMonitor_.init(&node);
+    // Readers update their entities in place, the monitor keeps its own history
+    agentsMonitor_.setHumanReader(humanRd);
+    agentsMonitor_.setRobotReader(robotRd);
+    agentsMonitor_.setObjectReader(objectRd);
 
     ros::Publisher fact_pub = node.advertise<toaster_msgs::FactList>("agent_monitor/factList", 1000);
+    ros::Publisher prediction_pub = node.advertise<toaster_msgs::PredictionList>("agent_monitor/predictions", 1000);
+
+    if (node.hasParam("/agent_monitor/predictionHorizons"))
+        node.getParam("/agent_monitor/predictionHorizons", predictionHorizons_);
+
+    MotionKernel motionKernel;
+
+    // Toward and distance facts are only computed for bodies and joints in a given motion state
+    factScheduler_.addDependency(TOWARD_FACTS, MOTION_FACTS);
+    factScheduler_.addDependency(DISTANCE_FACTS, MOTION_FACTS);
 
     // Set this in a ros service?
     ros::Rate loop_rate(30);
 
+    // Global queue for the executable, queue of the nodelet otherwise
+    ros::CallbackQueue* queue = static_cast<ros::CallbackQueue*>(node.getCallbackQueue());
+
     /************************/
     /* Start of the Ros loop*/
     /************************/
 
     while (node.ok())
     {
-      toaster_msgs::FactList factList_msg;
-      toaster_msgs::FactList agentFactList_msg;
-      toaster_msgs::Fact fact_msg;
+      // Published by pointer: nodelets of the same manager receive them without copy
+      toaster_msgs::FactListPtr factList_msg(new toaster_msgs::FactList);
       // We received agentMonitored
 
-      //////////////////////////////////////
-      //           Updating data          //
-      //////////////////////////////////////
-      agentsMonitor_.setHumanMap(humanRd.lastConfig_);
-      humanRd.clear();
-      agentsMonitor_.setRobotMap(robotRd.lastConfig_);
-      robotRd.clear();
-      agentsMonitor_.setObjectMap(objectRd.lastConfig_);
-      objectRd.clear();
+      // Histories are frozen for the rest of the loop, pointing requests wait for the update
+      std::vector<Agent*> updatedAgents;
+      {
+        boost::unique_lock<boost::shared_mutex> lock(historyMutex_);
 
-      agentsMonitor_.updateMonitored();
+        //////////////////////////////////////
+        //           Updating data          //
+        //////////////////////////////////////
+        agentsMonitor_.updateMonitored();
+        updatedAgents.assign(agentsMonitor_.agentsMonitored_.size(), nullptr);
 
-      /////////////////////////////////////
-      // Update TRBuffer for each entity //
-      /////////////////////////////////////
+        /////////////////////////////////////
+        // Update TRBuffer for each entity //
+        /////////////////////////////////////
 
-      agentsMonitor_.updateUnmonitoredEntitieTRBuffer();
+        agentsMonitor_.updateUnmonitoredEntitieTRBuffer();
 
-        // All the following computation are done for each monitored agents!
-        for (std::vector<std::string>::iterator itAgnt = agentsMonitor_.agentsMonitored_.begin(); itAgnt != agentsMonitor_.agentsMonitored_.end(); ++itAgnt)
+        // Update the history of monitored agents first, so that relations use the poses of this loop
+        for (unsigned int i = 0; i < agentsMonitor_.agentsMonitored_.size(); i++)
         {
-            Agent* agentMonitored = agentsMonitor_.getMonitoredAgent((*itAgnt));
+            Agent* agentMonitored = agentsMonitor_.getMonitoredAgent(agentsMonitor_.agentsMonitored_[i]);
 
             if(agentMonitored == nullptr)
-              continue; // object
+              continue; // object, or agent not present
 
             // We verify if the buffer is already there...
-            if(!agentsMonitor_.updateAgentTRBuffer(agentMonitored))
-            {
-              factList_msg.factList.insert(factList_msg.factList.end(), previousAgentsFactList_[*itAgnt].begin(), previousAgentsFactList_[*itAgnt].end());
+            if(agentsMonitor_.updateAgentTRBuffer(agentMonitored))
+              updatedAgents[i] = agentMonitored;
+        }
+      }
+
+        ///////////////////////////////////////////
+        // Gather monitored bodies and joints    //
+        ///////////////////////////////////////////
+
+        // Relations are only computed for entities closer than distFar_
+        motionKernel.setTargets(agentsMonitor_.mapEntityHistory_, distFar_);
+        motionKernel.clearSubjects();
+
+        factScheduler_.update(ros::Time::now().toSec());
+        bool computeRelations = false;
+
+        std::vector<int> bodySubjects(agentsMonitor_.agentsMonitored_.size(), -1);
+        std::vector<std::vector<std::pair<std::string, int> > > jointSubjects(agentsMonitor_.agentsMonitored_.size());
+        std::vector<std::vector<bool> > agentsDue(agentsMonitor_.agentsMonitored_.size());
+        for (unsigned int i = 0; i < agentsMonitor_.agentsMonitored_.size(); i++)
+        {
+            if (updatedAgents[i] == nullptr)
               continue;
-            }
 
-            //////////////////////////////////////////////
-            // Compute facts concerning monitored agent //
-            //////////////////////////////////////////////
+            const std::string& agentId = agentsMonitor_.agentsMonitored_[i];
+            const EntityHistory& agentHistory = agentsMonitor_.mapEntityHistory_.find(agentId)->second;
+            bodySubjects[i] = motionKernel.addSubject(agentId, agentHistory, EntityHistory::BODY_SLOT,
+                                                      motionTwdBodyDeltaDistTime_, motionTwd2DBodyAngleThresold_);
+            bool moving = bodySubjects[i] != -1 && motionKernel.getSpeed(bodySubjects[i]) > motion2DBodySpeedThreshold_;
+
+            // Carried facts of the previous motion state are replaced at once
+            std::map<std::string, bool>::iterator itMoving = previousAgentsMoving_.find(agentId);
+            bool motionChanged = itMoving == previousAgentsMoving_.end() || itMoving->second != moving;
+            previousAgentsMoving_[agentId] = moving;
 
-            ROS_DEBUG("[agent_monitor] computing facts for agent %s\n", (*itAgnt).c_str());
+            agentsDue[i].resize(NB_FACT_FAMILIES);
+            for (unsigned int f = 0; f < NB_FACT_FAMILIES; f++)
+              agentsDue[i][f] = factScheduler_.isDue((FactFamily_t) f) || (motionChanged && f != LOOKING_FACTS);
+            computeRelations = computeRelations || agentsDue[i][TOWARD_FACTS] || agentsDue[i][DISTANCE_FACTS];
 
-            //looking facts
-            agentsMonitor_.computeLookingFacts(agentMonitored, lookTwdDeltaDist_, lookTwdAngularAperture_, factList_msg);
+            // If agent is not moving, we compute his joint motion
+            if (moving)
+              continue;
+
+            std::map<std::string, std::vector<std::pair<std::string, int> > >::const_iterator itSlots =
+                agentsMonitor_.mapAgentToJointSlots_.find(agentId);
+            if (itSlots == agentsMonitor_.mapAgentToJointSlots_.end())
+              continue;
 
-            std::map<std::string, double> mapIdValue;
-            // If the agent is moving
-            double speed = Motion2D::compute(agentsMonitor_.mapTRBEntity_[(*itAgnt)], motion2DBodyTime_);
-            if (speed > (motion2DBodySpeedThreshold_)) //if in movement
+            for (std::vector<std::pair<std::string, int> >::const_iterator itJnt = itSlots->second.begin(); itJnt != itSlots->second.end(); ++itJnt)
             {
-              toaster_msgs::Fact fact_base = FactCreator::setFactBase((*itAgnt), agentsMonitor_.mapTRBEntity_);
+                int subject = motionKernel.addSubject(agentId, agentHistory, itJnt->second,
+                                                      motionTwdJointDeltaDistTime_, motionTwd2DJointAngleThresold_);
+                if (subject != -1)
+                  jointSubjects[i].push_back(std::make_pair(itJnt->first, subject));
+            }
+        }
 
-              //Fact moving
-              fact_msg = FactCreator::setMotionFact(fact_base, speed, 5.0);
-              agentFactList_msg.factList.push_back(fact_msg);
+        // Pairwise relations are only needed by toward and distance facts
+        if (computeRelations)
+          motionKernel.compute();
 
-                // We compute the direction toward fact:
-                double angleDirection = Motion2D::computeDirection(agentsMonitor_.mapTRBEntity_[(*itAgnt)], motion2DBodyDirTime_);
-                mapIdValue = Motion2D::computeToward(agentsMonitor_.mapTRBEntity_, (*itAgnt), angleDirection, motionTwd2DBodyAngleThresold_);
+        // All the following computation are done for each monitored agents!
+        unsigned int nbAgents = agentsMonitor_.agentsMonitored_.size();
+        std::vector<std::vector<toaster_msgs::FactList> > agentFacts(nbAgents, std::vector<toaster_msgs::FactList>(NB_FACT_FAMILIES));
+        agentPool.run(nbAgents, [&](unsigned int i) {
+            if (updatedAgents[i] != nullptr)
+              computeAgentFacts(agentsMonitor_.agentsMonitored_[i], updatedAgents[i], motionKernel,
+                                bodySubjects[i], jointSubjects[i], agentsDue[i], agentFacts[i]);
+        });
+
+        // Merge in the order of the monitored agents
+        for (unsigned int i = 0; i < nbAgents; i++)
+        {
+            const std::string& agentId = agentsMonitor_.agentsMonitored_[i];
 
-                for (std::map<std::string, double>::iterator it = mapIdValue.begin(); it != mapIdValue.end(); ++it)
-                {
-                  if (it->second > movingTwdBodyDeltaDistThreshold_)
-                  {
-                    //Fact moving toward
-                    fact_msg = FactCreator::setDirectionFact(fact_base, it->first, it->second);
-                    agentFactList_msg.factList.push_back(fact_msg);
-                  }
-                }
+            // Facts of agents not present anymore are not carried forward
+            if (agentsMonitor_.getMonitoredAgent(agentId) == nullptr)
+            {
+                previousAgentsFactList_.erase(agentId);
+                previousAgentsMoving_.erase(agentId);
+                continue;
+            }
+
+            std::vector<std::vector<toaster_msgs::Fact> >& previousFacts = previousAgentsFactList_[agentId];
+            previousFacts.resize(NB_FACT_FAMILIES);
 
-                // We compute /_\distance toward entities
-                mapIdValue = Distances::computeDeltaDist(agentsMonitor_.mapTRBEntity_, (*itAgnt), motionTwdBodyDeltaDistTime_);
-                for (std::map<std::string, double>::iterator it = mapIdValue.begin(); it != mapIdValue.end(); ++it)
+            for (unsigned int f = 0; f < NB_FACT_FAMILIES; f++)
+            {
+                if (updatedAgents[i] == nullptr)
                 {
-                  if (it->second > movingTwdBodyDeltaDistThreshold_)
-                  {
-                    //Fact moving toward
-                    fact_msg = FactCreator::setDistanceFact(fact_base, it->first, it->second);
-                    agentFactList_msg.factList.push_back(fact_msg);
-                  }
+                  // No new data: agent facts are published again, looking facts are not
+                  if (f == LOOKING_FACTS)
+                    continue;
                 }
-            }
-            else // If agent is not moving, we compute his joint motion
-            {
-                double dist3D;
-                std::string dist3DString;
+                else if (agentsDue[i][f])
+                  previousFacts[f].swap(agentFacts[i][f].factList);
 
-                // What is the distance between joints and objects?
-                for (std::vector<std::string>::iterator itJnt = agentsMonitor_.mapAgentToJointsMonitored_[(*itAgnt)].begin(); itJnt != agentsMonitor_.mapAgentToJointsMonitored_[(*itAgnt)].end(); ++itJnt)
-                {
-                    Joint* curMonitoredJnt = ((Agent*) agentsMonitor_.mapTRBEntity_[(*itAgnt)].back())->skeleton_[(*itJnt)];
-                    if(curMonitoredJnt == nullptr)
-                      continue; // emulated join
-
-                    toaster_msgs::Fact fact_base = FactCreator::setFactBase(curMonitoredJnt);
-                    for (std::map<std::string, TRBuffer < Entity*> >::iterator itEnt = agentsMonitor_.mapTRBEntity_.begin(); itEnt != agentsMonitor_.mapTRBEntity_.end(); ++itEnt)
-                    {
-                        // if in same room as monitored agent and not monitored joint
-                        //if ((roomOfInterest == it->second.back()->getRoomId()) && (it->first != jointsMonitoredId[i])) {
-                        dist3D = bg::distance(curMonitoredJnt->getPosition(), itEnt->second.back()->getPosition());
-
-                        if (dist3D < distReach_)
-                            dist3DString = "reach";
-                        else if (dist3D < distClose_)
-                            dist3DString = "close";
-                        else if (dist3D < distMedium_)
-                            dist3DString = "medium";
-                        else if (dist3D < distFar_)
-                            dist3DString = "far";
-                        else
-                            dist3DString = "out";
-
-                        //Fact distance
-                        fact_msg = fact_base;
-                        fact_msg.property = "Distance";
-                        fact_msg.propertyType = "position";
-                        fact_msg.subProperty = "3D";
-                        fact_msg.targetId = itEnt->first;
-
-                        fact_msg.valueType = 0;
-                        fact_msg.stringValue = dist3DString;
-                        fact_msg.doubleValue = dist3D;
-                        fact_msg.confidence = 0.90;
-
-                        agentFactList_msg.factList.push_back(fact_msg);
-                        //}
-                    }
-                    // Is the joint moving?
-                    speed = Motion2D::compute(agentsMonitor_.mapTRBEntity_[(*itAgnt)], motion2DJointTime_, (*itJnt));
-
-                    //We consider motion when it moves more than 3 cm during 1/4 second, so when higher than 0.12 m/s
-                    if (speed > (motion2DJointSpeedThreshold_))
-                    {
-                        //Fact moving
-                        fact_msg = fact_base;
-                        fact_msg = FactCreator::setMotionFact(fact_msg, speed, 20.0, "joint");
-                        agentFactList_msg.factList.push_back(fact_msg);
-
-                        // We compute the direction toward fact:
-                        double angleDirection = Motion2D::computeDirection(agentsMonitor_.mapTRBEntity_[(*itAgnt)], motion2DJointDirTime_, (*itJnt));
-                        mapIdValue = Motion2D::computeToward(agentsMonitor_.mapTRBEntity_, (*itAgnt), angleDirection, motionTwd2DJointAngleThresold_, (*itJnt));
-                        for (std::map<std::string, double>::iterator it = mapIdValue.begin(); it != mapIdValue.end(); ++it)
-                        {
-                          fact_msg = fact_base;
-                          fact_msg = FactCreator::setDirectionFact(fact_msg, it->first, it->second);
-                          agentFactList_msg.factList.push_back(fact_msg);
-                        }
-
-                        // Then we compute /_\distance
-                        mapIdValue = Distances::computeJointDeltaDist(agentsMonitor_.mapTRBEntity_, (*itAgnt), (*itJnt), motionTwdJointDeltaDistTime_);
-                        for (std::map<std::string, double>::iterator it = mapIdValue.begin(); it != mapIdValue.end(); ++it)
-                        {
-                          if (it->second > movingTwdJointDeltaDistThreshold_)
-                          {
-                            fact_msg = fact_base;
-                            fact_msg = FactCreator::setDistanceFact(fact_msg, it->first, it->second);
-                            agentFactList_msg.factList.push_back(fact_msg);
-                          }
-                        }
-                    } // Joint moving
-                } // All monitored joints
-            } // Joints or full agent?
-
-            previousAgentsFactList_[*itAgnt] = agentFactList_msg.factList;
-            factList_msg.factList.insert(factList_msg.factList.end(), agentFactList_msg.factList.begin(), agentFactList_msg.factList.end());
-            agentFactList_msg.factList.clear();
+                factList_msg->factList.insert(factList_msg->factList.end(), previousFacts[f].begin(), previousFacts[f].end());
+            }
         } // each monitored agents
 
+        // Agents not monitored anymore
+        for (std::map<std::string, std::vector<std::vector<toaster_msgs::Fact> > >::iterator it = previousAgentsFactList_.begin();
+             it != previousAgentsFactList_.end(); )
+        {
+            if (std::find(agentsMonitor_.agentsMonitored_.begin(), agentsMonitor_.agentsMonitored_.end(), it->first)
+                == agentsMonitor_.agentsMonitored_.end())
+            {
+                previousAgentsMoving_.erase(it->first);
+                it = previousAgentsFactList_.erase(it);
+            }
+            else
+                ++it;
+        }
+
         fact_pub.publish(factList_msg);
 
-        ros::spinOnce();
+        // Predictions of all monitored agents, in one pass
+        if (prediction_pub.getNumSubscribers() > 0)
+        {
+            toaster_msgs::PredictionListPtr predictionList_msg(new toaster_msgs::PredictionList);
+            predictionList_msg->header.stamp = ros::Time::now();
+            for (unsigned int i = 0; i < nbAgents; i++)
+            {
+                toaster_msgs::Prediction prediction;
+                if (agentsMonitor_.getMonitoredAgent(agentsMonitor_.agentsMonitored_[i]) != nullptr
+                    && MotionPredictor::predict(agentsMonitor_.mapEntityHistory_, agentsMonitor_.agentsMonitored_[i],
+                                                predictionHorizons_, motionTwd2DBodyAngleThresold_, distFar_,
+                                                agentsMonitor_.motionNoise_.bodyAcceleration, &motionKernel, prediction))
+                    predictionList_msg->predictionList.push_back(prediction);
+            }
+            prediction_pub.publish(predictionList_msg);
+        }
+
+        queue->callAvailable();
         loop_rate.sleep();
 
     }
     return 0;
 }
+
+} // namespace agent_monitor
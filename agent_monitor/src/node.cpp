@@ -0,0 +1,9 @@
+#include "AgentMonitorNode.h"
+
+int main(int argc, char** argv) {
+    ros::init(argc, argv, "agent_monitor");
+    ros::NodeHandle node;
+    ros::NodeHandle privateNode("~");
+
+    return agent_monitor::run(node, privateNode);
+}
@@ -0,0 +1,13 @@
+#include <pluginlib/class_list_macros.h>
+#include <toaster_msgs/LoopNodelet.h>
+
+#include "AgentMonitorNode.h"
+
+namespace agent_monitor
+{
+
+typedef LoopNodelet<&run> AgentMonitorNodelet;
+
+} // namespace agent_monitor
+
+PLUGINLIB_EXPORT_CLASS(agent_monitor::AgentMonitorNodelet, nodelet::Nodelet)
@@ -0,0 +1,21 @@
+/*
+ * File:   AreaManagerNode.h
+ *
+ * Loop of area_manager, run by the area_manager executable and by the
+ * area_manager/AreaManagerNodelet nodelet.
+ */
+
+#ifndef AREAMANAGERNODE_H
+#define	AREAMANAGERNODE_H
+
+#include <ros/ros.h>
+
+namespace area_manager {
+
+// Computes the area facts until node is shut down.
+// Callbacks run on the queue of node, privateNode is the private namespace of the node.
+int run(ros::NodeHandle& node, ros::NodeHandle& privateNode);
+
+} // namespace area_manager
+
+#endif /* AREAMANAGERNODE_H */
@@ -0,0 +1,63 @@
+/*
+ * File:   AreaMap.h
+ *
+ * Binary area map file.
+ * The file is a header, a table of fixed size area records, the polygon
+ * points and a pool of null terminated strings. Everything is laid out so
+ * that the file can be memory-mapped and read in place: polygon points are
+ * given to PolygonArea straight from the mapping.
+ */
+
+#ifndef AREAMAP_H
+#define	AREAMAP_H
+
+#include <map>
+#include <string>
+#include <stdint.h>
+
+class Area;
+
+#define AREA_MAP_MAGIC "TAREAMAP"
+#define AREA_MAP_VERSION 1
+
+struct AreaMapHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nbAreas;
+    uint32_t nbPoints;
+    uint32_t stringsSize;
+};
+
+struct AreaMapRecord {
+    uint32_t id;
+    uint32_t isCircle;
+    // Geometry is stored relative to the owner, as given to add_area
+    double center[3];
+    double ray;
+    double height;
+    double zmin;
+    double zmax;
+    double enterHysteresis;
+    double leaveHysteresis;
+    // Polygon points: index of the first point and number of points
+    uint32_t firstPoint;
+    uint32_t nbPoints;
+    // Offsets in the string pool
+    uint32_t name;
+    uint32_t myOwner;
+    uint32_t areaType;
+    uint32_t factType;
+    uint32_t entityType;
+    uint32_t padding;
+};
+
+// Writes all areas of mapArea in fileName. Returns false on IO error.
+bool saveAreaMap(const std::string& fileName, const std::map<unsigned int, Area*>& mapArea);
+
+// Maps fileName and creates one area per record in mapArea.
+// Areas with an id already used are replaced, areas with id 0 get a free id.
+// Returns false if the file cannot be read or is not a valid area map,
+// leaving mapArea untouched.
+bool loadAreaMap(const std::string& fileName, std::map<unsigned int, Area*>& mapArea, unsigned int& nbLoaded);
+
+#endif	/* AREAMAP_H */
@@ -0,0 +1,87 @@
+/*
+ * File:   AreaState.h
+ *
+ * Per (entity, area) membership state.
+ * After each geometric test we keep the result and the distance from the
+ * entity to the area boundary. As long as the entity could not have covered
+ * this distance at maxSpeed since the test, the state is reused and
+ * Area::isPointInArea is not called. Entities that are entering or leaving
+ * (hysteresis running in the area) are always tested.
+ * States are stored per area, in vectors indexed by an entity slot.
+ */
+
+#ifndef AREASTATE_H
+#define	AREASTATE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Area;
+class Entity;
+
+enum AreaMembershipState_t {
+    OUTSIDE_AREA,
+    ENTERING_AREA,
+    INSIDE_AREA,
+    LEAVING_AREA
+};
+
+struct AreaMembership_t {
+    // False until the entity of the slot is tested
+    bool known;
+    AreaMembershipState_t state;
+    // Distance to the area boundary at the last test, minus hysteresis margin
+    double margin;
+    // Entity time of the last test
+    unsigned long time;
+};
+
+// States of the entities for one area, indexed by entity slot
+struct AreaStates_t {
+    // Largest move of the area boundary due to its hysteresis
+    double hysteresisMargin;
+    std::vector<AreaMembership_t> entities;
+};
+
+class AreaStateCache {
+public:
+    // maxSpeed in m/s, 0 disables the cache
+    AreaStateCache(double maxSpeed = 0.0);
+
+    void setMaxSpeed(double maxSpeed) {
+        maxSpeed_ = maxSpeed;
+    }
+
+    // Slot of entity id, allocated at its first call
+    unsigned int addEntity(const std::string& id);
+
+    // Slot of entity id, false if it has none
+    bool findEntity(const std::string& id, unsigned int& slot) const;
+
+    // To call when an entity is not tracked anymore, its slot is reused
+    void removeEntity(const std::string& id);
+
+    // States of area, created at its first call
+    AreaStates_t& getArea(Area* area);
+
+    // Same result as area->isPointInArea(ent->getPosition(), ent->getId()),
+    // calling it only when the entity may have crossed the boundary.
+    // states are those of area given by getArea, slot the one of ent given by addEntity.
+    // Only states is modified: different areas can be tested in parallel.
+    bool isInArea(Entity* ent, unsigned int slot, Area* area, AreaStates_t& states) const;
+
+    // To call when an area is created, replaced or removed.
+    // clear() drops the states of all areas, entities keep their slot.
+    void removeArea(unsigned int areaId);
+    void clear();
+
+private:
+    double maxSpeed_;
+    std::map<std::string, unsigned int> slots_;
+    std::vector<unsigned int> freeSlots_;
+    unsigned int nbSlots_;
+    std::map<unsigned int, AreaStates_t> areas_;
+};
+
+#endif	/* AREASTATE_H */
@@ -0,0 +1,74 @@
+/*
+ * File:   Heatmap.h
+ *
+ * Occupancy heatmap on a 2D grid.
+ * Each cell accumulates the time spent by entities in it, decaying
+ * exponentially with decayTime. Dwell time is added to a cell when an entity
+ * leaves it, and for all entities when the map is published, so entities
+ * staying in their cell cost nothing between two publications.
+ * Decay is applied lazily through a common scale factor.
+ * All times are those of the entities: the map time is the newest one received.
+ * Entities are identified by a slot, tracks of entities gone are freed.
+ */
+
+#ifndef HEATMAP_H
+#define	HEATMAP_H
+
+#include <vector>
+
+#include "toaster_msgs/Heatmap.h"
+
+class Heatmap {
+public:
+    // Grid of width x height cells of resolution meters, with origin its lower left corner.
+    // decayTime in seconds.
+    Heatmap(double originX, double originY, unsigned int width, unsigned int height,
+            double resolution, double decayTime);
+
+    // Entity of slot seen at (x, y) at time (ns)
+    void updateEntity(unsigned int slot, double x, double y, unsigned long time);
+
+    // Entity of slot is gone, the slot can be given to another entity
+    void removeEntity(unsigned int slot);
+
+    // Newest entity time (ns), 0 if none was received
+    unsigned long getTime() const {
+        return time_;
+    }
+
+    // Adds the pending dwell time of all entities and frees the tracks of entities
+    // not seen for decayTime, then fills msg with the map at getTime().
+    // Cells are quantized on 255 levels of maxDwellTime and run length
+    // encoded: values[i] is repeated runLengths[i] times, row by row.
+    void fillMsg(toaster_msgs::Heatmap& msg);
+
+private:
+    struct Track_t {
+        bool used;
+        int cell;
+        // Time up to which dwell time was added
+        unsigned long since;
+        // Last time the entity was seen
+        unsigned long lastTime;
+    };
+
+    int cellIndex(double x, double y) const;
+    void addDwell(int cell, unsigned long from, unsigned long to);
+
+    double originX_;
+    double originY_;
+    unsigned int width_;
+    unsigned int height_;
+    double resolution_;
+    double decayTime_;
+
+    // Cell values are stored as value * exp((t - refTime_) / decayTime_)
+    std::vector<double> cells_;
+    unsigned long refTime_;
+    unsigned long time_;
+
+    // Indexed by slot
+    std::vector<Track_t> tracks_;
+};
+
+#endif	/* HEATMAP_H */
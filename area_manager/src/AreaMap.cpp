@@ -0,0 +1,219 @@
+/*
+ * File:   AreaMap.cpp
+ *
+ * Reading and writing of binary area maps, see AreaMap.h for the layout.
+ */
+
+#include "area_manager/AreaMap.h"
+
+#include "toaster-lib/CircleArea.h"
+#include "toaster-lib/PolygonArea.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Adds str to the pool, reusing a previous copy if any.
+uint32_t poolString(const std::string& str, std::string& pool, std::map<std::string, uint32_t>& offsets) {
+    std::map<std::string, uint32_t>::iterator it = offsets.find(str);
+    if (it != offsets.end())
+        return it->second;
+
+    uint32_t offset = pool.size();
+    pool.append(str.c_str(), str.size() + 1);
+    offsets[str] = offset;
+    return offset;
+}
+
+// Lowest id not used in mapArea, 0 being "no id"
+unsigned int freeId(const std::map<unsigned int, Area*>& mapArea) {
+    unsigned int id = 1;
+    for (std::map<unsigned int, Area*>::const_iterator it = mapArea.upper_bound(0); it != mapArea.end() && it->first == id; ++it)
+        id++;
+    return id;
+}
+
+Area* createArea(const AreaMapRecord& record, unsigned int id, const double (*points)[2], const char* strings) {
+    Area* area;
+    if (record.isCircle) {
+        bg::model::point<double, 3, bg::cs::cartesian> center(record.center[0], record.center[1], record.center[2]);
+        area = new CircleArea(id, center, record.ray, record.height, record.enterHysteresis, record.leaveHysteresis);
+    } else {
+        // Points are read in place from the mapping
+        area = new PolygonArea(id, const_cast<double (*)[2]>(points + record.firstPoint), record.nbPoints,
+                record.zmin, record.zmax, record.enterHysteresis, record.leaveHysteresis);
+    }
+
+    area->setIsCircle(record.isCircle);
+    area->setName(strings + record.name);
+    area->setMyOwner(strings + record.myOwner);
+    area->setAreaType(strings + record.areaType);
+    area->setFactType(strings + record.factType);
+    area->setEntityType(strings + record.entityType);
+    return area;
+}
+
+}
+
+bool saveAreaMap(const std::string& fileName, const std::map<unsigned int, Area*>& mapArea) {
+    std::vector<AreaMapRecord> records;
+    std::vector<double> points;
+    std::string strings;
+    std::map<std::string, uint32_t> stringOffsets;
+
+    records.reserve(mapArea.size());
+    for (std::map<unsigned int, Area*>::const_iterator it = mapArea.begin(); it != mapArea.end(); ++it) {
+        Area* area = it->second;
+        AreaMapRecord record;
+        memset(&record, 0, sizeof (record));
+
+        record.id = it->first;
+        record.isCircle = area->getIsCircle();
+        record.enterHysteresis = area->getEnterHysteresis();
+        record.leaveHysteresis = area->getLeaveHysteresis();
+
+        if (area->getIsCircle()) {
+            CircleArea* circle = (CircleArea*) area;
+            record.center[0] = circle->getCenterRelative().get<0>();
+            record.center[1] = circle->getCenterRelative().get<1>();
+            record.center[2] = circle->getCenterRelative().get<2>();
+            record.ray = circle->getRay();
+            record.height = circle->getHeight();
+        } else {
+            PolygonArea* polygon = (PolygonArea*) area;
+            std::vector<bg::model::d2::point_xy<double> > polyPoints = polygon->getPolyRelative().outer();
+            record.firstPoint = points.size() / 2;
+            record.nbPoints = polyPoints.size();
+            for (unsigned int i = 0; i < polyPoints.size(); ++i) {
+                points.push_back(polyPoints[i].get<0>());
+                points.push_back(polyPoints[i].get<1>());
+            }
+            record.zmin = polygon->getZRelative().get<0>();
+            record.zmax = polygon->getZRelative().get<1>();
+        }
+
+        record.name = poolString(area->getName(), strings, stringOffsets);
+        record.myOwner = poolString(area->getMyOwner(), strings, stringOffsets);
+        record.areaType = poolString(area->getAreaType(), strings, stringOffsets);
+        record.factType = poolString(area->getFactType(), strings, stringOffsets);
+        record.entityType = poolString(area->getEntityType(), strings, stringOffsets);
+
+        records.push_back(record);
+    }
+
+    AreaMapHeader header;
+    memset(&header, 0, sizeof (header));
+    memcpy(header.magic, AREA_MAP_MAGIC, sizeof (header.magic));
+    header.version = AREA_MAP_VERSION;
+    header.nbAreas = records.size();
+    header.nbPoints = points.size() / 2;
+    header.stringsSize = strings.size();
+
+    // Write next to the target and rename, so that a map being loaded is never half written
+    std::string tmpName = fileName + ".tmp";
+    FILE* file = fopen(tmpName.c_str(), "wb");
+    if (file == NULL) {
+        printf("[area_manager][WARNING] cannot open %s for writing\n", tmpName.c_str());
+        return false;
+    }
+
+    bool written = fwrite(&header, sizeof (header), 1, file) == 1;
+    if (!records.empty())
+        written = written && fwrite(&records[0], sizeof (AreaMapRecord), records.size(), file) == records.size();
+    if (!points.empty())
+        written = written && fwrite(&points[0], sizeof (double), points.size(), file) == points.size();
+    if (!strings.empty())
+        written = written && fwrite(strings.data(), 1, strings.size(), file) == strings.size();
+    written = (fclose(file) == 0) && written;
+
+    if (!written || rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        printf("[area_manager][WARNING] failed to write area map %s\n", fileName.c_str());
+        unlink(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool loadAreaMap(const std::string& fileName, std::map<unsigned int, Area*>& mapArea, unsigned int& nbLoaded) {
+    nbLoaded = 0;
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        printf("[area_manager][WARNING] cannot open area map %s\n", fileName.c_str());
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || (size_t) fileStat.st_size < sizeof (AreaMapHeader)) {
+        printf("[area_manager][WARNING] %s is not an area map\n", fileName.c_str());
+        close(fd);
+        return false;
+    }
+
+    size_t fileSize = fileStat.st_size;
+    void* mapping = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        printf("[area_manager][WARNING] cannot map area map %s\n", fileName.c_str());
+        return false;
+    }
+
+    const char* data = (const char*) mapping;
+    const AreaMapHeader* header = (const AreaMapHeader*) data;
+
+    size_t recordsOffset = sizeof (AreaMapHeader);
+    size_t pointsOffset = recordsOffset + (size_t) header->nbAreas * sizeof (AreaMapRecord);
+    size_t stringsOffset = pointsOffset + (size_t) header->nbPoints * 2 * sizeof (double);
+
+    bool valid = memcmp(header->magic, AREA_MAP_MAGIC, sizeof (header->magic)) == 0
+            && header->version == AREA_MAP_VERSION
+            && stringsOffset + header->stringsSize == fileSize
+            && (header->stringsSize == 0 || data[fileSize - 1] == '\0');
+
+    const AreaMapRecord* records = (const AreaMapRecord*) (data + recordsOffset);
+    const double (*points)[2] = (const double (*)[2]) (data + pointsOffset);
+    const char* strings = data + stringsOffset;
+
+    // Check every offset before creating anything
+    for (unsigned int i = 0; valid && i < header->nbAreas; ++i) {
+        const AreaMapRecord& record = records[i];
+        valid = record.name < header->stringsSize && record.myOwner < header->stringsSize
+                && record.areaType < header->stringsSize && record.factType < header->stringsSize
+                && record.entityType < header->stringsSize
+                && (record.isCircle || (uint64_t) record.firstPoint + record.nbPoints <= header->nbPoints);
+    }
+
+    if (!valid) {
+        printf("[area_manager][WARNING] %s is not a valid area map\n", fileName.c_str());
+        munmap(mapping, fileSize);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < header->nbAreas; ++i) {
+        if (records[i].id == 0)
+            continue;
+        std::map<unsigned int, Area*>::iterator itArea = mapArea.find(records[i].id);
+        if (itArea != mapArea.end())
+            delete itArea->second;
+        mapArea[records[i].id] = createArea(records[i], records[i].id, points, strings);
+    }
+
+    // 0 means "no id": such areas get a free id once the others are placed, as with add_area
+    for (unsigned int i = 0; i < header->nbAreas; ++i) {
+        if (records[i].id != 0)
+            continue;
+        unsigned int id = freeId(mapArea);
+        printf("[area_manager][WARNING] area %s of %s has id 0, loaded with id %u\n", strings + records[i].name, fileName.c_str(), id);
+        mapArea[id] = createArea(records[i], id, points, strings);
+    }
+    nbLoaded = header->nbAreas;
+
+    munmap(mapping, fileSize);
+    return true;
+}
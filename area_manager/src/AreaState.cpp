@@ -0,0 +1,202 @@
+/*
+ * File:   AreaState.cpp
+ */
+
+#include "area_manager/AreaState.h"
+
+#include "toaster-lib/Entity.h"
+#include "toaster-lib/CircleArea.h"
+#include "toaster-lib/PolygonArea.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+
+double segmentDistance(double px, double py, double ax, double ay, double bx, double by) {
+    double dx = bx - ax;
+    double dy = by - ay;
+    double length2 = dx * dx + dy * dy;
+    double t = 0.0;
+    if (length2 > 0.0)
+        t = std::max(0.0, std::min(1.0, ((px - ax) * dx + (py - ay) * dy) / length2));
+    double cx = ax + t * dx - px;
+    double cy = ay + t * dy - py;
+    return sqrt(cx * cx + cy * cy);
+}
+
+// Unsigned distance from position to the boundary of area, z limits included.
+double boundaryDistance(Area* area, const bg::model::point<double, 3, bg::cs::cartesian>& position) {
+    double x = position.get<0>();
+    double y = position.get<1>();
+    double z = position.get<2>();
+    double distance = std::numeric_limits<double>::max();
+
+    if (area->getIsCircle()) {
+        CircleArea* circle = (CircleArea*) area;
+        double cx = x - circle->getCenter().get<0>();
+        double cy = y - circle->getCenter().get<1>();
+        distance = fabs(sqrt(cx * cx + cy * cy) - circle->getRay());
+
+        // The vertical extent of a circle area depends on how height is applied
+        // around the center, take the closest of the possible limits.
+        double height = circle->getHeight();
+        if (height != 0.0) {
+            double cz = circle->getCenter().get<2>();
+            double limits[5] = {cz - height, cz - height / 2.0, cz, cz + height / 2.0, cz + height};
+            for (unsigned int i = 0; i < 5; ++i)
+                distance = std::min(distance, fabs(z - limits[i]));
+        }
+    } else {
+        PolygonArea* polygon = (PolygonArea*) area;
+        const std::vector<bg::model::d2::point_xy<double> >& ring = polygon->poly_.outer();
+        for (unsigned int i = 0; i + 1 < ring.size(); ++i)
+            distance = std::min(distance, segmentDistance(x, y, ring[i].get<0>(), ring[i].get<1>(), ring[i + 1].get<0>(), ring[i + 1].get<1>()));
+        if (ring.size() > 1)
+            distance = std::min(distance, segmentDistance(x, y, ring.back().get<0>(), ring.back().get<1>(), ring[0].get<0>(), ring[0].get<1>()));
+
+        distance = std::min(distance, fabs(z - polygon->z.get<0>()));
+        distance = std::min(distance, fabs(z - polygon->z.get<1>()));
+    }
+    return distance;
+}
+
+// Largest move of the boundary of area when its hysteresis h offsets it:
+// h for a circle, h / sin(a / 2) at the sharpest vertex a of a polygon.
+double hysteresisMargin(Area* area) {
+    double h = std::max(fabs(area->getEnterHysteresis()), fabs(area->getLeaveHysteresis()));
+    if (h == 0.0 || area->getIsCircle())
+        return h;
+
+    PolygonArea* polygon = (PolygonArea*) area;
+    const std::vector<bg::model::d2::point_xy<double> >& ring = polygon->poly_.outer();
+    unsigned int nbPoints = ring.size();
+    if (nbPoints > 1 && ring.back().get<0>() == ring[0].get<0>() && ring.back().get<1>() == ring[0].get<1>())
+        nbPoints--;
+
+    double minSin = 1.0;
+    for (unsigned int i = 0; i < nbPoints; ++i) {
+        const bg::model::d2::point_xy<double>& prev = ring[(i + nbPoints - 1) % nbPoints];
+        const bg::model::d2::point_xy<double>& next = ring[(i + 1) % nbPoints];
+        double ux = prev.get<0>() - ring[i].get<0>();
+        double uy = prev.get<1>() - ring[i].get<1>();
+        double vx = next.get<0>() - ring[i].get<0>();
+        double vy = next.get<1>() - ring[i].get<1>();
+        double length = sqrt(ux * ux + uy * uy) * sqrt(vx * vx + vy * vy);
+        if (length == 0.0)
+            continue;
+
+        // Smallest of the inner and outer angles, in [0, pi]
+        double angle = acos(std::max(-1.0, std::min(1.0, (ux * vx + uy * vy) / length)));
+        minSin = std::min(minSin, sin(angle / 2.0));
+    }
+
+    // A spike moves its boundary without bound, its entities are always tested
+    if (minSin <= 0.0)
+        return std::numeric_limits<double>::max();
+    return h / minSin;
+}
+
+bool contains(const std::vector<std::string>& ids, const std::string& id) {
+    return std::find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+}
+
+AreaStateCache::AreaStateCache(double maxSpeed) : maxSpeed_(maxSpeed), nbSlots_(0) {
+}
+
+unsigned int AreaStateCache::addEntity(const std::string& id) {
+    std::map<std::string, unsigned int>::iterator it = slots_.find(id);
+    if (it != slots_.end())
+        return it->second;
+
+    unsigned int slot;
+    if (freeSlots_.empty())
+        slot = nbSlots_++;
+    else {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+    }
+    slots_[id] = slot;
+    return slot;
+}
+
+bool AreaStateCache::findEntity(const std::string& id, unsigned int& slot) const {
+    std::map<std::string, unsigned int>::const_iterator it = slots_.find(id);
+    if (it == slots_.end())
+        return false;
+    slot = it->second;
+    return true;
+}
+
+void AreaStateCache::removeEntity(const std::string& id) {
+    std::map<std::string, unsigned int>::iterator it = slots_.find(id);
+    if (it == slots_.end())
+        return;
+
+    for (std::map<unsigned int, AreaStates_t>::iterator itArea = areas_.begin(); itArea != areas_.end(); ++itArea)
+        if (it->second < itArea->second.entities.size())
+            itArea->second.entities[it->second].known = false;
+
+    freeSlots_.push_back(it->second);
+    slots_.erase(it);
+}
+
+AreaStates_t& AreaStateCache::getArea(Area* area) {
+    std::map<unsigned int, AreaStates_t>::iterator it = areas_.find(area->getId());
+    if (it != areas_.end())
+        return it->second;
+
+    AreaStates_t& states = areas_[area->getId()];
+    states.hysteresisMargin = hysteresisMargin(area);
+    return states;
+}
+
+bool AreaStateCache::isInArea(Entity* ent, unsigned int slot, Area* area, AreaStates_t& states) const {
+    // Areas following an owner move with it, their boundary distance is not kept.
+    if (maxSpeed_ <= 0.0 || area->getMyOwner() != "")
+        return area->isPointInArea(ent->getPosition(), ent->getId());
+
+    if (slot >= states.entities.size()) {
+        AreaMembership_t unknown;
+        unknown.known = false;
+        unknown.state = OUTSIDE_AREA;
+        unknown.margin = 0.0;
+        unknown.time = 0;
+        states.entities.resize(slot + 1, unknown);
+    }
+
+    unsigned long time = ent->getTime();
+    AreaMembership_t& membership = states.entities[slot];
+    if (membership.known && (membership.state == INSIDE_AREA || membership.state == OUTSIDE_AREA)) {
+        double elapsed = time > membership.time ? (time - membership.time) / 1e9 : 0.0;
+        if (maxSpeed_ * elapsed < membership.margin)
+            return membership.state == INSIDE_AREA;
+    }
+
+    bool inside = area->isPointInArea(ent->getPosition(), ent->getId());
+
+    if (contains(area->getUpcomingEntities(), ent->getId()))
+        membership.state = ENTERING_AREA;
+    else if (contains(area->getLeavingEntities(), ent->getId()))
+        membership.state = LEAVING_AREA;
+    else
+        membership.state = inside ? INSIDE_AREA : OUTSIDE_AREA;
+
+    membership.known = true;
+    membership.margin = boundaryDistance(area, ent->getPosition()) - states.hysteresisMargin;
+    membership.time = time;
+
+    return inside;
+}
+
+void AreaStateCache::removeArea(unsigned int areaId) {
+    areas_.erase(areaId);
+}
+
+void AreaStateCache::clear() {
+    areas_.clear();
+}
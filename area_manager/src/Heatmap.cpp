@@ -0,0 +1,131 @@
+/*
+ * File:   Heatmap.cpp
+ */
+
+#include "area_manager/Heatmap.h"
+
+#include <cmath>
+
+// Stored values are rescaled once the decay scale factor reaches this value
+#define HEATMAP_MAX_SCALE 1e6
+
+Heatmap::Heatmap(double originX, double originY, unsigned int width, unsigned int height,
+        double resolution, double decayTime) :
+originX_(originX), originY_(originY), width_(width), height_(height),
+resolution_(resolution), decayTime_(decayTime), cells_(width * height, 0.0), refTime_(0), time_(0) {
+}
+
+int Heatmap::cellIndex(double x, double y) const {
+    double col = floor((x - originX_) / resolution_);
+    double row = floor((y - originY_) / resolution_);
+    if (col < 0 || row < 0 || col >= width_ || row >= height_)
+        return -1;
+    return (int) row * width_ + (int) col;
+}
+
+void Heatmap::addDwell(int cell, unsigned long from, unsigned long to) {
+    if (cell < 0 || to <= from)
+        return;
+
+    if (refTime_ == 0)
+        refTime_ = from;
+
+    double scale = exp(((double) to - (double) refTime_) / 1e9 / decayTime_);
+    if (scale > HEATMAP_MAX_SCALE) {
+        // Bring stored values back to the current time
+        for (unsigned int i = 0; i < cells_.size(); ++i)
+            cells_[i] /= scale;
+        refTime_ = to;
+        scale = 1.0;
+    }
+
+    cells_[cell] += (to - from) / 1e9 * scale;
+}
+
+void Heatmap::updateEntity(unsigned int slot, double x, double y, unsigned long time) {
+    if (slot >= tracks_.size()) {
+        Track_t unused;
+        unused.used = false;
+        unused.cell = -1;
+        unused.since = 0;
+        unused.lastTime = 0;
+        tracks_.resize(slot + 1, unused);
+    }
+
+    if (time > time_)
+        time_ = time;
+
+    int cell = cellIndex(x, y);
+    Track_t& track = tracks_[slot];
+    if (!track.used) {
+        track.used = true;
+        track.cell = cell;
+        track.since = time;
+        track.lastTime = time;
+        return;
+    }
+
+    if (time <= track.lastTime)
+        return;
+
+    if (cell != track.cell) {
+        // The entity was in its previous cell until now
+        addDwell(track.cell, track.since, time);
+        track.cell = cell;
+        track.since = time;
+    }
+    track.lastTime = time;
+}
+
+void Heatmap::removeEntity(unsigned int slot) {
+    if (slot >= tracks_.size() || !tracks_[slot].used)
+        return;
+
+    addDwell(tracks_[slot].cell, tracks_[slot].since, tracks_[slot].lastTime);
+    tracks_[slot].used = false;
+}
+
+void Heatmap::fillMsg(toaster_msgs::Heatmap& msg) {
+    // Entities which did not leave their cell
+    for (std::vector<Track_t>::iterator it = tracks_.begin(); it != tracks_.end(); ++it) {
+        if (!it->used)
+            continue;
+        addDwell(it->cell, it->since, it->lastTime);
+        it->since = it->lastTime;
+        if ((time_ - it->lastTime) / 1e9 > decayTime_)
+            it->used = false;
+    }
+
+    double decay = 1.0;
+    if (refTime_ != 0)
+        decay = exp(-((double) time_ - (double) refTime_) / 1e9 / decayTime_);
+
+    double maxValue = 0.0;
+    for (unsigned int i = 0; i < cells_.size(); ++i)
+        if (cells_[i] > maxValue)
+            maxValue = cells_[i];
+    maxValue *= decay;
+
+    msg.originX = originX_;
+    msg.originY = originY_;
+    msg.resolution = resolution_;
+    msg.width = width_;
+    msg.height = height_;
+    msg.maxDwellTime = maxValue;
+    msg.runLengths.clear();
+    msg.values.clear();
+
+    double quantization = 0.0;
+    if (maxValue > 0.0)
+        quantization = 255.0 * decay / maxValue;
+
+    for (unsigned int i = 0; i < cells_.size(); ++i) {
+        uint8_t value = (uint8_t) (cells_[i] * quantization + 0.5);
+        if (!msg.values.empty() && msg.values.back() == value && msg.runLengths.back() < 255)
+            msg.runLengths.back()++;
+        else {
+            msg.values.push_back(value);
+            msg.runLengths.push_back(1);
+        }
+    }
+}
@@ -4,13 +4,22 @@
 #include "toaster_msgs/ToasterRobotReader.h"
 #include "toaster_msgs/ToasterObjectReader.h"
 #include "toaster_msgs/AddArea.h"
+#include "toaster_msgs/AddAreas.h"
+#include "toaster_msgs/LoadSaveAreas.h"
 #include "toaster_msgs/RemoveArea.h"
 #include "toaster_msgs/PrintArea.h"
 #include "toaster_msgs/Empty.h"
 #include "toaster_msgs/GetRelativePosition.h"
 #include "toaster_msgs/GetMultiRelativePosition.h"
+#include "toaster_msgs/GetRelativePositions.h"
 #include "toaster_msgs/Area.h"
 #include "toaster_msgs/AreaList.h"
+#include "toaster_msgs/ThreadPool.h"
+#include "toaster_msgs/PoolCallbackQueue.h"
+#include "area_manager/AreaMap.h"
+#include "area_manager/AreaState.h"
+#include "area_manager/Heatmap.h"
+#include "area_manager/AreaManagerNode.h"
 #include "toaster-lib/CircleArea.h"
 #include "toaster-lib/PolygonArea.h"
 #include "toaster-lib/MathFunctions.h"
@@ -19,10 +28,16 @@
 #include <toaster_msgs/Fact.h>
 #include <toaster_msgs/FactList.h>
 #include <geometry_msgs/PolygonStamped.h>
+#include <ros/callback_queue.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
 #include <iterator>
+#include <cmath>
 //#include <boost/numeric/ublas/matrix.hpp>area_manager/factList
 //#include <boost/numeric/ublas/io.hpp>
 
+namespace area_manager {
 
 //namespace trans = bg::strategy::transform;
 typedef bg::model::point<double, 2, bg::cs::cartesian> point_type2d;
@@ -34,6 +49,38 @@ typedef bg::model::point<double, 3, bg::cs::cartesian> point_type3d;
 std::map<unsigned int, Area*> mapArea_;
 std::map<std::string, Entity*> mapEntities_;
 
+// Last in area test of each entity, to skip tests far from area boundaries
+AreaStateCache areaStates_;
+
+// Occupancy heatmap of the entities, by slot of areaStates_, NULL if disabled
+Heatmap* heatmap_ = NULL;
+
+// Poses of all entities, copied once per loop for the relative position
+// services. These services run on the workers of the pool and only read
+// the last published table, never the entities written by reader callbacks.
+struct PoseRecord {
+    unsigned int id; // index in PoseIds::ids
+    double x, y;
+    double heading;
+};
+
+// Ids of the entities, shared by the tables until the entities change
+struct PoseIds {
+    std::vector<std::string> ids;
+    std::map<std::string, unsigned int> index;
+};
+
+struct PoseTable {
+    boost::shared_ptr<const PoseIds> ids;
+    std::vector<PoseRecord> poses; // poses[i].id == i
+};
+
+boost::shared_ptr<PoseTable> poseTable_(new PoseTable());
+boost::mutex poseTableMutex_;
+
+// Refilled by the loop and swapped with poseTable_
+boost::shared_ptr<PoseTable> spareTable_;
+
 // Publisher for area
 bool publishingArea_ = true;
 
@@ -109,6 +156,7 @@ bool areaCompatible(std::string areaEntType, EntityType entType) {
         else
             return false;
     }
+    return false;
 }
 
 // Entity should be a vector or a map with all entities
@@ -198,35 +246,91 @@ void updateEntityArea(std::map<unsigned int, Area*>& mpArea, Entity * entity) {
     }
 }
 
-void updateInArea(Entity* ent, std::map<unsigned int, Area*>& mpArea) {
-	//ROS_INFO("Inside the function");
-    for (std::map<unsigned int, Area*>::iterator it = mpArea.begin(); it != mpArea.end(); ++it) {
+// Change of the in area state of an entity, found by the workers and applied by the main thread
+struct AreaEvent {
+    Entity* ent;
+    Area* area;
+    bool enters;
+};
+
+// Tests the entities, with their slot in areaStates_, against one area.
+// Only the area and its states are modified, so areas can be tested in parallel.
+void testArea(Area* area, AreaStates_t& states, const std::vector<std::pair<Entity*, unsigned int> >& entities,
+        std::vector<AreaEvent>& events) {
+    for (std::vector<std::pair<Entity*, unsigned int> >::const_iterator it = entities.begin(); it != entities.end(); ++it) {
+        Entity* ent = it->first;
         // if the entity is actually concerned, and is not the owner
-        if (areaCompatible(it->second->getEntityType(), ent->getEntityType()) && it->second->getMyOwner() != ent->getId())
-        { // If we already know that entity is in Area, we update if needed.
-            if (ent->isInArea(it->second->getId()))
-                if (it->second->isPointInArea(ent->getPosition(), ent->getId()))
-                    continue;
-                else {
-                    printf("[area_manager] %s leaves Area %s\n", ent->getName().c_str(), it->second->getName().c_str());
-                    ent->removeInArea(it->second->getId());
-                    if (it->second->getAreaType() == "room")
-                        ent->setRoomId(0);
-                }// Same if entity is not in Area
-            else if (it->second->isPointInArea(ent->getPosition(),ent->getId()))
-            {
-                printf("[area_manager] %s enters in Area %s\n", ent->getName().c_str(), it->second->getName().c_str());
-                ent->inArea_.push_back(it->second->getId());
-
-                //User has to be in a room. May it be a "global room".
-                if (it->second->getAreaType() == "room")
-                    ent->setRoomId(it->second->getId());
-            } else
-                continue;
-        } else
+        if (!areaCompatible(area->getEntityType(), ent->getEntityType()) || area->getMyOwner() == ent->getId())
             continue;
+
+        bool inside = areaStates_.isInArea(ent, it->second, area, states);
+        if (inside != ent->isInArea(area->getId())) {
+            AreaEvent event;
+            event.ent = ent;
+            event.area = area;
+            event.enters = inside;
+            events.push_back(event);
+        }
     }
 }
+
+void applyAreaEvent(const AreaEvent& event) {
+    Entity* ent = event.ent;
+    Area* area = event.area;
+    if (event.enters) {
+        printf("[area_manager] %s enters in Area %s\n", ent->getName().c_str(), area->getName().c_str());
+        ent->inArea_.push_back(area->getId());
+
+        //User has to be in a room. May it be a "global room".
+        if (area->getAreaType() == "room")
+            ent->setRoomId(area->getId());
+    } else {
+        printf("[area_manager] %s leaves Area %s\n", ent->getName().c_str(), area->getName().c_str());
+        ent->removeInArea(area->getId());
+        if (area->getAreaType() == "room")
+            ent->setRoomId(0);
+    }
+}
+
+// Forgets an entity which is not present anymore: it leaves its areas until it comes back.
+void removeEntity(const std::string& id) {
+    std::map<std::string, Entity*>::iterator it = mapEntities_.find(id);
+    if (it == mapEntities_.end())
+        return;
+
+    Entity* ent = it->second;
+    for (std::vector<unsigned int>::iterator itArea = ent->inArea_.begin(); itArea != ent->inArea_.end(); ++itArea) {
+        std::map<unsigned int, Area*>::iterator area = mapArea_.find(*itArea);
+        if (area != mapArea_.end()) {
+            std::vector<std::string>& inside = area->second->insideEntities_;
+            inside.erase(std::remove(inside.begin(), inside.end(), id), inside.end());
+            printf("[area_manager] %s leaves Area %s\n", ent->getName().c_str(), area->second->getName().c_str());
+        }
+    }
+    ent->inArea_.clear();
+    ent->setRoomId(0);
+
+    unsigned int slot;
+    if (heatmap_ != NULL && areaStates_.findEntity(id, slot))
+        heatmap_->removeEntity(slot);
+    areaStates_.removeEntity(id);
+    mapEntities_.erase(it);
+}
+
+// Adds the entities of reader present less than timeout s ago to mapEntities_, removes the others.
+// Areas owned by the entities follow them. A timeout of 0 keeps every entity.
+template <typename T>
+void updateEntities(const EntityReader<T>& reader, double timeout) {
+    for (typename std::map<std::string, T*>::const_iterator it = reader.lastConfig_.begin(); it != reader.lastConfig_.end(); ++it) {
+        if (timeout > 0.0 && !reader.isPresent(it->first, timeout)) {
+            removeEntity(it->first);
+            continue;
+        }
+        mapEntities_[it->first] = it->second;
+        updateEntityArea(mapArea_, it->second);
+    }
+}
+
 // Return confidence: 0.0 if not facing 1.0 if facing
 
 double isFacing(Entity* entFacing, Entity* entSubject, double angleThreshold, double& angleResult) {
@@ -263,48 +367,182 @@ unsigned int getFreeId(std::map<unsigned int, Area*>& map) {
     return i;
 }
 
+// Data needed by computeAreaFacts that does not belong to the area.
+// It is resolved in the main thread before dispatching areas to the workers.
+struct AreaTask {
+    Area* area;
+    Entity* ownerEnt;
+    int fullPopulation;
+};
+
+// Computes the facts of a single area.
+// It only reads entities and areas, so areas can be evaluated in parallel.
+void computeAreaFacts(const AreaTask& task, std::vector<toaster_msgs::Fact>& facts) {
+    Area* area = task.area;
+    Entity* ownerEnt = task.ownerEnt;
+    toaster_msgs::Fact fact_msg;
+    double areaDensity = 0.0;
+    unsigned long densityTime = 0;
+
+    for (std::map<std::string, Entity*>::const_iterator itEntity = mapEntities_.begin(); itEntity != mapEntities_.end(); ++itEntity) {
+
+        if (itEntity->second->isInArea(area->getId())) {
+
+            // compute facts according to factType
+            // TODO: instead of calling it interaction, make a list of facts to compute?
+
+            if (area->getFactType() == "interaction") {
+
+                // If it is an interacting area, we need the owner!
+                if (ownerEnt != NULL) {
+
+                    // Now let's compute isFacing
+                    //////////////////////////////
+
+                    double confidence = 0.0;
+                    // This is the actual angle between subject orientation
+                    // and target. It gives left / right relation
+                    // If positive, target is at right!
+                    double angleResult = 0.0;
+                    confidence = isFacing(itEntity->second, ownerEnt, 0.5, angleResult);
+                    if (confidence > 0.0)
+                    {
+                        //Fact Facing
+                        fact_msg.property = "IsFacing";
+                        fact_msg.propertyType = "posture";
+                        fact_msg.subProperty = "angle";
+                        fact_msg.subjectId = itEntity->first;
+                        fact_msg.targetId = ownerEnt->getId();
+                        fact_msg.confidence = confidence;
+                        fact_msg.stringValue = true;
+                        fact_msg.doubleValue = angleResult;
+                        fact_msg.valueType = 0;
+                        fact_msg.factObservability = 0.5;
+                        fact_msg.time = itEntity->second->getTime();
+
+                        facts.push_back(fact_msg);
+                    }
+
+                    // Compute here other facts linked to interaction
+                    //////////////////////////////////////////////////
+                } // ownerEnt!= NULL
+
+            } else if (area->getFactType() == "density") {
+                areaDensity += 1.0;
+                densityTime = itEntity->second->getTime();
+            } else if (area->getFactType() == "") {
+
+            } else
+                printf("[area_manager][WARNING] Area %s has factType %s, which is not available\n", area->getName().c_str(), area->getFactType().c_str());
+
+            if (ownerEnt != NULL)
+              fact_msg.targetOwnerId = ownerEnt->getId();
+            fact_msg.propertyType = "position";
+            fact_msg.subProperty = area->getAreaType();
+            fact_msg.subjectId = itEntity->first;
+            fact_msg.targetId = area->getName();
+            fact_msg.confidence = 1;
+            fact_msg.factObservability = 0.8;
+            fact_msg.time = itEntity->second->getTime();
+            fact_msg.valueType = 0;
+            fact_msg.stringValue = "true";
+
+            if (area->getAreaType() == "room") //Fact in Area
+              fact_msg.property = "IsInRoom";
+            else if (area->getAreaType() == "support")
+            { //Fact in Area
+              fact_msg.property = "IsAt";
+              fact_msg.subProperty = "location";
+            }
+            else //Fact in Area
+              fact_msg.property = "IsInArea";
+
+            facts.push_back(fact_msg);
+        }
+    }// For all Entities
+
+    // We compute here the density
+    if (area->getFactType() == "density") {
+        if (task.fullPopulation == 0)
+            areaDensity = 0;
+        else
+            areaDensity /= task.fullPopulation;
+
+        if (ownerEnt != NULL) {
+            fact_msg.subjectOwnerId = ownerEnt->getId();
+        }
+
+        //Fact Density
+        fact_msg.property = "AreaDensity";
+        fact_msg.propertyType = "density";
+        fact_msg.subProperty = "ratio";
+        fact_msg.subjectId = area->getId();
+        fact_msg.targetId = "";
+        fact_msg.confidence = 1.0;
+        fact_msg.doubleValue = areaDensity;
+        fact_msg.valueType = 1;
+        fact_msg.factObservability = 0.0;
+        fact_msg.time = densityTime;
+
+        facts.push_back(fact_msg);
+    }// Density
+}
+
 ///////////////////////////
 //   Service functions   //
 ///////////////////////////
 
-bool addArea(toaster_msgs::AddArea::Request &req,
-        toaster_msgs::AddArea::Response & res) {
+// Creates the area described by areaMsg and stores it in mapArea_,
+// replacing any area with the same id. Returns the new area.
+Area* insertArea(const toaster_msgs::Area& areaMsg) {
 
     Area* curArea;
 
     unsigned int id;
     // If no id, get one
-    if (req.myArea.id == 0)
+    if (areaMsg.id == 0)
         id = getFreeId(mapArea_);
     else
-        id = req.myArea.id;
+        id = areaMsg.id;
 
     //If it is a circle area
-    if (req.myArea.isCircle) {
-        bg::model::point<double, 3, bg::cs::cartesian> center(req.myArea.center.x, req.myArea.center.y, req.myArea.center.z);
-        CircleArea* myCircle = new CircleArea(id, center, req.myArea.ray, req.myArea.height, req.myArea.enterHysteresis, req.myArea.leaveHysteresis);
+    if (areaMsg.isCircle) {
+        bg::model::point<double, 3, bg::cs::cartesian> center(areaMsg.center.x, areaMsg.center.y, areaMsg.center.z);
+        CircleArea* myCircle = new CircleArea(id, center, areaMsg.ray, areaMsg.height, areaMsg.enterHysteresis, areaMsg.leaveHysteresis);
         curArea = myCircle;
     } else {
         //If it is a polygon
-        double pointsPoly[req.myArea.poly.points.size()][2];
-        for (int i = 0; i < req.myArea.poly.points.size(); i++) {
-            pointsPoly[i][0] = req.myArea.poly.points[i].x;
-            pointsPoly[i][1] = req.myArea.poly.points[i].y;
+        double pointsPoly[areaMsg.poly.points.size()][2];
+        for (int i = 0; i < areaMsg.poly.points.size(); i++) {
+            pointsPoly[i][0] = areaMsg.poly.points[i].x;
+            pointsPoly[i][1] = areaMsg.poly.points[i].y;
         }
 
-        PolygonArea* myPoly = new PolygonArea(id, pointsPoly, req.myArea.poly.points.size(), req.myArea.zmin, req.myArea.zmax, req.myArea.enterHysteresis, req.myArea.leaveHysteresis);
+        PolygonArea* myPoly = new PolygonArea(id, pointsPoly, areaMsg.poly.points.size(), areaMsg.zmin, areaMsg.zmax, areaMsg.enterHysteresis, areaMsg.leaveHysteresis);
 
         curArea = myPoly;
     }
 
-    curArea->setIsCircle(req.myArea.isCircle);
-    curArea->setEntityType(req.myArea.entityType);
-    curArea->setFactType(req.myArea.factType);
-    curArea->setMyOwner(req.myArea.myOwner);
-    curArea->setName(req.myArea.name);
-    curArea->setAreaType(req.myArea.areaType);
+    curArea->setIsCircle(areaMsg.isCircle);
+    curArea->setEntityType(areaMsg.entityType);
+    curArea->setFactType(areaMsg.factType);
+    curArea->setMyOwner(areaMsg.myOwner);
+    curArea->setName(areaMsg.name);
+    curArea->setAreaType(areaMsg.areaType);
 
+    std::map<unsigned int, Area*>::iterator itArea = mapArea_.find(curArea->getId());
+    if (itArea != mapArea_.end())
+        delete itArea->second;
     mapArea_[curArea->getId()] = curArea;
+    areaStates_.removeArea(curArea->getId());
+
+    return curArea;
+}
+
+bool addArea(toaster_msgs::AddArea::Request &req,
+        toaster_msgs::AddArea::Response & res) {
+
+    insertArea(req.myArea);
 
     res.answer = true;
     ROS_INFO("request: added Area: id %d, name %s", req.myArea.id, req.myArea.name.c_str());
@@ -312,6 +550,34 @@ bool addArea(toaster_msgs::AddArea::Request &req,
     return true;
 }
 
+bool addAreas(toaster_msgs::AddAreas::Request &req,
+        toaster_msgs::AddAreas::Response & res) {
+
+    for (unsigned int i = 0; i < req.areas.size(); ++i)
+        insertArea(req.areas[i]);
+
+    res.answer = true;
+    ROS_INFO("request: added %d Areas", (int) req.areas.size());
+    return true;
+}
+
+bool loadSaveAreas(toaster_msgs::LoadSaveAreas::Request &req,
+        toaster_msgs::LoadSaveAreas::Response & res) {
+
+    if (req.toSave) {
+        res.answer = saveAreaMap(req.fileName, mapArea_);
+        res.nbAreas = mapArea_.size();
+        ROS_INFO("request: save %d Areas in %s: [%d]", res.nbAreas, req.fileName.c_str(), (int) res.answer);
+    } else {
+        unsigned int nbLoaded = 0;
+        res.answer = loadAreaMap(req.fileName, mapArea_, nbLoaded);
+        areaStates_.clear();
+        res.nbAreas = nbLoaded;
+        ROS_INFO("request: load %d Areas from %s: [%d]", res.nbAreas, req.fileName.c_str(), (int) res.answer);
+    }
+    return res.answer;
+}
+
 bool removeArea(toaster_msgs::RemoveArea::Request &req,
         toaster_msgs::RemoveArea::Response & res) {
 
@@ -320,6 +586,7 @@ bool removeArea(toaster_msgs::RemoveArea::Request &req,
     {
       delete mapArea_[req.id];
       mapArea_.erase(req.id);
+      areaStates_.removeArea(req.id);
     }
 
     res.answer = true;
@@ -335,6 +602,7 @@ bool removeAllAreas(toaster_msgs::Empty::Request &req,
       delete itArea->second;
 
     mapArea_.clear();
+    areaStates_.clear();
     return true;
 }
 
@@ -361,6 +629,72 @@ bool printAllAreas(toaster_msgs::Empty::Request &req,
     return true;
 }
 
+// Copies the current entity poses in the spare table and publishes it for the services.
+void updatePoseTable() {
+    // Once swapped out, a table only loses readers: it is refilled if no request holds it anymore
+    if (!spareTable_ || spareTable_.use_count() != 1)
+        spareTable_.reset(new PoseTable());
+    PoseTable& table = *spareTable_;
+    table.ids = poseTable_->ids;
+
+    // Ids are rebuilt only when the entities changed
+    bool sameIds = table.ids && table.ids->ids.size() == mapEntities_.size();
+    std::map<std::string, Entity*>::const_iterator it = mapEntities_.begin();
+    for (unsigned int i = 0; sameIds && it != mapEntities_.end(); ++i, ++it)
+        sameIds = table.ids->ids[i] == it->first;
+
+    if (!sameIds) {
+        boost::shared_ptr<PoseIds> ids(new PoseIds());
+        ids->ids.reserve(mapEntities_.size());
+        for (it = mapEntities_.begin(); it != mapEntities_.end(); ++it) {
+            ids->index[it->first] = ids->ids.size();
+            ids->ids.push_back(it->first);
+        }
+        table.ids = ids;
+    }
+
+    table.poses.resize(mapEntities_.size());
+    unsigned int i = 0;
+    for (it = mapEntities_.begin(); it != mapEntities_.end(); ++it, ++i) {
+        PoseRecord& pose = table.poses[i];
+        pose.id = i;
+        pose.x = it->second->getPosition().get<0>();
+        pose.y = it->second->getPosition().get<1>();
+        pose.heading = it->second->getOrientation()[2];
+    }
+
+    boost::lock_guard<boost::mutex> lock(poseTableMutex_);
+    poseTable_.swap(spareTable_);
+}
+
+// Tables are never modified while a request holds them
+boost::shared_ptr<const PoseTable> getPoseTable() {
+    boost::lock_guard<boost::mutex> lock(poseTableMutex_);
+    return poseTable_;
+}
+
+// Index of id in table, false if it is not in the table
+bool findPose(const PoseTable& table, const std::string& id, unsigned int& index) {
+    if (!table.ids)
+        return false;
+    std::map<std::string, unsigned int>::const_iterator it = table.ids->index.find(id);
+    if (it == table.ids->index.end())
+        return false;
+    index = it->second;
+    return true;
+}
+
+// Angle of target seen from subject oriented at heading, in ]-pi, pi], as MathFunctions::relativeAngle
+// but computed on the records, without building entities
+double relativeAngle(const PoseRecord& subject, const PoseRecord& target, double heading) {
+    double angle = atan2(target.y - subject.y, target.x - subject.x) - heading;
+    while (angle > M_PI)
+        angle -= 2 * M_PI;
+    while (angle <= -M_PI)
+        angle += 2 * M_PI;
+    return angle;
+}
+
 std::string getDirection(double angle)
 {
   double pi = 3.1416;
@@ -392,9 +726,11 @@ std::string getDirection(double angle)
 // This function is used to get relative position of an entity according to another (left / right))
 bool getRelativePosition(toaster_msgs::GetRelativePosition::Request &req,
         toaster_msgs::GetRelativePosition::Response & res) {
-    if (mapEntities_.find(req.subjectId) != mapEntities_.end() && mapEntities_.find(req.targetId) != mapEntities_.end()) {
+    boost::shared_ptr<const PoseTable> table = getPoseTable();
+    unsigned int subject, target;
+    if (findPose(*table, req.subjectId, subject) && findPose(*table, req.targetId, target)) {
         double angleResult;
-        angleResult = MathFunctions::relativeAngle(mapEntities_[req.subjectId], mapEntities_[req.targetId], mapEntities_[req.subjectId]->getOrientation()[2]);
+        angleResult = relativeAngle(table->poses[subject], table->poses[target], table->poses[subject].heading);
 
         res.direction = getDirection(angleResult);
         res.answer = true;
@@ -410,13 +746,13 @@ bool getRelativePosition(toaster_msgs::GetRelativePosition::Request &req,
 
 bool getMultiRelativePosition(toaster_msgs::GetMultiRelativePosition::Request &req,
         toaster_msgs::GetMultiRelativePosition::Response & res) {
-    double pi = 3.1416;
-
-    // [TODO] Replace with find
-    if (mapEntities_[req.agentSubjectId] != NULL && mapEntities_[req.objectSubjectId] != NULL && mapEntities_[req.targetId] != NULL) {
+    boost::shared_ptr<const PoseTable> table = getPoseTable();
+    unsigned int agent, object, target;
+    if (findPose(*table, req.agentSubjectId, agent) && findPose(*table, req.objectSubjectId, object)
+            && findPose(*table, req.targetId, target)) {
         double angleSubjects, angleResult;
-        angleSubjects = MathFunctions::relativeAngle(mapEntities_[req.agentSubjectId], mapEntities_[req.objectSubjectId], 0);
-        angleResult = MathFunctions::relativeAngle(mapEntities_[req.objectSubjectId], mapEntities_[req.targetId], angleSubjects);
+        angleSubjects = relativeAngle(table->poses[agent], table->poses[object], 0);
+        angleResult = relativeAngle(table->poses[object], table->poses[target], angleSubjects);
         res.direction = getDirection(angleResult);
         res.answer = true;
         res.angleValue = angleResult;
@@ -427,6 +763,62 @@ bool getMultiRelativePosition(toaster_msgs::GetMultiRelativePosition::Request &r
     return false;
 }
 
+void addRelativePosition(const PoseTable& table, unsigned int subject, unsigned int target,
+        toaster_msgs::GetRelativePositions::Response & res) {
+    double angleResult = relativeAngle(table.poses[subject], table.poses[target], table.poses[subject].heading);
+    res.subjectIds.push_back(table.ids->ids[table.poses[subject].id]);
+    res.targetIds.push_back(table.ids->ids[table.poses[target].id]);
+    res.directions.push_back(getDirection(angleResult));
+    res.angleValues.push_back(angleResult);
+}
+
+// Relative positions of a list of (subjectIds[i], targetIds[i]) pairs,
+// or of one subject toward all entities when targetIds is empty.
+// Unknown entities are skipped and answer is set to false.
+bool getRelativePositions(toaster_msgs::GetRelativePositions::Request &req,
+        toaster_msgs::GetRelativePositions::Response & res) {
+    boost::shared_ptr<const PoseTable> table = getPoseTable();
+    res.answer = true;
+
+    if (req.subjectIds.size() == 1 && req.targetIds.empty()) {
+        unsigned int subject;
+        if (!findPose(*table, req.subjectIds[0], subject)) {
+            ROS_INFO("Requested entity is not in the list.");
+            res.answer = false;
+            return false;
+        }
+
+        res.subjectIds.reserve(table->poses.size());
+        res.targetIds.reserve(table->poses.size());
+        res.directions.reserve(table->poses.size());
+        res.angleValues.reserve(table->poses.size());
+        for (unsigned int target = 0; target < table->poses.size(); ++target)
+            if (target != subject)
+                addRelativePosition(*table, subject, target, res);
+
+    } else if (req.subjectIds.size() == req.targetIds.size()) {
+        res.subjectIds.reserve(req.subjectIds.size());
+        res.targetIds.reserve(req.subjectIds.size());
+        res.directions.reserve(req.subjectIds.size());
+        res.angleValues.reserve(req.subjectIds.size());
+        for (unsigned int i = 0; i < req.subjectIds.size(); ++i) {
+            unsigned int subject, target;
+            if (!findPose(*table, req.subjectIds[i], subject) || !findPose(*table, req.targetIds[i], target)) {
+                ROS_INFO("Requested entity %s or %s is not in the list.", req.subjectIds[i].c_str(), req.targetIds[i].c_str());
+                res.answer = false;
+                continue;
+            }
+            addRelativePosition(*table, subject, target, res);
+        }
+
+    } else {
+        ROS_WARN("[area_manager][Request][WARNING] subjectIds and targetIds should have the same size, or give one subject and no target");
+        res.answer = false;
+        return false;
+    }
+    return true;
+}
+
 bool publishAllAreas(toaster_msgs::Empty::Request &req,
         toaster_msgs::Empty::Response & res) {
 
@@ -435,12 +827,10 @@ bool publishAllAreas(toaster_msgs::Empty::Request &req,
     return true;
 }
 
-int main(int argc, char** argv) {
+int run(ros::NodeHandle& node, ros::NodeHandle& privateNode) {
     // Set this in a ros service
     const bool AGENT_FULL_CONFIG = true; //If false we will use only position and orientation
 
-    ros::init(argc, argv, "area_manager");
-    ros::NodeHandle node;
     node_ = &node;
 
     //Data reading
@@ -452,6 +842,61 @@ int main(int argc, char** argv) {
     ros::ServiceServer serviceAdd = node.advertiseService("area_manager/add_area", addArea);
     ROS_INFO("Ready to add Area.");
 
+    ros::ServiceServer serviceAddAreas = node.advertiseService("area_manager/add_areas", addAreas);
+    ROS_INFO("Ready to add Areas.");
+
+    ros::ServiceServer serviceLoadSave = node.advertiseService("area_manager/load_save_areas", loadSaveAreas);
+    ROS_INFO("Ready to load and save Areas.");
+
+    // Maximum speed of entities, used to skip in area tests far from area boundaries (0 to test every loop)
+    double maxEntitySpeed = 3.0;
+    if (node.hasParam("/area_manager/maxEntitySpeed"))
+        node.getParam("/area_manager/maxEntitySpeed", maxEntitySpeed);
+    areaStates_.setMaxSpeed(maxEntitySpeed);
+
+    // Entities whose time did not change for this duration leave their areas (0 to keep them forever)
+    double presenceTimeout = 5.0;
+    node.param("/area_manager/presenceTimeout", presenceTimeout, presenceTimeout);
+
+    // Occupancy heatmap
+    bool heatmapEnabled = false;
+    double heatmapOriginX = -10.0, heatmapOriginY = -10.0, heatmapResolution = 0.1;
+    double heatmapDecayTime = 600.0, heatmapRate = 1.0;
+    int heatmapWidth = 200, heatmapHeight = 200;
+    std::string heatmapEntityType = "humans";
+    node.param("/area_manager/heatmap/enabled", heatmapEnabled, heatmapEnabled);
+    node.param("/area_manager/heatmap/originX", heatmapOriginX, heatmapOriginX);
+    node.param("/area_manager/heatmap/originY", heatmapOriginY, heatmapOriginY);
+    node.param("/area_manager/heatmap/width", heatmapWidth, heatmapWidth);
+    node.param("/area_manager/heatmap/height", heatmapHeight, heatmapHeight);
+    node.param("/area_manager/heatmap/resolution", heatmapResolution, heatmapResolution);
+    node.param("/area_manager/heatmap/decayTime", heatmapDecayTime, heatmapDecayTime);
+    node.param("/area_manager/heatmap/publishRate", heatmapRate, heatmapRate);
+    node.param("/area_manager/heatmap/entityType", heatmapEntityType, heatmapEntityType);
+
+    ros::Publisher heatmap_pub;
+    // Published by pointer, refilled once no subscriber holds it anymore
+    toaster_msgs::HeatmapPtr heatmap_msg;
+    // On the clock of the entities, as the heatmap
+    unsigned long lastHeatmapTime = 0;
+    if (heatmapEnabled) {
+        if (heatmapWidth > 0 && heatmapHeight > 0 && heatmapResolution > 0.0 && heatmapDecayTime > 0.0 && heatmapRate > 0.0) {
+            heatmap_ = new Heatmap(heatmapOriginX, heatmapOriginY, heatmapWidth, heatmapHeight, heatmapResolution, heatmapDecayTime);
+            heatmap_pub = node.advertise<toaster_msgs::Heatmap>("area_manager/heatmap", 1);
+            ROS_INFO("[area_manager] Publishing %s heatmap of %dx%d cells", heatmapEntityType.c_str(), heatmapWidth, heatmapHeight);
+        } else
+            ROS_WARN("[area_manager][WARNING] heatmap parameters should be positive, heatmap disabled");
+    }
+
+    // Area map loaded at start
+    if (node.hasParam("/area_manager/areaMapFile")) {
+        std::string areaMapFile;
+        unsigned int nbLoaded = 0;
+        node.getParam("/area_manager/areaMapFile", areaMapFile);
+        if (loadAreaMap(areaMapFile, mapArea_, nbLoaded))
+            ROS_INFO("[area_manager] Loaded %d Areas from %s", nbLoaded, areaMapFile.c_str());
+    }
+
     ros::ServiceServer serviceRemove = node.advertiseService("area_manager/remove_area", removeArea);
     ROS_INFO("Ready to remove Area.");
 
@@ -464,12 +909,39 @@ int main(int argc, char** argv) {
     ros::ServiceServer servicePrintAll = node.advertiseService("area_manager/print_all_areas", printAllAreas);
     ROS_INFO("Ready to print Areas.");
 
-    ros::ServiceServer serviceRelativePose = node.advertiseService("area_manager/get_relative_position", getRelativePosition);
+    // Number of threads used to evaluate areas and to answer relative position requests
+    int nbThreads = std::thread::hardware_concurrency();
+    if (node.hasParam("/area_manager/nbThreads"))
+        node.getParam("/area_manager/nbThreads", nbThreads);
+    if (nbThreads < 1)
+        nbThreads = 1;
+    ROS_INFO("[area_manager] Using %d threads", nbThreads);
+
+    ThreadPool areaPool(nbThreads);
+
+    // Relative position requests are answered by the idle workers of the pool so that
+    // they are not delayed by the area computation of the main loop.
+    // Without worker, they are answered by the main loop.
+    PoolCallbackQueue relativePositionQueue(areaPool);
+    ros::CallbackQueueInterface* relativePositionCallbacks = &relativePositionQueue;
+    if (areaPool.size() < 2)
+        relativePositionCallbacks = node.getCallbackQueue();
+
+    ros::AdvertiseServiceOptions relativePoseOpts = ros::AdvertiseServiceOptions::create<toaster_msgs::GetRelativePosition>(
+            "area_manager/get_relative_position", getRelativePosition, ros::VoidConstPtr(), relativePositionCallbacks);
+    ros::ServiceServer serviceRelativePose = node.advertiseService(relativePoseOpts);
     ROS_INFO("Ready to print get relative position.");
 
-    ros::ServiceServer serviceMultiRelativePose = node.advertiseService("area_manager/get_multiple_relative_position", getMultiRelativePosition);
+    ros::AdvertiseServiceOptions multiRelativePoseOpts = ros::AdvertiseServiceOptions::create<toaster_msgs::GetMultiRelativePosition>(
+            "area_manager/get_multiple_relative_position", getMultiRelativePosition, ros::VoidConstPtr(), relativePositionCallbacks);
+    ros::ServiceServer serviceMultiRelativePose = node.advertiseService(multiRelativePoseOpts);
     ROS_INFO("Ready to print get relative position in an agent perspective.");
 
+    ros::AdvertiseServiceOptions relativePosesOpts = ros::AdvertiseServiceOptions::create<toaster_msgs::GetRelativePositions>(
+            "area_manager/get_relative_positions", getRelativePositions, ros::VoidConstPtr(), relativePositionCallbacks);
+    ros::ServiceServer serviceRelativePoses = node.advertiseService(relativePosesOpts);
+    ROS_INFO("Ready to get relative positions of several entities.");
+
     ros::ServiceServer servicepublishAllArea = node.advertiseService("area_manager/publish_all_areas", publishAllAreas);
     ROS_INFO("Ready to publish all areas.");
 
@@ -480,16 +952,29 @@ int main(int argc, char** argv) {
     // Set this in a ros service?
     ros::Rate loop_rate(30);
 
+    // Global queue for the executable, queue of the nodelet otherwise
+    ros::CallbackQueue* queue = static_cast<ros::CallbackQueue*>(node.getCallbackQueue());
+
     /************************/
     /* Start of the Ros loop*/
     /************************/
 
+    // Facts of each worker, merged in area order at the end of the loop
+    unsigned int nbWorkers = areaPool.size();
+    std::vector<std::vector<toaster_msgs::Fact> > workerFacts(nbWorkers);
+    std::vector<AreaTask> areaTasks;
+
+    // In area tests: entities with their slot, areas with their states and changes found by each worker
+    std::vector<std::pair<Entity*, unsigned int> > inAreaEntities;
+    std::vector<std::pair<Area*, AreaStates_t*> > inAreaTasks;
+    std::vector<std::vector<AreaEvent> > workerEvents(nbWorkers);
+
     //TODO: remove human / robot id and do it for all
     while (node.ok()) {
-        toaster_msgs::FactList factList_msg;
-        toaster_msgs::Fact fact_msg;
+        // Published by pointer: nodelets of the same manager receive them without copy
+        toaster_msgs::FactListPtr factList_msg(new toaster_msgs::FactList);
 
-        toaster_msgs::AreaList areaList_msg;
+        toaster_msgs::AreaListPtr areaList_msg(new toaster_msgs::AreaList);
 
         ////////////////////////////////
         // Updating situational Areas //
@@ -501,194 +986,138 @@ int main(int argc, char** argv) {
         //     get area owner
         //     update area with owner position
 
-        // Humans
+        // Humans, with their joints
         for (std::map<std::string, Human*>::iterator it = humanRd.lastConfig_.begin(); it != humanRd.lastConfig_.end(); ++it) {
-            // We update area with human center
+            bool present = presenceTimeout <= 0.0 || humanRd.isPresent(it->first, presenceTimeout);
             for(std::map<std::string, Joint*>::iterator it2 = it->second->skeleton_.begin() ; it2 != it->second->skeleton_.end() ; ++it2)
-                mapEntities_[it2->first]=it2->second;
-            mapEntities_[it->first] = it->second;
-            updateEntityArea(mapArea_, it->second);
+                if (present)
+                    mapEntities_[it2->first]=it2->second;
+                else
+                    removeEntity(it2->first);
         }
+        updateEntities(humanRd, presenceTimeout);
 
         // Robots
-        for (std::map<std::string, Robot*>::iterator it = robotRd.lastConfig_.begin(); it != robotRd.lastConfig_.end(); ++it) {
-            // We update area with robot center
-            mapEntities_[it->first] = it->second;
-            updateEntityArea(mapArea_, it->second);
-        }
+        updateEntities(robotRd, presenceTimeout);
 
         // Objects
-        for (std::map<std::string, Object*>::const_iterator it = objectRd.lastConfig_.begin(); it != objectRd.lastConfig_.end(); ++it) {
-            // We update area with object center
-            mapEntities_[it->first] = it->second;
-            updateEntityArea(mapArea_, it->second);
-        }
+        updateEntities(objectRd, presenceTimeout);
 
+        // Copy of the poses for the relative position services
+        updatePoseTable();
 
         /////////////////////////////////
         // Updating in Area properties //
         /////////////////////////////////
 
 
-        for (std::map<std::string, Entity*>::iterator it = mapEntities_.begin(); it != mapEntities_.end(); ++it) {
-            // We update area with owners
-            updateInArea(it->second, mapArea_);
+        // Slots and states are looked up here, the workers only modify their areas.
+        inAreaEntities.clear();
+        for (std::map<std::string, Entity*>::iterator it = mapEntities_.begin(); it != mapEntities_.end(); ++it)
+            inAreaEntities.push_back(std::make_pair(it->second, areaStates_.addEntity(it->first)));
+
+        inAreaTasks.clear();
+        for (std::map<unsigned int, Area*>::iterator itArea = mapArea_.begin(); itArea != mapArea_.end(); ++itArea)
+            inAreaTasks.push_back(std::make_pair(itArea->second, &areaStates_.getArea(itArea->second)));
+
+        areaPool.run(nbWorkers, [&](unsigned int worker) {
+            workerEvents[worker].clear();
+            size_t first = worker * inAreaTasks.size() / nbWorkers;
+            size_t last = (worker + 1) * inAreaTasks.size() / nbWorkers;
+            for (size_t i = first; i < last; ++i)
+                testArea(inAreaTasks[i].first, *inAreaTasks[i].second, inAreaEntities, workerEvents[worker]);
+        });
+
+        // Applied in area order, each entity gets its changes in the same order as a single thread would give
+        for (unsigned int worker = 0; worker < nbWorkers; ++worker)
+            for (std::vector<AreaEvent>::const_iterator it = workerEvents[worker].begin(); it != workerEvents[worker].end(); ++it)
+                applyAreaEvent(*it);
+
+        if (heatmap_ != NULL) {
+            for (std::vector<std::pair<Entity*, unsigned int> >::const_iterator it = inAreaEntities.begin(); it != inAreaEntities.end(); ++it)
+                if (areaCompatible(heatmapEntityType, it->first->getEntityType()))
+                    heatmap_->updateEntity(it->second, it->first->getPosition().get<0>(),
+                        it->first->getPosition().get<1>(), it->first->getTime());
+
+            if (heatmap_->getTime() >= lastHeatmapTime + 1e9 / heatmapRate) {
+                if (!heatmap_msg || !heatmap_msg.unique())
+                    heatmap_msg.reset(new toaster_msgs::Heatmap);
+                heatmap_msg->header.stamp.fromNSec(heatmap_->getTime());
+                heatmap_msg->header.frame_id = "/map";
+                heatmap_->fillMsg(*heatmap_msg);
+                heatmap_pub.publish(heatmap_msg);
+                lastHeatmapTime = heatmap_->getTime();
+            }
         }
 
         ///////////////////////////////////////
         // Computing facts for each entities //
         ///////////////////////////////////////
 
-        // TODO: replace code by a function for each fact computation
-
+        // Owners and populations are looked up here, the workers only read entities.
+        areaTasks.clear();
         for (std::map<unsigned int, Area*>::iterator itArea = mapArea_.begin(); itArea != mapArea_.end(); ++itArea) {
-            double areaDensity = 0.0;
-            unsigned long densityTime = 0;
-
-            Entity* ownerEnt = NULL;
+            AreaTask task;
+            task.area = itArea->second;
+            task.ownerEnt = NULL;
 
             // Computation depending on owner
             if (itArea->second->getMyOwner() != "") {
 
                 // Let's find back the area owner:
                 if (robotRd.lastConfig_.find(itArea->second->getMyOwner()) != robotRd.lastConfig_.end())
-                    ownerEnt = robotRd.lastConfig_[itArea->second->getMyOwner()];
+                    task.ownerEnt = robotRd.lastConfig_[itArea->second->getMyOwner()];
 
                 else if (humanRd.lastConfig_.find(itArea->second->getMyOwner()) != humanRd.lastConfig_.end())
-                    ownerEnt = humanRd.lastConfig_[itArea->second->getMyOwner()];
+                    task.ownerEnt = humanRd.lastConfig_[itArea->second->getMyOwner()];
 
                 else if (objectRd.lastConfig_.find(itArea->second->getMyOwner()) != objectRd.lastConfig_.end())
-                    ownerEnt = objectRd.lastConfig_[itArea->second->getMyOwner()];
+                    task.ownerEnt = objectRd.lastConfig_[itArea->second->getMyOwner()];
             }
 
-            for (std::map<std::string, Entity*>::iterator itEntity = mapEntities_.begin(); itEntity != mapEntities_.end(); ++itEntity) {
-
-                if (itEntity->second->isInArea(itArea->first)) {
-
-                    // compute facts according to factType
-                    // TODO: instead of calling it interaction, make a list of facts to compute?
-
-                    if (itArea->second->getFactType() == "interaction") {
-
-                        // If it is an interacting area, we need the owner!
-                        if (ownerEnt != NULL) {
-
-                            // Now let's compute isFacing
-                            //////////////////////////////
-
-                            double confidence = 0.0;
-                            // This is the actual angle between subject orientation
-                            // and target. It gives left / right relation
-                            // If positive, target is at right!
-                            double angleResult = 0.0;
-                            confidence = isFacing(itEntity->second, ownerEnt, 0.5, angleResult);
-                            if (confidence > 0.0)
-                            {
-                                //Fact Facing
-                                fact_msg.property = "IsFacing";
-                                fact_msg.propertyType = "posture";
-                                fact_msg.subProperty = "angle";
-                                fact_msg.subjectId = itEntity->first;
-                                fact_msg.targetId = ownerEnt->getId();
-                                fact_msg.confidence = confidence;
-                                fact_msg.stringValue = true;
-                                fact_msg.doubleValue = angleResult;
-                                fact_msg.valueType = 0;
-                                fact_msg.factObservability = 0.5;
-                                fact_msg.time = itEntity->second->getTime();
-
-                                factList_msg.factList.push_back(fact_msg);
-                            }
-
-                            // Compute here other facts linked to interaction
-                            //////////////////////////////////////////////////
-                        } // ownerEnt!= NULL
-
-                    } else if (itArea->second->getFactType() == "density") {
-                        areaDensity += 1.0;
-                        densityTime = itEntity->second->getTime();
-                    } else if (itArea->second->getFactType() == "") {
-
-                    } else
-                        printf("[area_manager][WARNING] Area %s has factType %s, which is not available\n", itArea->second->getName().c_str(), itArea->second->getFactType().c_str());
-
-                    if (ownerEnt != NULL)
-                      fact_msg.targetOwnerId = ownerEnt->getId();
-                    fact_msg.propertyType = "position";
-                    fact_msg.subProperty = itArea->second->getAreaType();
-                    fact_msg.subjectId = itEntity->first;
-                    fact_msg.targetId = itArea->second->getName();
-                    fact_msg.confidence = 1;
-                    fact_msg.factObservability = 0.8;
-                    fact_msg.time = itEntity->second->getTime();
-                    fact_msg.valueType = 0;
-                    fact_msg.stringValue = "true";
-
-                    if (itArea->second->getAreaType() == "room") //Fact in Area
-                      fact_msg.property = "IsInRoom";
-                    else if (itArea->second->getAreaType() == "support")
-                    { //Fact in Area
-                      fact_msg.property = "IsAt";
-                      fact_msg.subProperty = "location";
-                    }
-                    else //Fact in Area
-                      fact_msg.property = "IsInArea";
-
-                    factList_msg.factList.push_back(fact_msg);
-                }
-            }// For all Entities
-
-            // We compute here the density
-            if (itArea->second->getFactType() == "density") {
-                // -1 is a hack to remove centroid
-                int fullPopulation = -1;
-                if (itArea->second->getEntityType() == "humans" || itArea->second->getEntityType() == "agents"
-                        || itArea->second->getEntityType() == "entities")
-                    fullPopulation += humanRd.lastConfig_.size();
-
-                if (itArea->second->getEntityType() == "robots" || itArea->second->getEntityType() == "agents"
-                        || itArea->second->getEntityType() == "entities")
-                    fullPopulation += robotRd.lastConfig_.size();
-
-                if (itArea->second->getEntityType() == "objects" || itArea->second->getEntityType() == "entities")
-                    fullPopulation += objectRd.lastConfig_.size();
-
-                if (fullPopulation == 0)
-                    areaDensity = 0;
-                else
-                    areaDensity /= fullPopulation;
+            // -1 is a hack to remove centroid
+            task.fullPopulation = -1;
+            if (itArea->second->getEntityType() == "humans" || itArea->second->getEntityType() == "agents"
+                    || itArea->second->getEntityType() == "entities")
+                task.fullPopulation += humanRd.lastConfig_.size();
 
-                if (ownerEnt != NULL) {
-                    fact_msg.subjectOwnerId = ownerEnt->getId();
-                }
-
-                //Fact Density
-                fact_msg.property = "AreaDensity";
-                fact_msg.propertyType = "density";
-                fact_msg.subProperty = "ratio";
-                fact_msg.subjectId = itArea->first;
-                fact_msg.targetId = "";
-                fact_msg.confidence = 1.0;
-                fact_msg.doubleValue = areaDensity;
-                fact_msg.valueType = 1;
-                fact_msg.factObservability = 0.0;
-                fact_msg.time = densityTime;
-
-                factList_msg.factList.push_back(fact_msg);
-            }// Density
-
-        }// for all area
+            if (itArea->second->getEntityType() == "robots" || itArea->second->getEntityType() == "agents"
+                    || itArea->second->getEntityType() == "entities")
+                task.fullPopulation += robotRd.lastConfig_.size();
+
+            if (itArea->second->getEntityType() == "objects" || itArea->second->getEntityType() == "entities")
+                task.fullPopulation += objectRd.lastConfig_.size();
+
+            areaTasks.push_back(task);
+        }
+
+        // Each worker takes a contiguous range of areas and fills its own buffer
+        areaPool.run(nbWorkers, [&](unsigned int worker) {
+            workerFacts[worker].clear();
+            size_t first = worker * areaTasks.size() / nbWorkers;
+            size_t last = (worker + 1) * areaTasks.size() / nbWorkers;
+            for (size_t i = first; i < last; ++i)
+                computeAreaFacts(areaTasks[i], workerFacts[worker]);
+        });
+
+        // Ranges are ordered, so facts come out in the same order as a single thread would give
+        for (unsigned int worker = 0; worker < nbWorkers; ++worker)
+            factList_msg->factList.insert(factList_msg->factList.end(), workerFacts[worker].begin(), workerFacts[worker].end());
 
         if (publishingArea_) {
-            setAreaMsg(areaList_msg);
+            setAreaMsg(*areaList_msg);
             area_pub.publish(areaList_msg);
         }
 
         fact_pub.publish(factList_msg);
 
-        ros::spinOnce();
+        queue->callAvailable();
 
         loop_rate.sleep();
     }
+    delete heatmap_;
+    heatmap_ = NULL;
     return 0;
 }
+
+} // namespace area_manager
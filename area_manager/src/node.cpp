@@ -0,0 +1,9 @@
+#include "area_manager/AreaManagerNode.h"
+
+int main(int argc, char** argv) {
+    ros::init(argc, argv, "area_manager");
+    ros::NodeHandle node;
+    ros::NodeHandle privateNode("~");
+
+    return area_manager::run(node, privateNode);
+}
@@ -0,0 +1,12 @@
+#include <pluginlib/class_list_macros.h>
+#include <toaster_msgs/LoopNodelet.h>
+
+#include "area_manager/AreaManagerNode.h"
+
+namespace area_manager {
+
+typedef LoopNodelet<&run> AreaManagerNodelet;
+
+} // namespace area_manager
+
+PLUGINLIB_EXPORT_CLASS(area_manager::AreaManagerNodelet, nodelet::Nodelet)
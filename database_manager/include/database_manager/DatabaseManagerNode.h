@@ -0,0 +1,21 @@
+/*
+ * File:   DatabaseManagerNode.h
+ *
+ * Loop of the database server, run by the run_server executable and by the
+ * database_manager/DatabaseManagerNodelet nodelet.
+ */
+
+#ifndef DATABASEMANAGERNODE_H
+#define DATABASEMANAGERNODE_H
+
+#include "ros/ros.h"
+
+namespace database_manager {
+
+// Stores the facts read until node is shut down.
+// Callbacks run on the queue of node, privateNode is the private namespace of the node.
+int run(ros::NodeHandle& node, ros::NodeHandle& privateNode);
+
+} // namespace database_manager
+
+#endif /* DATABASEMANAGERNODE_H */
@@ -0,0 +1,13 @@
+#include "database_manager/DatabaseManagerNode.h"
+
+/**
+ * Main function
+ * @return 0
+ */
+int main(int argc, char **argv) {
+    ros::init(argc, argv, "database_server");
+    ros::NodeHandle node;
+    ros::NodeHandle privateNode("~");
+
+    return database_manager::run(node, privateNode);
+}
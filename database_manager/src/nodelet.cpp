@@ -0,0 +1,12 @@
+#include <pluginlib/class_list_macros.h>
+#include <toaster_msgs/LoopNodelet.h>
+
+#include "database_manager/DatabaseManagerNode.h"
+
+namespace database_manager {
+
+typedef LoopNodelet<&run> DatabaseManagerNodelet;
+
+} // namespace database_manager
+
+PLUGINLIB_EXPORT_CLASS(database_manager::DatabaseManagerNodelet, nodelet::Nodelet)
@@ -21,8 +21,12 @@
 #include "toaster_msgs/Id.h"
 #include "toaster_msgs/FactList.h"
 #include "toaster_msgs/DatabaseTables.h"
+#include "database_manager/DatabaseManagerNode.h"
+#include <ros/callback_queue.h>
 #include <fstream>
 
+namespace database_manager {
+
 std::vector<std::string> agentList;
 ros::Time begin ;
 std::vector<toaster_msgs::Fact> myFactList;
@@ -2509,12 +2513,12 @@ void initServer() {
 }
 
 /**
- * Main function
+ * Loop of the database server
+ * @param node 		node of the services and fact readers, its queue is called by the loop
+ * @param privateNode 	private namespace of the node
  * @return 0
  */
-int main(int argc, char **argv) {
-    ros::init(argc, argv, "database_server");
-    ros::NodeHandle node;
+int run(ros::NodeHandle& node, ros::NodeHandle& privateNode) {
     begin = ros::Time::now();
     //// SERVICES DECLARATION  /////
 
@@ -2592,10 +2596,13 @@ int main(int argc, char **argv) {
 
     ros::Rate loop_rate(30);
 
-    while (ros::ok()) {
+    // Global queue for the executable, queue of the nodelet otherwise
+    ros::CallbackQueue* queue = static_cast<ros::CallbackQueue*>(node.getCallbackQueue());
+
+    while (node.ok()) {
         //std::cout << "\n\n\n";
         //db.readDb();
-        ros::spinOnce();
+        queue->callAvailable();
         update_world_states(node, factsReaders);
         conceptual_perspective_taking();
         if(publishInTopic){
@@ -2605,7 +2612,8 @@ int main(int argc, char **argv) {
                   it->facts = res.second.factList;
                }
             }
-            tablesPublisher.publish(tables);
+            // tables is updated in place, subscribers of the same process get a copy by pointer
+            tablesPublisher.publish(toaster_msgs::DatabaseTablesPtr(new toaster_msgs::DatabaseTables(tables)));
             for(std::vector<toaster_msgs::DatabaseTable>::iterator it = tables.tables.begin(); it != tables.tables.end(); it++){
                it->changed = false;
             }
@@ -2616,5 +2624,4 @@ int main(int argc, char **argv) {
     return 0;
 }
 
-
-
+} // namespace database_manager
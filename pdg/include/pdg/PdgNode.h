@@ -0,0 +1,20 @@
+/*
+ * File:   PdgNode.h
+ *
+ * Loop of pdg, run by the pdg executable and by the pdg/PdgNodelet nodelet.
+ */
+
+#ifndef PDGNODE_H
+#define PDGNODE_H
+
+#include <ros/ros.h>
+
+namespace pdg {
+
+// Reads the streams and publishes the lists until node is shut down.
+// Callbacks run on the queue of node, privateNode is the private namespace of the node.
+int run(ros::NodeHandle& node, ros::NodeHandle& privateNode);
+
+} // namespace pdg
+
+#endif /* PDGNODE_H */
@@ -18,7 +18,7 @@
 
 class AdreamMocapHumanReader : public HumanReader {
 public:
-    AdreamMocapHumanReader(bool fullHuman);
+    AdreamMocapHumanReader(bool fullHuman = false);
     virtual ~AdreamMocapHumanReader() {};
 
     void init(ros::NodeHandle* node,
@@ -26,8 +26,9 @@ public:
               std::string topicHead = "/optitrack/bodies/Rigid_Body_1",
               std::string topicHand = "/optitrack/bodies/Rigid_Body_2",
               std::string param = "/pdg/adreamMocapHuman");
+    void initialize(ros::NodeHandle* node, const std::string& name);
 
-    virtual void Publish(struct toasterList_t& list_msg);
+    virtual void fillSnapshot(ListFiller& list);
 
 private:
     bool torso_;
@@ -22,6 +22,7 @@ public:
 		~GazeboObjectReader() {};
 
     void init(ros::NodeHandle* node, std::string topic, std::string param);
+    void initialize(ros::NodeHandle* node, const std::string& name);
 
 private:
     void CallbackObj(const gazebo_msgs::ModelStates::ConstPtr& msg);
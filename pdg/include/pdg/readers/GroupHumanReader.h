@@ -18,10 +18,11 @@
 
 class GroupHumanReader : public HumanReader {
 public:
-    GroupHumanReader(bool fullHuman);
+    GroupHumanReader(bool fullHuman = false);
     ~GroupHumanReader();
 
     void init(ros::NodeHandle* node, std::string topic, std::string param);
+    void initialize(ros::NodeHandle* node, const std::string& name);
 
 private:
     ros::Subscriber sub_;
@@ -27,7 +27,9 @@ class HumanReader : public Reader<Human>
     HumanReader(const HumanReader&) = delete;
     virtual ~HumanReader();
 
-    virtual void Publish(struct toasterList_t& list_msg);
+    virtual void fillSnapshot(ListFiller& list);
+
+    Kind_t getKind() const { return HUMAN; }
 
     void setFullConfig(bool fullConfig) {fullHuman_ = fullConfig; }
     void setFullConfig(std::string param)
@@ -39,9 +41,7 @@ class HumanReader : public Reader<Human>
   public:
     bool fullHuman_;
 
-    bool isPresent(std::string id);
-
-    toaster_msgs::Fact DefaultFactMsg(std::string subjectId, uint64_t factTime);
+    void DefaultFactMsg(toaster_msgs::Fact& fact_msg, const std::string& subjectId, uint64_t factTime);
 };
 
 #endif	/* HUMANREADER_H */
@@ -13,11 +13,12 @@
 
 class MocapHumanReader : public HumanReader {
 public:
-    MocapHumanReader(bool fullHuman);
+    MocapHumanReader(bool fullHuman = false);
     MocapHumanReader(const MocapHumanReader&) = delete;
     virtual ~MocapHumanReader();
 
     void init(ros::NodeHandle* node, std::string topic, std::string param);
+    void initialize(ros::NodeHandle* node, const std::string& name);
 
 private:
     ros::Subscriber sub_;
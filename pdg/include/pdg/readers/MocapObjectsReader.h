@@ -9,6 +9,7 @@
 #define	MOCAPOBJECTSREADER_H
 
 //This class read topic from mocap and converts data into toaster-lib type.
+//It is the mocap objects stream, with an object reader for each topic.
 
 #include "ObjectReader.h"
 #include "pdg/readers/MocapObjectReader.h"
@@ -18,19 +19,23 @@
 #include <vector>
 #include "optitrack/or_pose_estimator_state.h"
 
-class MocapObjectsReader {
+class MocapObjectsReader : public ReaderBase {
 public:
     MocapObjectsReader() {};
-    ~MocapObjectsReader();
+    virtual ~MocapObjectsReader();
 
     void init(ros::NodeHandle* node,
               std::string topics,
               std::string ids,
               std::string param = "/pdg/MocapObject");
 
+    void initialize(ros::NodeHandle* node, const std::string& name);
+
+    Kind_t getKind() const { return OBJECT; }
+
     void setActivation(bool activated);
 
-    void extract(std::vector<ObjectReader*>& objectReaders);
+    void updateEntityPose(Entity& newPoseEnt);
 
 private:
   std::vector<MocapObjectReader*> readers_;
@@ -12,21 +12,22 @@
 
 #include "HumanReader.h"
 
-#include <tf/transform_listener.h>
 #include <string>
 
+#include "pdg/utility/TfSampler.h"
+
 class MorseHumanReader : public HumanReader
 {
 
   public:
     //Constructor
-    MorseHumanReader(bool fullHuman);
-    //Destructor
-    virtual ~MorseHumanReader();
+    MorseHumanReader(bool fullHuman = true);
 
     void init(ros::NodeHandle* node, std::string param);
-    void updateHumans(tf::TransformListener &listener);
-    void updateHuman(tf::TransformListener &listener, std::string humId, std::string humanBase);
+    void initialize(ros::NodeHandle* node, const std::string& name);
+    void update(TfSampler &sampler) { updateHumans(sampler); }
+    void updateHumans(TfSampler &sampler);
+    void updateHuman(TfSampler &sampler, std::string humId, std::string humanBase);
 
   private:
     //static void humanJointStateCallBack(const sensor_msgs::JointState::ConstPtr& msg);
@@ -21,8 +21,9 @@ public:
     virtual ~OM2MObjectReader() {};
 
     void init(ros::NodeHandle* node, std::string topic, std::string param);
+    void initialize(ros::NodeHandle* node, const std::string& name);
 
-    virtual void Publish(struct toasterList_t& list_msg);
+    virtual void fillSnapshot(ListFiller& list);
 
 private:
     void newValueCallBack(const toaster_msgs::IoTData::ConstPtr& msg);
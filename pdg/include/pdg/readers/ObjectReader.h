@@ -16,11 +16,13 @@
 #include <ros/ros.h>
 #include "toaster-lib/MovableObject.h"
 #include "pdg/readers/Reader.h"
+#include "pdg/utility/EntityFusion.h"
 #include "pdg/types.h"
 #include <map>
 #include <string>
 #include <unistd.h>
 #include <mutex>
+#include <atomic>
 #include <toaster_msgs/FactList.h>
 
 class ObjectReader : public Reader<MovableObject>{
@@ -30,8 +32,22 @@ public:
 
   static std::map<std::string, MovableObject*> globalLastConfig_;
 
-  virtual void Publish(struct toasterList_t& list_msg) {};
-  void Publish(struct toasterList_t& list_msg, struct objectIn_t& objectIn);
+  // Publisher side: appends the present objects, rebuilt if they are stale, and the facts of the
+  // object readers, now is the time of the publication on the steady clock.
+  // Returns the newest object time if they were rebuilt, 0 otherwise
+  static uint64_t Publish(ListFiller& list, struct objectIn_t& objectIn, PresenceMonitor::Clock::time_point now);
+
+  // Objects not updated for timeout s are not published, never if timeout <= 0 (default)
+  static void setPresenceTimeout(double timeout) { objectsPresence_.setTimeout(timeout); }
+
+  // Poses of an object measured by several readers are fused if they are at most window s older
+  // than the one received, and closer than gate m to the freshest one (no gate if gate <= 0)
+  static void setFusion(double gate, double window);
+
+  // Takes lastConfigMutex_, as all the writers of globalLastConfig_
+  void updateEntityPose(Entity& newPoseEnt);
+
+  Kind_t getKind() const { return OBJECT; }
 
   protected:
   ros::Subscriber sub_;
@@ -39,14 +55,61 @@ public:
   static unsigned int nbObjects_; /// total object number
   unsigned int nbLocalObjects_;
 
-  bool isPresent(std::string id);
   void increaseNbObjects();
 
-  toaster_msgs::Fact DefaultFactMsg(string id, MovableObject* object, struct objectIn_t& objectIn);
-  void putInHand(struct objectIn_t& objectIn, string id, MovableObject* object, struct toasterList_t& list_msg);
+  // Sets the pose of object measured by this reader at time. The position is fused with the last
+  // positions measured by the other readers, the orientation is the one of the freshest measure.
+  // Measures older than the fusion window are dropped. Called with lastConfigMutex_ held.
+  void setMeasuredPose(MovableObject* object, const bg::model::point<double, 3, bg::cs::cartesian>& position,
+                       const std::vector<double>& orientation, uint64_t time);
 
+  static void DefaultFactMsg(toaster_msgs::Fact& fact_msg, const string& id, uint64_t time, struct objectIn_t& objectIn);
+  static void putInHand(struct objectIn_t& objectIn, toaster_msgs::Object& object_msg, ListFiller& list);
+
+  // Writer side: globalLastConfig_ changed, the objects are rebuilt before the next publication.
+  // Called with lastConfigMutex_ held, it does not go through the objects.
+  static void commitObjects();
+
+  // Held by the writers of globalLastConfig_, and by the publisher while it rebuilds objectsSnapshot_
+  // if it gets it without waiting
   static std::mutex lastConfigMutex_;
   static std::vector<ObjectReader*> childs_;
+
+private:
+  // All the object readers, with the ones not in childs_
+  static std::vector<ObjectReader*> objectReaders_;
+
+  // True if a reader other than this one has id in its lastConfig_
+  bool isSharedObject(const std::string& id) const;
+
+  // Publisher side: fills objectsSnapshot_ from the object readers, with lastConfigMutex_ held
+  static void buildObjects();
+
+  static std::atomic<bool> objectsStale_;
+  static toasterList_t objectsSnapshot_;
+  static ListFiller objectsFiller_;
+  static OrientationCache objectsOrientations_;
+
+  // Pose given by the hand holding an object, kept once released until the object is updated (publisher only)
+  static std::map<std::string, toaster_msgs::Entity> handPoses_;
+
+  struct Measure_t
+  {
+    ObjectReader* reader;
+    uint64_t time;
+    EntityFusion::Position_t position;
+    std::vector<double> orientation;
+  };
+
+  // Last pose measured by each reader of an object, and confidence of the fused position
+  static std::map<std::string, std::vector<Measure_t> > measures_;
+  static std::map<std::string, double> confidences_;
+  static double fusionGate_;
+  static uint64_t fusionWindow_; // ns
+
+  // Publisher only
+  static PresenceMonitor objectsPresence_;
+  static std::vector<std::string> objectsExpired_;
 };
 
 #endif /* OBJECTREADER_H */
@@ -13,17 +13,19 @@
 #include "RobotReader.h"
 
 #include <ostream>
-#include <tf/transform_listener.h>
 #include "sensor_msgs/JointState.h"
 
+#include "pdg/utility/TfSampler.h"
+
 class Pr2RobotReader : public RobotReader {
 public:
-    Pr2RobotReader(bool fullRobot);
-    ~Pr2RobotReader();
+    Pr2RobotReader(bool fullRobot = true);
 
     void init(ros::NodeHandle* node, std::string param);
+    void initialize(ros::NodeHandle* node, const std::string& name);
+    void update(TfSampler &sampler) { updateRobot(sampler); }
 
-    void updateRobot(tf::TransformListener &listener);
+    void updateRobot(TfSampler &sampler);
 
 private:
     bool initJointsName_;
@@ -31,7 +33,8 @@ private:
     std::vector<std::string> pr2JointsName_;
     //void initJointsName();
 
-    void setRobotJointLocation(tf::TransformListener &listener, Joint* joint);
+    // Sets the pose of entity from the frame of joint, returns false if there is no new pose
+    bool setRobotJointLocation(TfSampler &sampler, const std::string& jointName, Entity* entity);
     void pr2JointStateCallBack(const sensor_msgs::JointState::ConstPtr& msg);
 };
 
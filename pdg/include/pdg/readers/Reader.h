@@ -14,34 +14,90 @@
 #include <string>
 #include <toaster_msgs/SetEntityPose.h>
 #include <ostream>
+#include <mutex>
+#include <algorithm>
+#include <atomic>
 
+#include "pdg/types.h"
 #include "pdg/utility/EntityUtility.h"
+#include "pdg/utility/ListFiller.h"
+#include "pdg/utility/UpdateSignal.h"
+#include "pdg/utility/PresenceMonitor.h"
+#include "pdg/readers/ReaderBase.h"
 
 template <typename T>
-class Reader{
+class Reader : public ReaderBase {
 
 public:
-  Reader() {node_ = nullptr; activated_ = false; }
+  Reader() {node_ = nullptr; activated_ = false; filterPresence_ = false; sigma_ = 0.1; stale_ = false; }
   Reader(const Reader&) = delete;
   ~Reader() {}
 
   void init(ros::NodeHandle* node, std::string param)
   {
     node_ = node;
+    name_ = param.substr(param.find_last_of('/') + 1);
     if (node_->hasParam(param))
         node_->getParam(param, activated_);
+
+    // Streams filtering presence use the common timeout, others keep their entities
+    // unless they have their own timeout
+    double presenceTimeout = 0.0;
+    if (filterPresence_)
+    {
+      presenceTimeout = 1.0;
+      node_->getParam("/pdg/presenceTimeout", presenceTimeout);
+    }
+    node_->getParam("/pdg/presenceTimeouts/" + name_, presenceTimeout);
+    presence_.setTimeout(presenceTimeout);
+
+    node_->getParam("/pdg/fusionSigmas/" + name_, sigma_);
   }
 
   void setActivation(bool activated) {activated_ = activated; }
+  double getSigma() const { return sigma_; }
 
   bool activated_;
+  std::string name_; // stream name, from its activation parameter
+  double sigma_; // standard deviation of the positions of the stream, in m, to fuse them with other streams
   ros::NodeHandle* node_;
   std::map<std::string, T*> lastConfig_;
 
-  virtual bool isPresent(std::string id) = 0;
+  // Writers of lastConfig_ (callbacks, tf updates, pose requests) hold writeMutex_ and then
+  // mark the snapshot stale, tf is resolved before. The publisher rebuilds it at most once per
+  // publication, when it gets writeMutex_ without waiting.
+  std::mutex writeMutex_;
 
   void updateEntityPose(Entity& newPoseEnt, std::string id, Entity* storedEntity);
-  void updateEntityPose(Entity& newPoseEnt);
+  virtual void updateEntityPose(Entity& newPoseEnt);
+
+  // Publisher side: appends the present entities of the snapshot, rebuilt if it is stale, to the list
+  // being filled, now is the time of the publication on the steady clock.
+  // Returns the newest entity time of the snapshot if it was rebuilt, 0 otherwise
+  virtual uint64_t appendSnapshot(ListFiller& list, PresenceMonitor::Clock::time_point now);
+
+protected:
+  // Fills the messages of lastConfig_, called by the publisher with writeMutex_ held.
+  // Entities are filled with orientations_, which begins with the snapshot.
+  virtual void fillSnapshot(ListFiller& list) {}
+
+  // Writer side: lastConfig_ changed, the snapshot is rebuilt before the next publication.
+  // Called with writeMutex_ held, it does not go through the entities.
+  void commitSnapshot();
+
+  // If true, entities (and their isPresent facts) not updated for /pdg/presenceTimeout are not published
+  bool filterPresence_;
+
+  OrientationCache orientations_;
+
+private:
+  std::atomic<bool> stale_; // set by the writers, cleared by the publisher with writeMutex_
+
+  // Publisher only
+  toasterList_t snapshot_;
+  ListFiller snapshotFiller_;
+  PresenceMonitor presence_;
+  std::vector<std::string> expired_;
 };
 
 template <typename T>
@@ -58,8 +114,96 @@ void Reader<T>::updateEntityPose(Entity& newPoseEnt, std::string id, Entity* sto
 template <typename T>
 void Reader<T>::updateEntityPose(Entity& newPoseEnt)
 {
+  std::lock_guard<std::mutex> lock(writeMutex_);
   for (typename std::map<std::string, T*>::iterator it = lastConfig_.begin(); it != lastConfig_.end(); ++it)
       updateEntityPose(newPoseEnt, it->first, (Entity*)it->second);
+
+  // newPoseEnt id is reset once it was applied
+  if(newPoseEnt.getId() == "")
+    commitSnapshot();
+}
+
+template <typename T>
+void Reader<T>::commitSnapshot()
+{
+  stale_ = true;
+  UpdateSignal::notify();
+}
+
+template <typename T>
+uint64_t Reader<T>::appendSnapshot(ListFiller& list, PresenceMonitor::Clock::time_point now)
+{
+  // Callbacks updating several times between two publications only cost one rebuild.
+  // The publisher never waits for a writer: if one holds writeMutex_, the previous snapshot
+  // is published again and the new one is rebuilt at the next publication.
+  bool fresh = false;
+  if(stale_)
+  {
+    std::unique_lock<std::mutex> lock(writeMutex_, std::try_to_lock);
+    if(lock.owns_lock())
+    {
+      stale_ = false;
+      snapshotFiller_.begin(snapshot_);
+      orientations_.begin();
+      fillSnapshot(snapshotFiller_);
+      fresh = true;
+    }
+    else
+      UpdateSignal::notify();
+  }
+  if(!activated_)
+    return 0;
+
+  // Entities not updated for the timeout expire, unless this snapshot updates them
+  presence_.expire(now, expired_);
+
+  uint64_t newest = 0;
+  const toasterList_t& snapshot = snapshot_;
+  for (std::vector<toaster_msgs::Human>::const_iterator it = snapshot.human_msg.humanList.begin();
+       it != snapshot.human_msg.humanList.end(); ++it)
+  {
+    if (presence_.touch(it->meAgent.meEntity.id, it->meAgent.meEntity.time, now))
+    {
+      list.nextHuman() = *it;
+      newest = std::max(newest, (uint64_t)it->meAgent.meEntity.time);
+    }
+  }
+
+  for (std::vector<toaster_msgs::Robot>::const_iterator it = snapshot.robot_msg.robotList.begin();
+       it != snapshot.robot_msg.robotList.end(); ++it)
+  {
+    if (presence_.touch(it->meAgent.meEntity.id, it->meAgent.meEntity.time, now))
+    {
+      list.nextRobot() = *it;
+      newest = std::max(newest, (uint64_t)it->meAgent.meEntity.time);
+    }
+  }
+
+  for (std::vector<toaster_msgs::Object>::const_iterator it = snapshot.object_msg.objectList.begin();
+       it != snapshot.object_msg.objectList.end(); ++it)
+  {
+    if (presence_.touch(it->meEntity.id, it->meEntity.time, now))
+    {
+      list.nextObject() = *it;
+      newest = std::max(newest, (uint64_t)it->meEntity.time);
+    }
+  }
+
+  for (std::vector<toaster_msgs::Fact>::const_iterator it = snapshot.fact_msg.factList.begin();
+       it != snapshot.fact_msg.factList.end(); ++it)
+    if (it->property != "isPresent" || presence_.isPresent(it->subjectId))
+      list.nextFact() = *it;
+
+  // Disappearance of the entities expired and not updated again
+  for (std::vector<std::string>::const_iterator it = expired_.begin(); it != expired_.end(); ++it)
+    if (!presence_.isPresent(*it))
+      fillPresenceFact(list.nextFact(), *it, presence_.getTime(*it), false);
+  expired_.clear();
+
+  // Entities removed from the snapshot are forgotten
+  presence_.prune();
+
+  return fresh ? newest : 0;
 }
 
 
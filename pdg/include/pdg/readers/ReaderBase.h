@@ -0,0 +1,49 @@
+/*
+ * File:   ReaderBase.h
+ *
+ * Interface of the readers loaded by pdg as plugins (base class "ReaderBase" of the pdg package).
+ * A reader is created for each configured stream and destroyed when the stream is removed,
+ * the publication loop only goes through the readers created.
+ */
+
+#ifndef READERBASE_H
+#define READERBASE_H
+
+#include <ros/ros.h>
+#include <string>
+
+#include "toaster-lib/Entity.h"
+#include "pdg/utility/ListFiller.h"
+#include "pdg/utility/PresenceMonitor.h"
+
+class TfSampler;
+
+class ReaderBase
+{
+public:
+  enum Kind_t { HUMAN, ROBOT, OBJECT };
+
+  virtual ~ReaderBase() {}
+
+  // Subscribes to the inputs of stream name, whose parameters are /pdg/<name>...
+  virtual void initialize(ros::NodeHandle* node, const std::string& name) = 0;
+
+  virtual Kind_t getKind() const = 0;
+
+  virtual void setActivation(bool activated) = 0;
+
+  // Called by the loop before each publication, for the readers resolving tf frames
+  virtual void update(TfSampler& sampler) {}
+
+  // Applies a pose requested by pdg/set_entity_pose if the reader has the entity
+  virtual void updateEntityPose(Entity& newPoseEnt) = 0;
+
+  // Appends the present humans or robots of the reader, see Reader::appendSnapshot.
+  // Objects of all the object readers are appended together by ObjectReader::Publish.
+  virtual uint64_t appendSnapshot(ListFiller& list, PresenceMonitor::Clock::time_point now) { return 0; }
+
+  // Standard deviation of the positions of the stream, in m
+  virtual double getSigma() const { return 0.1; }
+};
+
+#endif /* READERBASE_H */
@@ -0,0 +1,61 @@
+/*
+ * File:   ReaderRegistry.h
+ *
+ * Readers of the streams used by pdg, loaded as plugins.
+ * Only the configured streams have a reader: the others are neither constructed nor
+ * subscribed, and the publication loop only goes through the readers created.
+ * pdg/manage_stream creates and destroys them while pdg runs.
+ */
+
+#ifndef READERREGISTRY_H
+#define READERREGISTRY_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <pluginlib/class_loader.h>
+#include <boost/shared_ptr.hpp>
+
+#include "pdg/readers/ReaderBase.h"
+
+class ReaderRegistry
+{
+public:
+  struct Stream_t
+  {
+    std::string name;
+    boost::shared_ptr<ros::NodeHandle> node; // subscriptions of the reader
+    boost::shared_ptr<ReaderBase> reader;
+  };
+
+  ReaderRegistry(ros::NodeHandle& node);
+  ~ReaderRegistry();
+
+  // Creates the readers of the streams listed in /pdg/readers,
+  // or of the streams whose parameter /pdg/<stream> is true if there is no list
+  void load();
+
+  /**
+   * @brief Creates the reader of stream name if activated, destroys it otherwise
+   * @return false if the reader cannot be created
+   */
+  bool setStream(const std::string& name, bool activated);
+
+  // Held by the loop while it uses the readers, and by setStream
+  std::mutex mutex_;
+  const std::vector<Stream_t>& getStreams() const { return streams_; }
+
+private:
+  // Plugin type of stream name: /pdg/readerTypes/<name>, or the type of the pdg stream of this name
+  std::string getType(const std::string& name) const;
+
+  void destroy(std::vector<Stream_t>::iterator stream);
+
+  ros::NodeHandle& node_;
+  pluginlib::ClassLoader<ReaderBase> loader_;
+  std::vector<Stream_t> streams_;
+};
+
+#endif /* READERREGISTRY_H */
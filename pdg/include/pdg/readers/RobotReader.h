@@ -26,7 +26,9 @@ class RobotReader : public Reader<Robot>{
         RobotReader();
         virtual ~RobotReader();
 
-        virtual void Publish(struct toasterList_t& list_msg);
+        virtual void fillSnapshot(ListFiller& list);
+
+        Kind_t getKind() const { return ROBOT; }
 
         void setFullConfig(bool fullConfig) {fullRobot_ = fullConfig; }
         void setFullConfig(std::string param)
@@ -38,9 +40,7 @@ class RobotReader : public Reader<Robot>{
     protected:
         bool fullRobot_;
 
-        bool isPresent(std::string id);
-
-        toaster_msgs::Fact DefaultFactMsg(std::string subjectId, uint64_t factTime);
+        void DefaultFactMsg(toaster_msgs::Fact& fact_msg, const std::string& subjectId, uint64_t factTime);
 };
 
 #endif /* ROBOTREADER_H */
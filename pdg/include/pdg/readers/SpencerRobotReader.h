@@ -10,7 +10,7 @@
 
 #include "RobotReader.h"
 
-#include <tf/transform_listener.h>
+#include "pdg/utility/TfSampler.h"
 
 class SpencerRobotReader : public RobotReader {
 public:
@@ -18,13 +18,16 @@ public:
     ~SpencerRobotReader() {};
 
     void init(ros::NodeHandle* node, std::string param);
+    void initialize(ros::NodeHandle* node, const std::string& name);
+    void update(TfSampler &sampler) { updateRobot(sampler); }
 
-    void updateRobot(tf::TransformListener &listener);
+    void updateRobot(TfSampler &sampler);
 private:
     ros::Subscriber sub_;
     std::vector<std::string> spencerJointsName_;
     void initJointsName();
-    void setRobotJointLocation(tf::TransformListener &listener, Joint* joint);
+    // Sets the pose of entity from the frame of joint, returns false if there is no new pose
+    bool setRobotJointLocation(TfSampler &sampler, const std::string& jointName, Entity* entity);
 
 };
 
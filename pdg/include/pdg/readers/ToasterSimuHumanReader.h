@@ -15,12 +15,13 @@
 
 class ToasterSimuHumanReader : public HumanReader {
 public:
-    ToasterSimuHumanReader(bool fullHuman);
+    ToasterSimuHumanReader(bool fullHuman = false);
     virtual ~ToasterSimuHumanReader() {};
 
     void init(ros::NodeHandle* node, std::string param);
+    void initialize(ros::NodeHandle* node, const std::string& name);
 
-    virtual void Publish(struct toasterList_t& list_msg);
+    virtual void fillSnapshot(ListFiller& list);
 
 private:
     void humanJointStateCallBack(const toaster_msgs::HumanListStamped::ConstPtr& msg);
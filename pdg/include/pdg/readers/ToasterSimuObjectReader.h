@@ -19,6 +19,7 @@ public:
     ~ToasterSimuObjectReader() {};
 
     void init(ros::NodeHandle* node, std::string param);
+    void initialize(ros::NodeHandle* node, const std::string& name);
 
 private:
     //Functions
@@ -15,10 +15,11 @@
 
 class ToasterSimuRobotReader : public RobotReader {
 public:
-    ToasterSimuRobotReader(bool fullRobot);
+    ToasterSimuRobotReader(bool fullRobot = true);
     ~ToasterSimuRobotReader() {};
 
     void init(ros::NodeHandle* node, std::string param);
+    void initialize(ros::NodeHandle* node, const std::string& name);
 private:
     void robotJointStateCallBack(const toaster_msgs::RobotListStamped::ConstPtr& msg);
     ros::Subscriber sub_;
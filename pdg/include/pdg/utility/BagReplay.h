@@ -0,0 +1,59 @@
+/*
+ * File:   BagReplay.h
+ *
+ * Replays the input streams recorded in a bag into the readers, in virtual time.
+ * Messages are published in the process, in their recording order, with ros::Time
+ * set to their recording time, and the callbacks they trigger are called before the
+ * next one is published: the readers see the same sequence on every run, as fast
+ * as the pipeline goes.
+ */
+
+#ifndef BAGREPLAY_H
+#define BAGREPLAY_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include <boost/scoped_ptr.hpp>
+
+class BagReplay
+{
+public:
+  BagReplay() : node_(nullptr), nbMessages_(0) {}
+
+  /**
+   * @brief Opens the bag, its messages are published on node
+   * @param topics topics to replay, all the inputs of the bag if empty: the topics published by pdg,
+   *               /clock and /rosout are skipped
+   * @return false if the bag cannot be read
+   */
+  bool open(ros::NodeHandle& node, const std::string& path, const std::vector<std::string>& topics);
+
+  // Publishes the messages recorded until time, each one at its recording time, and calls the callbacks of queue after each one
+  void replayUntil(const ros::Time& time, ros::CallbackQueue* queue);
+
+  // True once all the messages were replayed
+  bool done() const { return !view_ || next_ == view_->end(); }
+
+  ros::Time getBeginTime() const { return view_ ? view_->getBeginTime() : ros::Time(); }
+  ros::Time getEndTime() const { return view_ ? view_->getEndTime() : ros::Time(); }
+  unsigned long getNbMessages() const { return nbMessages_; }
+
+private:
+  ros::NodeHandle* node_;
+  rosbag::Bag bag_;
+  boost::scoped_ptr<rosbag::View> view_;
+  rosbag::View::iterator next_;
+
+  // Advertised at the first message of each topic
+  std::map<std::string, ros::Publisher> publishers_;
+  unsigned long nbMessages_;
+};
+
+#endif /* BAGREPLAY_H */
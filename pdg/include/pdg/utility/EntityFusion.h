@@ -0,0 +1,92 @@
+/*
+ * File:   EntityFusion.h
+ *
+ * Fuses the entities seen by several streams into one.
+ * Each stream appends its entities to the list as a segment, with the standard deviation
+ * of its positions. Entities of different streams with the same id, or closer than the gate
+ * distance to the freshest one, are the same entity. Entities older than the window before the
+ * freshest are not averaged anymore: the one of the most precise stream among the others is kept,
+ * at the average of their positions weighted by the inverse of their variances. Its isPresent
+ * fact gets the confidence of the fused position, which grows with the number of streams seeing it.
+ */
+
+#ifndef ENTITYFUSION_H
+#define ENTITYFUSION_H
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <toaster_msgs/Fact.h>
+#include <toaster_msgs/Human.h>
+#include <toaster_msgs/Robot.h>
+
+class EntityFusion
+{
+public:
+  struct Position_t
+  {
+    double x, y, z;
+    double sigma; // standard deviation, in m
+  };
+
+  EntityFusion() : gate_(0.0), window_(0) {}
+
+  // Entities of different ids closer than gate m are associated, only the same ids if gate <= 0
+  void setGate(double gate) { gate_ = gate; }
+
+  // Entities at most window s older than the freshest one are averaged, all if window <= 0
+  void setWindow(double window) { window_ = window > 0.0 ? window * 1e9 : 0; }
+
+  // Starts the segments of a new list
+  void begin() { sources_.clear(); }
+
+  // Entities [first, end) of the list come from a stream of standard deviation sigma, in m
+  void addSource(unsigned int first, unsigned int end, double sigma);
+
+  // Removes the entities fused in another one and sets the confidence of the isPresent facts.
+  // Entities out of the segments are kept as they are.
+  void fuse(std::vector<toaster_msgs::Human>& list, std::vector<toaster_msgs::Fact>& facts);
+  void fuse(std::vector<toaster_msgs::Robot>& list, std::vector<toaster_msgs::Fact>& facts);
+
+  // Average of the positions closer than gate to the most precise one (all if gate <= 0),
+  // weighted by the inverse of their variances. Returns the index of the most precise one.
+  static unsigned int combine(const std::vector<Position_t>& positions, double gate, Position_t& fused);
+
+  // Average of the positions closer than gate to positions[anchor] (all if gate <= 0),
+  // weighted by the inverse of their variances
+  static void combine(const std::vector<Position_t>& positions, unsigned int anchor, double gate, Position_t& fused);
+
+  // Confidence of a position of standard deviation sigma in m, about 0.9 at 0.1 m
+  static double confidence(double sigma);
+
+private:
+  struct Source_t
+  {
+    unsigned int first, end;
+    double sigma;
+  };
+
+  template <typename M>
+  void fuseList(std::vector<M>& list, std::vector<toaster_msgs::Fact>& facts);
+
+  // Keeps one isPresent fact for each kept id, with its confidence, and none for the fused ids
+  void fuseFacts(std::vector<toaster_msgs::Fact>& facts);
+
+  double gate_;
+  uint64_t window_; // ns
+  std::vector<Source_t> sources_;
+
+  // Reused by each fusion
+  std::vector<int> source_;          // of each entity, -1 if out of the segments
+  std::vector<unsigned int> order_;  // entities of the segments, the freshest first
+  std::vector<unsigned int> members_; // of the cluster being fused, its freshest entity first
+  std::vector<int> cluster_;         // of each entity, -1 if not fused
+  std::vector<unsigned int> anchors_; // entity kept for each cluster
+  std::vector<Position_t> positions_;
+  std::map<std::string, double> keptIds_; // confidence of the fused entities
+  std::map<std::string, bool> factIds_;    // true once the isPresent fact of a kept id was seen
+};
+
+#endif /* ENTITYFUSION_H */
@@ -20,6 +20,39 @@ void fillValue(MovableObject* srcObject, toaster_msgs::Object& msgObject);
 
 void fillEntity(Entity* srcEntity, toaster_msgs::Entity& msgEntity);
 
+// Fills entity messages, converting to quaternion only the orientations that changed.
+// Orientations are cached by slot: the nth entity filled since begin() uses the nth slot,
+// so that entities filled in the same order each time hit the cache.
+class OrientationCache
+{
+public:
+  OrientationCache() : next_(0) {}
+
+  void begin() { next_ = 0; }
+
+  // Same as ::fillEntity, and clears inArea
+  void fillEntity(Entity* srcEntity, toaster_msgs::Entity& msgEntity);
+
+private:
+  struct Slot_t
+  {
+    double roll, pitch, yaw;
+    geometry_msgs::Quaternion quaternion;
+  };
+
+  std::vector<Slot_t> slots_;
+  unsigned int next_;
+};
+
+// Messages reused from another entity: reset the fields that are not always set
+void resetFact(toaster_msgs::Fact& msgFact);
+void resetObject(toaster_msgs::Object& msgObject);
+// Resizes the skeleton to nbJoints, the joints kept have to be set
+void resetAgent(toaster_msgs::Agent& msgAgent, unsigned int nbJoints);
+
+// isPresent fact of entity id, last updated at time
+void fillPresenceFact(toaster_msgs::Fact& msgFact, const std::string& id, uint64_t time, bool present);
+
 void updateEntity(Entity& newPoseEnt, Entity* storedEntity);
 
 bool updateToasterSimu(Entity* storedEntity, string type);
@@ -0,0 +1,43 @@
+/*
+ * File:   LatencyHistogram.h
+ *
+ * Latencies of an input stream, from the perception time of its data to
+ * their publication, sorted in bins to tune the publication parameters.
+ */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <string>
+
+#include <diagnostic_msgs/DiagnosticStatus.h>
+
+class LatencyHistogram
+{
+public:
+  LatencyHistogram();
+
+  // latency in s
+  void add(double latency);
+
+  // Bins as key values: count of latencies under each limit, and above the last one
+  void fillStatus(const std::string& name, diagnostic_msgs::DiagnosticStatus& status) const;
+
+  void reset();
+
+  unsigned long size() const { return nb_; }
+
+private:
+  static const unsigned int NB_BINS = 10;
+  static const double BIN_LIMITS[NB_BINS - 1]; // upper limits in ms
+
+  // Upper limit of the bin holding the given ratio of the latencies, in ms
+  double getPercentile(double ratio) const;
+
+  unsigned long counts_[NB_BINS];
+  unsigned long nb_;
+  double sum_;
+  double max_;
+};
+
+#endif /* LATENCYHISTOGRAM_H */
@@ -0,0 +1,70 @@
+/*
+ * File:   ListFiller.h
+ *
+ * Refills the lists of a toasterList_t without allocating once they reached their size.
+ * begin() moves the messages of the lists to spare pools, next*() takes them back
+ * to be overwritten: their strings and arrays keep their memory. A message taken
+ * back may come from another entity, so every field of it has to be set.
+ */
+
+#ifndef LISTFILLER_H
+#define LISTFILLER_H
+
+#include <vector>
+
+#include "pdg/types.h"
+
+class ListFiller
+{
+public:
+  ListFiller() : list_(nullptr) {}
+  ListFiller(const ListFiller&) = delete;
+
+  // Starts refilling list, which is empty until messages are added
+  void begin(toasterList_t& list)
+  {
+    list_ = &list;
+    recycle(list.object_msg.objectList, spareObjects_);
+    recycle(list.human_msg.humanList, spareHumans_);
+    recycle(list.robot_msg.robotList, spareRobots_);
+    recycle(list.fact_msg.factList, spareFacts_);
+  }
+
+  toasterList_t& list() { return *list_; }
+
+  // Appends a message to the list being filled, with the content of a previous message
+  toaster_msgs::Object& nextObject() { return next(list_->object_msg.objectList, spareObjects_); }
+  toaster_msgs::Human& nextHuman() { return next(list_->human_msg.humanList, spareHumans_); }
+  toaster_msgs::Robot& nextRobot() { return next(list_->robot_msg.robotList, spareRobots_); }
+  toaster_msgs::Fact& nextFact() { return next(list_->fact_msg.factList, spareFacts_); }
+
+private:
+  template <typename M>
+  static void recycle(std::vector<M>& list, std::vector<M>& spare)
+  {
+    for (typename std::vector<M>::iterator it = list.begin(); it != list.end(); ++it)
+      spare.push_back(std::move(*it));
+    list.clear();
+  }
+
+  template <typename M>
+  static M& next(std::vector<M>& list, std::vector<M>& spare)
+  {
+    if (spare.empty())
+      list.emplace_back();
+    else
+    {
+      list.push_back(std::move(spare.back()));
+      spare.pop_back();
+    }
+    return list.back();
+  }
+
+  toasterList_t* list_;
+  std::vector<toaster_msgs::Object> spareObjects_;
+  std::vector<toaster_msgs::Human> spareHumans_;
+  std::vector<toaster_msgs::Robot> spareRobots_;
+  std::vector<toaster_msgs::Fact> spareFacts_;
+};
+
+#endif /* LISTFILLER_H */
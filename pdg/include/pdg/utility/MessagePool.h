@@ -0,0 +1,36 @@
+/*
+ * File:   MessagePool.h
+ *
+ * Messages published by shared pointer. Subscribers of the same process receive
+ * the pointer itself, so a message is not modified again while they hold it:
+ * get() only returns a message no one else references, and allocates a new one
+ * if there is none. The content of a message returned is the one of a previous
+ * publication, swapping lists with it gives their memory back to the caller.
+ */
+
+#ifndef MESSAGEPOOL_H
+#define MESSAGEPOOL_H
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+template <typename M>
+class MessagePool
+{
+public:
+  boost::shared_ptr<M> get()
+  {
+    for (typename std::vector<boost::shared_ptr<M> >::iterator it = pool_.begin(); it != pool_.end(); ++it)
+      if (it->unique())
+        return *it;
+
+    pool_.push_back(boost::make_shared<M>());
+    return pool_.back();
+  }
+
+private:
+  std::vector<boost::shared_ptr<M> > pool_;
+};
+
+#endif /* MESSAGEPOOL_H */
@@ -0,0 +1,66 @@
+/*
+ * File:   PresenceMonitor.h
+ *
+ * Presence of the entities of a stream, given by the arrival of their updates.
+ * An entity is present while it was updated less than the timeout ago on the steady
+ * clock, so that jumps of the wall clock or late perception times do not change it.
+ * Deadlines are kept in a queue ordered by time: a tick only looks at the entities
+ * expiring, not at all of them. An update pushes a new deadline, the previous one
+ * is skipped when it comes out of the queue.
+ * Entities not touched anymore are forgotten by prune() once they are absent.
+ */
+
+#ifndef PRESENCEMONITOR_H
+#define PRESENCEMONITOR_H
+
+#include <chrono>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class PresenceMonitor
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  PresenceMonitor() : timeout_(Clock::duration::zero()) {}
+
+  // Entities expire timeout s after their last update, never if timeout <= 0.
+  // Applies from the next updates.
+  void setTimeout(double timeout);
+
+  // Entity id seen with perception time at now, it is updated if time changed.
+  // Returns true if id is present.
+  bool touch(const std::string& id, uint64_t time, Clock::time_point now);
+
+  // Marks absent the entities not updated for the timeout at now, and adds their ids to expired
+  void expire(Clock::time_point now, std::vector<std::string>& expired);
+
+  // Forgets the entities not touched since the previous call which are absent,
+  // or which never expire. To call once their disappearance was reported.
+  void prune();
+
+  bool isPresent(const std::string& id) const;
+
+  // Perception time of the last update of id, 0 if it was never seen
+  uint64_t getTime(const std::string& id) const;
+
+private:
+  struct Presence_t
+  {
+    uint64_t time;
+    Clock::time_point deadline;
+    bool present;
+    bool touched; // since the last prune
+  };
+
+  typedef std::pair<Clock::time_point, std::string> Deadline_t;
+
+  std::map<std::string, Presence_t> entities_;
+  std::priority_queue<Deadline_t, std::vector<Deadline_t>, std::greater<Deadline_t> > deadlines_;
+  Clock::duration timeout_;
+};
+
+#endif /* PRESENCEMONITOR_H */
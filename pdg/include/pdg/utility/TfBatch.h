@@ -0,0 +1,67 @@
+/*
+ * File:   TfBatch.h
+ *
+ * Gathers the tf frames of the entities published in a loop and broadcasts them
+ * in one message. Frame ids are built once per entity and joint, transforms keep
+ * their memory from one loop to the next.
+ * Frames are /id for objects, id/base for agents and /agentId/jointId for joints.
+ * Frame ids of entities not added for a while are dropped.
+ */
+
+#ifndef TFBATCH_H
+#define TFBATCH_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <tf/transform_broadcaster.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <toaster_msgs/Entity.h>
+#include <toaster_msgs/Agent.h>
+
+class TfBatch
+{
+public:
+  TfBatch() : size_(0), batch_(0) {}
+
+  // Starts a new batch of transforms at stamp
+  void begin(const ros::Time& stamp);
+
+  void addEntity(const toaster_msgs::Entity& entity);
+  void addAgent(const toaster_msgs::Agent& agent, bool withJoints);
+
+  // Broadcasts the transforms added since begin(), in a single message
+  void send(tf::TransformBroadcaster& tf_br);
+
+private:
+  struct Frame_t
+  {
+    std::string id;
+    unsigned int batch; // last batch using it
+  };
+
+  typedef std::map<std::string, Frame_t> Frames_t;
+
+  void add(const std::string& frame, const geometry_msgs::Pose& pose);
+
+  // Frame of key in frames, built with prefix + key + suffix the first time
+  const std::string& getFrame(Frames_t& frames, const std::string& key, const std::string& prefix, const std::string& suffix);
+
+  // Drops the frames not used for TFBATCH_FRAME_LIFETIME batches
+  void prune(Frames_t& frames);
+
+  std::vector<geometry_msgs::TransformStamped> transforms_;
+  // Transforms of a larger batch, moved out of transforms_ before sending
+  std::vector<geometry_msgs::TransformStamped> spare_;
+  unsigned int size_; // transforms added to this batch
+  ros::Time stamp_;
+  unsigned int batch_;
+
+  Frames_t entityFrames_;
+  Frames_t agentFrames_;
+  std::map<std::string, Frames_t> jointFrames_; // by agent
+};
+
+#endif /* TFBATCH_H */
@@ -0,0 +1,69 @@
+/*
+ * File:   TfSampler.h
+ *
+ * Resolves the tf frames needed by the readers in a thread of its own,
+ * so that a missing frame never blocks the publication loop.
+ */
+
+#ifndef TFSAMPLER_H
+#define TFSAMPLER_H
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <ros/ros.h>
+#include <tf/transform_listener.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+// Last transform of a frame in the map
+struct TfSample_t
+{
+  tf::StampedTransform transform;
+  uint64_t time;  // perception time in ns, stamp of the transform or time it was sampled
+  bool stale;     // last lookup failed or the transform is too old, transform is the last good one
+};
+
+class TfSampler
+{
+public:
+  /**
+   * @param rate sampling rate in Hz
+   * @param staleTimeout a transform older than this is stale, in s
+   * @param spinThread if false, tf messages are received in the callback queue of node
+   */
+  TfSampler(ros::NodeHandle& node, double rate = 30.0, double staleTimeout = 1.0, bool spinThread = true,
+            const std::string& fixedFrame = "/map");
+  ~TfSampler();
+
+  void start();
+  void stop();
+
+  // Resolves the frames once, instead of the sampling thread (replay)
+  void sample();
+
+  // Frames are resolved from the next sampling on
+  void addFrame(const std::string& frame);
+
+  // false if the frame was never resolved
+  bool getSample(const std::string& frame, TfSample_t& sample) const;
+
+private:
+  void run();
+
+  tf::TransformListener listener_;
+  std::string fixedFrame_;
+  ros::Duration period_;
+  ros::Duration staleTimeout_;
+
+  mutable boost::mutex mutex_;
+  std::set<std::string> frames_;
+  std::map<std::string, TfSample_t> samples_;
+
+  boost::thread thread_;
+  bool running_;
+};
+
+#endif /* TFSAMPLER_H */
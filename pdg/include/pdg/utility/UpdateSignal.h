@@ -0,0 +1,32 @@
+/*
+ * File:   UpdateSignal.h
+ *
+ * Wakes the publication loop when a reader committed new data.
+ */
+
+#ifndef UPDATESIGNAL_H
+#define UPDATESIGNAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+class UpdateSignal
+{
+public:
+  // Called by the readers once they committed an update
+  static void notify();
+
+  // Waits until an update is notified or until deadline, returns true if there is an update
+  static bool waitUntil(const std::chrono::steady_clock::time_point& deadline);
+
+  // Forgets the updates notified so far, the data they committed is about to be published
+  static void clear();
+
+private:
+  static std::mutex mutex_;
+  static std::condition_variable condition_;
+  static bool pending_;
+};
+
+#endif /* UPDATESIGNAL_H */
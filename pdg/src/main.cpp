@@ -5,57 +5,46 @@
 #include <toaster_msgs/SetEntityPose.h>
 #include "tf/transform_datatypes.h"
 #include "std_msgs/String.h"
+#include <diagnostic_msgs/DiagnosticArray.h>
 
 //tf
 #include <tf/transform_broadcaster.h>
 
 //Utility
 #include "pdg/utility/EntityUtility.h"
-
-#include "pdg/readers/MorseHumanReader.h"
-#include "pdg/readers/MocapHumanReader.h"
-#include "pdg/readers/AdreamMocapHumanReader.h"
-#include "pdg/readers/GroupHumanReader.h"
-#include "pdg/readers/ToasterSimuHumanReader.h"
-
-#include "pdg/readers/Pr2RobotReader.h"
-#include "pdg/readers/SpencerRobotReader.h"
-#include "pdg/readers/ToasterSimuRobotReader.h"
-
-#include "pdg/readers/ArObjectReader.h"
-#include "pdg/readers/GazeboObjectReader.h"
-#include "pdg/readers/ToasterSimuObjectReader.h"
-#include "pdg/readers/OM2MObjectReader.h"
-#include "pdg/readers/MocapObjectsReader.h"
+#include "pdg/utility/TfSampler.h"
+#include "pdg/utility/UpdateSignal.h"
+#include "pdg/utility/LatencyHistogram.h"
+#include "pdg/utility/ListFiller.h"
+#include "pdg/utility/MessagePool.h"
+#include "pdg/utility/TfBatch.h"
+#include "pdg/utility/PresenceMonitor.h"
+#include "pdg/utility/EntityFusion.h"
+#include "pdg/utility/BagReplay.h"
+
+#include "pdg/readers/ReaderRegistry.h"
+#include "pdg/readers/ObjectReader.h"
 
 #include "pdg/types.h"
+#include "pdg/PdgNode.h"
 
+#include <ros/callback_queue.h>
 #include <queue>
+#include <mutex>
+#include <thread>
+#include <chrono>
 
-struct fullConfig_t fullConfig;
-
-// Stream to activate
-MorseHumanReader morseHumanRd(fullConfig.Human_);
-//NiutHumanReader niutHumanRd;
-GroupHumanReader groupHumanRd(false);
-MocapHumanReader mocapHumanRd(false);
-AdreamMocapHumanReader adreamMocapHumanRd(false);
-ToasterSimuHumanReader toasterSimuHumanRd(false);
+namespace pdg {
 
-Pr2RobotReader pr2RobotRd(fullConfig.Robot_);
-SpencerRobotReader spencerRobotRd;
-ToasterSimuRobotReader toasterSimuRobotRd(fullConfig.Robot_);
-
-ToasterSimuObjectReader toasterSimuObjectRd;
-ArObjectReader arObjectRd;
-OM2MObjectReader om2mObjectRd;
-GazeboObjectReader gazeboRd;
-MocapObjectsReader mocapObjectsRd;
+// Readers of the configured streams
+ReaderRegistry* readerRegistry_ = nullptr;
 
 struct objectIn_t objectIn;
+std::mutex objectInMutex_;
 
 //Used to change position of an entity
 std::queue<Entity> newPoseEnt_;
+std::mutex newPoseMutex_;
 
 //////////////
 // Services //
@@ -64,22 +53,23 @@ std::queue<Entity> newPoseEnt_;
 bool addStream(toaster_msgs::AddStream::Request &req,
         toaster_msgs::AddStream::Response & res) {
 
-    morseHumanRd.setActivation(req.morseHuman);
-    //niutHumanRd.setActivation(req.niutHuman);
-    groupHumanRd.setActivation(req.groupHuman);
-    mocapHumanRd.setActivation(req.mocapHuman);
-    adreamMocapHumanRd.setActivation(req.adreamMocapHuman);
-    toasterSimuHumanRd.setActivation(req.toasterSimuHuman);
+    // Readers are created for the streams set, and destroyed for the others
+    readerRegistry_->setStream("morseHuman", req.morseHuman);
+    //readerRegistry_->setStream("niutHuman", req.niutHuman);
+    readerRegistry_->setStream("groupHuman", req.groupHuman);
+    readerRegistry_->setStream("mocapHuman", req.mocapHuman);
+    readerRegistry_->setStream("adreamMocapHuman", req.adreamMocapHuman);
+    readerRegistry_->setStream("toasterSimuHuman", req.toasterSimuHuman);
 
-    pr2RobotRd.setActivation(req.pr2Robot);
-    spencerRobotRd.setActivation(req.spencerRobot);
-    toasterSimuRobotRd.setActivation(req.toasterSimuRobot);
+    readerRegistry_->setStream("pr2Robot", req.pr2Robot);
+    readerRegistry_->setStream("spencerRobot", req.spencerRobot);
+    readerRegistry_->setStream("toasterSimuRobot", req.toasterSimuRobot);
 
-    toasterSimuObjectRd.setActivation(req.toasterSimuObject);
-    arObjectRd.setActivation(req.arObject);
-    om2mObjectRd.setActivation(req.om2mObject);
-    gazeboRd.setActivation(req.gazeboObject);
-    mocapObjectsRd.setActivation(req.mocapObject);
+    readerRegistry_->setStream("toasterSimuObject", req.toasterSimuObject);
+    readerRegistry_->setStream("arObjectReader", req.arObject);
+    readerRegistry_->setStream("OM2MObjectReader", req.om2mObject);
+    readerRegistry_->setStream("gazeboObjectReader", req.gazeboObject);
+    readerRegistry_->setStream("mocapObjectReader", req.mocapObject);
 
     ROS_INFO("[pdg] setting pdg input");
 
@@ -104,6 +94,7 @@ bool putInHand(toaster_msgs::PutInHand::Request &req,
     }
 
     if (req.jointName != "") {
+        std::lock_guard<std::mutex> lock(objectInMutex_);
         objectIn.Agent_[req.objectId] = req.agentId;
         objectIn.Hand_[req.objectId] = req.jointName;
         return true;
@@ -123,6 +114,7 @@ bool removeFromHand(toaster_msgs::RemoveFromHand::Request &req,
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(objectInMutex_);
     objectIn.Agent_.erase(req.objectId);
     objectIn.Hand_.erase(req.objectId);
 
@@ -152,7 +144,9 @@ bool setEntityPose(toaster_msgs::SetEntityPose::Request &req,
         newPoseEnt.orientation_[1] = pitch;
         newPoseEnt.orientation_[2] = yaw;
 
+        newPoseMutex_.lock();
         newPoseEnt_.push(newPoseEnt);
+        newPoseMutex_.unlock();
         ROS_INFO("[toaster_simu][Request][INFO] request to set entity pose with "
                 "id %s successful", req.id.c_str());
         res.answer = true;
@@ -166,76 +160,77 @@ bool setEntityPose(toaster_msgs::SetEntityPose::Request &req,
     return true;
 }
 
-//////////////////
-// TF broadcast //
-//////////////////
-void broadcastTfEntity(tf::TransformBroadcaster &tf_br,toaster_msgs::Entity &entity,const std::string &prefix,ros::Time &stamp){
-    geometry_msgs::Pose &pose=entity.pose;
-    tf::Transform transform;
-    transform.setOrigin(tf::Vector3(pose.position.x,pose.position.y,pose.position.z));
-    transform.setRotation(tf::Quaternion(pose.orientation.x,pose.orientation.y,pose.orientation.z,pose.orientation.w));
-    tf_br.sendTransform(tf::StampedTransform(transform,stamp,"map",prefix+"/"+entity.id));
+////////////////////////
+// Unchanged entities //
+////////////////////////
+
+// Newest time of the base and joints of an agent
+uint64_t agentTime(const toaster_msgs::Agent& agent){
+    uint64_t time = agent.meEntity.time;
+    for(uint i_jnt=0;i_jnt<agent.skeletonJoint.size();++i_jnt)
+        time = std::max(time, (uint64_t)agent.skeletonJoint[i_jnt].meEntity.time);
+    return time;
 }
-void broadcastTfAgent(tf::TransformBroadcaster &tf_br,toaster_msgs::Agent &agent,const std::string &prefix,ros::Time &stamp){
-    geometry_msgs::Pose &pose=agent.meEntity.pose;
-    tf::Transform transform;
-    transform.setOrigin(tf::Vector3(pose.position.x,pose.position.y,pose.position.z));
-    transform.setRotation(tf::Quaternion(pose.orientation.x,pose.orientation.y,pose.orientation.z,pose.orientation.w));
-    tf_br.sendTransform(tf::StampedTransform(transform,stamp,"map",prefix+agent.meEntity.id+"/base"));
-
-    for(uint i_jnt=0;i_jnt<agent.skeletonJoint.size();++i_jnt){
-        broadcastTfEntity(tf_br,agent.skeletonJoint[i_jnt].meEntity,prefix+"/"+agent.meEntity.id,stamp);
+
+uint64_t entityTime(const toaster_msgs::Object& object){ return object.meEntity.time; }
+uint64_t entityTime(const toaster_msgs::Human& human){ return agentTime(human.meAgent); }
+uint64_t entityTime(const toaster_msgs::Robot& robot){ return agentTime(robot.meAgent); }
+
+const std::string& entityId(const toaster_msgs::Object& object){ return object.meEntity.id; }
+const std::string& entityId(const toaster_msgs::Human& human){ return human.meAgent.meEntity.id; }
+const std::string& entityId(const toaster_msgs::Robot& robot){ return robot.meAgent.meEntity.id; }
+
+// Removes the entities with the same time as in the last publication, unless keyframe is set
+template <typename T>
+void removeUnchanged(std::vector<T>& list, std::map<std::string, uint64_t>& publishedTimes, bool keyframe){
+    typename std::vector<T>::iterator itKept = list.begin();
+    for(typename std::vector<T>::iterator it = list.begin(); it != list.end(); ++it){
+        uint64_t time = entityTime(*it);
+        std::map<std::string, uint64_t>::iterator itTime = publishedTimes.find(entityId(*it));
+        if(itTime == publishedTimes.end())
+            publishedTimes[entityId(*it)] = time;
+        else if(itTime->second != time)
+            itTime->second = time;
+        else if(!keyframe)
+            continue;
+
+        if(itKept != it)
+            std::swap(*itKept, *it);
+        ++itKept;
     }
+    list.erase(itKept, list.end());
+}
+
+std::chrono::steady_clock::duration toDuration(double seconds){
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
 }
 
-int main(int argc, char** argv) {
+int run(ros::NodeHandle& node, ros::NodeHandle& privateNode) {
     unsigned int seq = 0;
-    ros::init(argc, argv, "pdg");
-    ros::NodeHandle node;
 
     tf::TransformBroadcaster tf_br;
 
-    //Data reading
-    vector<HumanReader*> humanReaders;
-    groupHumanRd.init(&node, "/spencer/perception/tracked_groups", "/pdg/groupHuman");
-    groupHumanRd.setFullConfig("/pdg/fullHumanConfig");
-    humanReaders.push_back(&groupHumanRd);
-    morseHumanRd.init(&node, "/pdg/morseHuman");
-    morseHumanRd.setFullConfig("/pdg/fullHumanConfig");
-    humanReaders.push_back(&morseHumanRd);
-    //niutHumanRd.init(&node, "/niut/Human", "/pdg/niutHuman")
-    mocapHumanRd.init(&node, "/optitrack_person/tracked_persons", "/pdg/mocapHuman");
-    mocapHumanRd.setFullConfig("/pdg/fullHumanConfig");
-    humanReaders.push_back(&mocapHumanRd);
-    adreamMocapHumanRd.init(&node, "/optitrack/bodies/Rigid_Body_3", "/optitrack/bodies/Rigid_Body_1", "/optitrack/bodies/Rigid_Body_2", "/pdg/adreamMocapHuman");
-    adreamMocapHumanRd.setFullConfig("/pdg/fullHumanConfig");
-    humanReaders.push_back(&adreamMocapHumanRd);
-    toasterSimuHumanRd.init(&node, "/pdg/toasterSimuHuman");
-    toasterSimuHumanRd.setFullConfig("/pdg/fullHumanConfig");
-    humanReaders.push_back(&toasterSimuHumanRd);
-
-    vector<RobotReader*> robotReaders;
-    pr2RobotRd.init(&node, "/pdg/pr2Robot");
-    pr2RobotRd.setFullConfig("/pdg/fullRobotConfig");
-    robotReaders.push_back(&pr2RobotRd);
-    spencerRobotRd.init(&node, "/pdg/spencerRobot");
-    spencerRobotRd.setFullConfig("/pdg/fullRobotConfig");
-    robotReaders.push_back(&spencerRobotRd);
-    toasterSimuRobotRd.init(&node, "/pdg/toasterSimuRobot");
-    toasterSimuRobotRd.setFullConfig("/pdg/fullRobotConfig");
-    robotReaders.push_back(&toasterSimuRobotRd);
-
-    vector<ObjectReader*> objectReaders;
-    arObjectRd.init(&node, "ar_visualization_marker", "/pdg/arObjectReader");
-    objectReaders.push_back(&arObjectRd);
-    om2mObjectRd.init(&node, "/iot2pdg_updates", "/pdg/OM2MObjectReader");
-    objectReaders.push_back(&om2mObjectRd);
-    gazeboRd.init(&node, "/gazebo/model_states", "/pdg/gazeboObjectReader");
-    objectReaders.push_back(&gazeboRd);
-    mocapObjectsRd.init(&node, "/pdg/mocapObjectsTopics", "/pdg/mocapObjectsIds", "/pdg/mocapObjectReader");
-    mocapObjectsRd.extract(objectReaders);
-    toasterSimuObjectRd.init(&node, "/pdg/toasterSimuObject");
-    objectReaders.push_back(&toasterSimuObjectRd);
+    //Data reading: readers of the configured streams only
+    ReaderRegistry registry(node);
+    registry.load();
+    readerRegistry_ = &registry;
+
+    // Objects are published from all the object readers, they expire only if they have a timeout
+    double objectsPresenceTimeout = 0.0;
+    node.getParam("/pdg/presenceTimeouts/objects", objectsPresenceTimeout);
+    ObjectReader::setPresenceTimeout(objectsPresenceTimeout);
+
+    // Entities seen by several streams are fused: by id, or by distance if fusionGate is set
+    double fusionGate = 0.0;
+    double fusionWindow = 0.5;
+    node.getParam("/pdg/fusionGate", fusionGate);
+    node.getParam("/pdg/fusionWindow", fusionWindow);
+    EntityFusion humanFusion, robotFusion;
+    humanFusion.setGate(fusionGate);
+    robotFusion.setGate(fusionGate);
+    humanFusion.setWindow(fusionWindow);
+    robotFusion.setWindow(fusionWindow);
+    ObjectReader::setFusion(fusionGate, fusionWindow);
 
     //Services
     ros::ServiceServer addStreamServ = node.advertiseService("pdg/manage_stream", addStream);
@@ -255,56 +250,198 @@ int main(int argc, char** argv) {
     ros::Publisher human_pub = node.advertise<toaster_msgs::HumanListStamped>("pdg/humanList", 1000);
     ros::Publisher robot_pub = node.advertise<toaster_msgs::RobotListStamped>("pdg/robotList", 1000);
     ros::Publisher fact_pub = node.advertise<toaster_msgs::FactList>("pdg/factList", 1000);
+    ros::Publisher latency_pub = node.advertise<diagnostic_msgs::DiagnosticArray>("pdg/latency", 10);
 
     ros::ServiceClient setPoseClient = node.serviceClient<toaster_msgs::SetEntityPose>("/toaster_simu/set_entity_pose"); // , true
     EntityUtility_setClient(&setPoseClient);
 
-    ros::Rate loop_rate(30);
+    // Publication: at publishRate, or when readers commit updates if eventDriven is set.
+    // In event mode, updates are published after maxPublishDelay to coalesce bursts, at most at
+    // maxPublishRate, and at least at publishRate for the tf readers and the presence of entities.
+    bool eventDriven = false;
+    double publishRate = 30.0;
+    double maxPublishDelay = 0.002;
+    double maxPublishRate = 250.0;
+    node.getParam("/pdg/eventDriven", eventDriven);
+    node.getParam("/pdg/publishRate", publishRate);
+    node.getParam("/pdg/maxPublishDelay", maxPublishDelay);
+    node.getParam("/pdg/maxPublishRate", maxPublishRate);
+    if(publishRate <= 0.0)
+      publishRate = 30.0;
+    if(maxPublishRate < publishRate)
+      maxPublishRate = publishRate;
+
+    // Entities not updated since the last publication are only published every keyframePeriod
+    bool skipUnchanged = false;
+    double keyframePeriod = 1.0;
+    node.getParam("/pdg/skipUnchanged", skipUnchanged);
+    node.getParam("/pdg/keyframePeriod", keyframePeriod);
+    std::map<std::string, uint64_t> publishedObjectTimes, publishedHumanTimes, publishedRobotTimes;
+    ros::Time lastKeyframe;
+
+    // Latency from the perception time of the data of each stream to their publication
+    double latencyReportPeriod = 1.0;
+    node.getParam("/pdg/latencyReportPeriod", latencyReportPeriod);
+    std::map<std::string, LatencyHistogram> latencies;
+    ros::Time lastLatencyReport = ros::Time::now();
+
+    // Lists are refilled in place and published by pointer from pools, entities already
+    // published keep their messages' memory from one loop to the next
+    toasterList_t list_msg;
+    ListFiller listFiller;
+    MessagePool<toaster_msgs::ObjectListStamped> objectPool;
+    MessagePool<toaster_msgs::HumanListStamped> humanPool;
+    MessagePool<toaster_msgs::RobotListStamped> robotPool;
+    MessagePool<toaster_msgs::FactList> factPool;
+
+    // Frames of the published entities are broadcast in one tf message per loop
+    TfBatch tfBatch;
+    bool tfObjects = true;
+    bool tfHumans = true;
+    bool tfRobots = true;
+    bool tfJoints = true;
+    node.getParam("/pdg/tfBroadcastObjects", tfObjects);
+    node.getParam("/pdg/tfBroadcastHumans", tfHumans);
+    node.getParam("/pdg/tfBroadcastRobots", tfRobots);
+    node.getParam("/pdg/tfBroadcastJoints", tfJoints);
+
+    ros::Rate loop_rate(publishRate);
+    std::chrono::steady_clock::time_point lastPublication = std::chrono::steady_clock::now();
+
+    // Replay: the inputs recorded in replayBag are read in virtual time, a publication every
+    // 1 / publishRate s of recording. Everything runs in the loop, so that each run gives the same lists.
+    // replayRate limits the speed to this factor of real time, as fast as possible if 0.
+    std::string replayBag;
+    std::vector<std::string> replayTopics;
+    double replayRate = 0.0;
+    node.getParam("/pdg/replayBag", replayBag);
+    node.getParam("/pdg/replayTopics", replayTopics);
+    node.getParam("/pdg/replayRate", replayRate);
+    bool replay = !replayBag.empty();
+    BagReplay bagReplay;
+    ros::Time replayTime;
+    std::chrono::steady_clock::time_point replayStart = std::chrono::steady_clock::now();
+    if(replay)
+    {
+      if(!bagReplay.open(node, replayBag, replayTopics))
+        return 1;
+      replayTime = bagReplay.getBeginTime();
+      ros::Time::setNow(replayTime);
+      lastLatencyReport = replayTime;
+    }
 
-    tf::TransformListener listener;
+    // tf frames are resolved off the loop, a missing frame does not delay publication
+    double tfSamplingRate = 30.0;
+    double tfStaleTimeout = 1.0;
+    node.getParam("/pdg/tfSamplingRate", tfSamplingRate);
+    node.getParam("/pdg/tfStaleTimeout", tfStaleTimeout);
+    TfSampler tfSampler(node, tfSamplingRate > 0.0 ? tfSamplingRate : 30.0, tfStaleTimeout, !replay);
+    if(!replay)
+      tfSampler.start();
+
+    // Reader callbacks run in the spinner threads and mark the snapshots the loop rebuilds and publishes,
+    // 0 thread means one per core
+    int spinnerThreads = 0;
+    node.getParam("/pdg/spinnerThreads", spinnerThreads);
+    ros::AsyncSpinner spinner(spinnerThreads > 0 ? spinnerThreads : 0, static_cast<ros::CallbackQueue*>(node.getCallbackQueue()));
+    if(!replay)
+      spinner.start();
     ROS_INFO("[PDG] initializing\n");
 
 
     while (node.ok()) {
-      toasterList_t list_msg;
+      if(replay)
+      {
+          if(bagReplay.done())
+              break;
+
+          replayTime += ros::Duration(1.0 / publishRate);
+          bagReplay.replayUntil(replayTime, static_cast<ros::CallbackQueue*>(node.getCallbackQueue()));
+          ros::Time::setNow(replayTime);
+          tfSampler.sample();
+
+          if(replayRate > 0.0)
+              std::this_thread::sleep_until(replayStart + toDuration((replayTime - bagReplay.getBeginTime()).toSec() / replayRate));
+      }
+      else if(eventDriven)
+      {
+          if(UpdateSignal::waitUntil(lastPublication + toDuration(1.0 / publishRate)))
+              std::this_thread::sleep_until(std::max(std::chrono::steady_clock::now() + toDuration(maxPublishDelay),
+                                                     lastPublication + toDuration(1.0 / maxPublishRate)));
+          lastPublication = std::chrono::steady_clock::now();
+      }
+
+      listFiller.begin(list_msg);
+
+        // Streams are not created nor destroyed until the readers were published
+        std::unique_lock<std::mutex> readersLock(registry.mutex_);
+        const std::vector<ReaderRegistry::Stream_t>& streams = registry.getStreams();
 
         //update data
-        morseHumanRd.updateHumans(listener);
+        for(std::vector<ReaderRegistry::Stream_t>::const_iterator it = streams.begin(); it != streams.end(); ++it)
+          it->reader->update(tfSampler);
 
-        pr2RobotRd.updateRobot(listener);
-        spencerRobotRd.updateRobot(listener); // /!\ full config always at false !!
+        // Updates committed from now on are in this publication
+        UpdateSignal::clear();
+
+        // Presence of all the streams is evaluated at the same time, the replay time in replay
+        PresenceMonitor::Clock::time_point tick = PresenceMonitor::Clock::now();
+        if(replay)
+          tick = PresenceMonitor::Clock::time_point(std::chrono::duration_cast<PresenceMonitor::Clock::duration>(
+                                                      std::chrono::nanoseconds(replayTime.toNSec())));
 
         ///////////////////////////////////////////////////////////////////////
 
         //////////////////
         // publish data //
         //////////////////
-        while(!newPoseEnt_.empty())
-        {
-          Entity newPoseEnt = newPoseEnt_.front();
-          newPoseEnt_.pop();
+        std::queue<Entity> newPoses;
+        newPoseMutex_.lock();
+        newPoses.swap(newPoseEnt_);
+        newPoseMutex_.unlock();
 
-          for(vector<HumanReader*>::iterator it = humanReaders.begin(); it != humanReaders.end(); ++it)
-            (*it)->updateEntityPose(newPoseEnt);
+        while(!newPoses.empty())
+        {
+          Entity newPoseEnt = newPoses.front();
+          newPoses.pop();
 
+          for(std::vector<ReaderRegistry::Stream_t>::const_iterator it = streams.begin(); it != streams.end(); ++it)
+            it->reader->updateEntityPose(newPoseEnt);
+        }
 
-          for(vector<RobotReader*>::iterator it = robotReaders.begin(); it != robotReaders.end(); ++it)
-            (*it)->updateEntityPose(newPoseEnt);
+        // Newest data time of each stream with new data
+        std::map<std::string, uint64_t> streamTimes;
 
-          for(vector<ObjectReader*>::iterator it = objectReaders.begin(); it != objectReaders.end(); ++it)
-            (*it)->updateEntityPose(newPoseEnt);
+        // Each reader appends its agents as a segment of the list, fused once all are appended
+        humanFusion.begin();
+        for(std::vector<ReaderRegistry::Stream_t>::const_iterator it = streams.begin(); it != streams.end(); ++it)
+        {
+            if(it->reader->getKind() != ReaderBase::HUMAN)
+              continue;
+            unsigned int first = list_msg.human_msg.humanList.size();
+            streamTimes[it->name] = it->reader->appendSnapshot(listFiller, tick);
+            humanFusion.addSource(first, list_msg.human_msg.humanList.size(), it->reader->getSigma());
         }
+        humanFusion.fuse(list_msg.human_msg.humanList, list_msg.fact_msg.factList);
 
-	for(vector<HumanReader*>::iterator it = humanReaders.begin(); it != humanReaders.end(); ++it)
-	    (*it)->Publish(list_msg);
-
-	  for(vector<RobotReader*>::iterator it = robotReaders.begin(); it != robotReaders.end(); ++it)
-	    (*it)->Publish(list_msg);
+        robotFusion.begin();
+        for(std::vector<ReaderRegistry::Stream_t>::const_iterator it = streams.begin(); it != streams.end(); ++it)
+        {
+            if(it->reader->getKind() != ReaderBase::ROBOT)
+              continue;
+            unsigned int first = list_msg.robot_msg.robotList.size();
+            streamTimes[it->name] = it->reader->appendSnapshot(listFiller, tick);
+            robotFusion.addSource(first, list_msg.robot_msg.robotList.size(), it->reader->getSigma());
+        }
+        robotFusion.fuse(list_msg.robot_msg.robotList, list_msg.fact_msg.factList);
 
 
         //do publication for all objects
-        ObjectReader tmp;
-        tmp.Publish(list_msg, objectIn);
+        objectInMutex_.lock();
+        struct objectIn_t curObjectIn = objectIn;
+        objectInMutex_.unlock();
+        streamTimes["objects"] = ObjectReader::Publish(listFiller, curObjectIn, tick);
+        readersLock.unlock();
 
         ////////////////////////////////////////////////////////////////////////
 
@@ -317,29 +454,105 @@ int main(int argc, char** argv) {
         list_msg.human_msg.header = list_msg.object_msg.header;
         list_msg.robot_msg.header = list_msg.object_msg.header;
 
-        for(typeof(list_msg.object_msg.objectList.begin()) it=list_msg.object_msg.objectList.begin(); it!= list_msg.object_msg.objectList.end();++it){
-            broadcastTfEntity(tf_br,it->meEntity,"",list_msg.object_msg.header.stamp);
-        }
+        // tf is broadcast from the complete lists, lookups at the current time never miss unchanged entities
+        tfBatch.begin(list_msg.object_msg.header.stamp);
+        if(tfObjects)
+          for(typeof(list_msg.object_msg.objectList.begin()) it=list_msg.object_msg.objectList.begin(); it!= list_msg.object_msg.objectList.end();++it){
+              tfBatch.addEntity(it->meEntity);
+          }
+
+        if(tfHumans)
+          for(typeof(list_msg.human_msg.humanList.begin()) it=list_msg.human_msg.humanList.begin(); it!= list_msg.human_msg.humanList.end();++it){
+              tfBatch.addAgent(it->meAgent, tfJoints);
+          }
+        if(tfRobots)
+          for(typeof(list_msg.robot_msg.robotList.begin()) it=list_msg.robot_msg.robotList.begin(); it!= list_msg.robot_msg.robotList.end();++it){
+              tfBatch.addAgent(it->meAgent, tfJoints);
+          }
+        tfBatch.send(tf_br);
+
+        bool keyframe = true;
+        if(skipUnchanged)
+        {
+          keyframe = (list_msg.object_msg.header.stamp - lastKeyframe).toSec() >= keyframePeriod;
+          if(keyframe)
+            lastKeyframe = list_msg.object_msg.header.stamp;
 
-        for(typeof(list_msg.human_msg.humanList.begin()) it=list_msg.human_msg.humanList.begin(); it!= list_msg.human_msg.humanList.end();++it){
-            broadcastTfAgent(tf_br,it->meAgent,"",list_msg.human_msg.header.stamp);
-        }
-        for(typeof(list_msg.robot_msg.robotList.begin()) it=list_msg.robot_msg.robotList.begin(); it!= list_msg.robot_msg.robotList.end();++it){
-            broadcastTfAgent(tf_br,it->meAgent,"",list_msg.robot_msg.header.stamp);
+          removeUnchanged(list_msg.object_msg.objectList, publishedObjectTimes, keyframe);
+          removeUnchanged(list_msg.human_msg.humanList, publishedHumanTimes, keyframe);
+          removeUnchanged(list_msg.robot_msg.robotList, publishedRobotTimes, keyframe);
         }
 
 
         //ROS_INFO("%s", msg.data.c_str());
 
-        object_pub.publish(list_msg.object_msg);
-        human_pub.publish(list_msg.human_msg);
-        robot_pub.publish(list_msg.robot_msg);
-        fact_pub.publish(list_msg.fact_msg);
+        // Empty lists are only published as keyframes when unchanged entities are skipped.
+        // Lists are swapped with the pooled messages, the previous ones are refilled next loop.
+        if(keyframe || !list_msg.object_msg.objectList.empty())
+        {
+          boost::shared_ptr<toaster_msgs::ObjectListStamped> object_msg = objectPool.get();
+          object_msg->header = list_msg.object_msg.header;
+          object_msg->objectList.swap(list_msg.object_msg.objectList);
+          object_pub.publish(object_msg);
+        }
+        if(keyframe || !list_msg.human_msg.humanList.empty())
+        {
+          boost::shared_ptr<toaster_msgs::HumanListStamped> human_msg = humanPool.get();
+          human_msg->header = list_msg.human_msg.header;
+          human_msg->humanList.swap(list_msg.human_msg.humanList);
+          human_pub.publish(human_msg);
+        }
+        if(keyframe || !list_msg.robot_msg.robotList.empty())
+        {
+          boost::shared_ptr<toaster_msgs::RobotListStamped> robot_msg = robotPool.get();
+          robot_msg->header = list_msg.robot_msg.header;
+          robot_msg->robotList.swap(list_msg.robot_msg.robotList);
+          robot_pub.publish(robot_msg);
+        }
+        boost::shared_ptr<toaster_msgs::FactList> fact_msg = factPool.get();
+        fact_msg->factList.swap(list_msg.fact_msg.factList);
+        fact_pub.publish(fact_msg);
+
+        ////////////////////
+        // latency report //
+        ////////////////////
+        uint64_t publicationTime = ros::Time::now().toNSec();
+        for(std::map<std::string, uint64_t>::iterator it = streamTimes.begin(); it != streamTimes.end(); ++it)
+          if(it->second != 0 && it->second <= publicationTime)
+            latencies[it->first].add((publicationTime - it->second) / 1e9);
+
+        if(latencyReportPeriod > 0.0 && (ros::Time::now() - lastLatencyReport).toSec() >= latencyReportPeriod)
+        {
+          if(latency_pub.getNumSubscribers() > 0)
+          {
+            diagnostic_msgs::DiagnosticArray latency_msg;
+            latency_msg.header.stamp = ros::Time::now();
+            for(std::map<std::string, LatencyHistogram>::iterator it = latencies.begin(); it != latencies.end(); ++it)
+            {
+              diagnostic_msgs::DiagnosticStatus status;
+              it->second.fillStatus(it->first, status);
+              latency_msg.status.push_back(status);
+            }
+            latency_pub.publish(latency_msg);
+          }
+
+          for(std::map<std::string, LatencyHistogram>::iterator it = latencies.begin(); it != latencies.end(); ++it)
+            it->second.reset();
+          lastLatencyReport = ros::Time::now();
+        }
 
-        ros::spinOnce();
+        if(!eventDriven && !replay)
+          loop_rate.sleep();
 
-        loop_rate.sleep();
+    }
 
+    if(replay)
+    {
+      double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - replayStart).count();
+      ROS_INFO("[pdg] replayed %lu messages, %u publications, %f s of recording in %f s",
+               bagReplay.getNbMessages(), seq, (bagReplay.getEndTime() - bagReplay.getBeginTime()).toSec(), duration);
     }
     return 0;
 }
+
+} // namespace pdg
@@ -55,7 +55,8 @@ int main(int argc, char** argv) {
 
     ros::Rate loop_rate(30);
 
-    tf::TransformListener listener;
+    TfSampler tfSampler;
+    tfSampler.start();
     printf("[PDG] initializing\n");
 
     //toaster_msgs::ObjectList objectList_msg;
@@ -77,8 +78,8 @@ int main(int argc, char** argv) {
                     vimanObjectRd.updateObjects();
                 }
          * */
-        morseHumanRd.updateHumans(listener);
-        pr2RobotRd.updateRobot(listener);
+        morseHumanRd.updateHumans(tfSampler);
+        pr2RobotRd.updateRobot(tfSampler);
 
         //publish data
 
@@ -0,0 +1,9 @@
+#include "pdg/PdgNode.h"
+
+int main(int argc, char** argv) {
+    ros::init(argc, argv, "pdg");
+    ros::NodeHandle node;
+    ros::NodeHandle privateNode("~");
+
+    return pdg::run(node, privateNode);
+}
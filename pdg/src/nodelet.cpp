@@ -0,0 +1,12 @@
+#include <pluginlib/class_list_macros.h>
+#include <toaster_msgs/LoopNodelet.h>
+
+#include "pdg/PdgNode.h"
+
+namespace pdg {
+
+typedef LoopNodelet<&run> PdgNodelet;
+
+} // namespace pdg
+
+PLUGINLIB_EXPORT_CLASS(pdg::PdgNodelet, nodelet::Nodelet)
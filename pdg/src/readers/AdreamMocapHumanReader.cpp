@@ -6,6 +6,7 @@
  */
 
 #include "pdg/readers/AdreamMocapHumanReader.h"
+#include <pluginlib/class_list_macros.h>
 
 #include "tf/transform_listener.h"
 #include "geometry_msgs/PoseStamped.h"
@@ -55,38 +56,36 @@ void AdreamMocapHumanReader::init(ros::NodeHandle* node, std::string topicTorso,
     }
 }
 
-void AdreamMocapHumanReader::Publish(struct toasterList_t& list_msg)
+void AdreamMocapHumanReader::fillSnapshot(ListFiller& list)
 {
   if(activated_)
   {
+    // Presence is tested by appendSnapshot at publication
     for (std::map<std::string, Human*>::iterator it = lastConfig_.begin(); it != lastConfig_.end(); ++it) {
-        if (isPresent(it->first))
-        {
-            toaster_msgs::Fact fact_msg = DefaultFactMsg(it->first, it->second->getTime());
-            list_msg.fact_msg.factList.push_back(fact_msg);
-
-            //Human
-            toaster_msgs::Human human_msg;
-            fillEntity(it->second, human_msg.meAgent.meEntity);
-
-            //if (humanFullConfig_) {
-            for (std::map<std::string, Joint*>::iterator itJoint = lastConfig_[it->first]->skeleton_.begin(); itJoint != lastConfig_[it->first]->skeleton_.end(); ++itJoint) {
-                toaster_msgs::Joint joint_msg;
-                human_msg.meAgent.skeletonNames.push_back(itJoint->first);
-                fillEntity((itJoint->second), joint_msg.meEntity);
-                joint_msg.jointOwner = it->first;
-
-                human_msg.meAgent.skeletonJoint.push_back(joint_msg);
-
-            }
-            //}
-            list_msg.human_msg.humanList.push_back(human_msg);
+        DefaultFactMsg(list.nextFact(), it->first, it->second->getTime());
+
+        //Human
+        toaster_msgs::Human& human_msg = list.nextHuman();
+        human_msg.age = 0;
+        resetAgent(human_msg.meAgent, it->second->skeleton_.size());
+        orientations_.fillEntity(it->second, human_msg.meAgent.meEntity);
+
+        //if (humanFullConfig_) {
+        unsigned int i = 0;
+        for (std::map<std::string, Joint*>::iterator itJoint = it->second->skeleton_.begin(); itJoint != it->second->skeleton_.end(); ++itJoint, ++i) {
+            toaster_msgs::Joint& joint_msg = human_msg.meAgent.skeletonJoint[i];
+            human_msg.meAgent.skeletonNames[i] = itJoint->first;
+            orientations_.fillEntity((itJoint->second), joint_msg.meEntity);
+            joint_msg.jointOwner = it->first;
+            joint_msg.position = 0.0;
         }
+        //}
     }
   }
 }
 
 void AdreamMocapHumanReader::optitrackCallbackHead(const optitrack::or_pose_estimator_state::ConstPtr & msg) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
 
     ros::Time now = ros::Time::now();
     Human* curHuman;
@@ -177,9 +176,11 @@ void AdreamMocapHumanReader::optitrackCallbackHead(const optitrack::or_pose_esti
     } catch (tf::TransformException ex) {
         ROS_ERROR("[AdreamMocap Head transfor] %s", ex.what());
     }
+    commitSnapshot();
 }
 
 void AdreamMocapHumanReader::optitrackCallbackHand(const optitrack::or_pose_estimator_state::ConstPtr & msg) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
 
     ros::Time now = ros::Time::now();
     Human* curHuman;
@@ -232,9 +233,11 @@ void AdreamMocapHumanReader::optitrackCallbackHand(const optitrack::or_pose_esti
         ROS_ERROR("[AdreamMocap Hand transfor] %s", ex.what());
 
     }
+    commitSnapshot();
 }
 
 void AdreamMocapHumanReader::optitrackCallbackTorso(const optitrack::or_pose_estimator_state::ConstPtr & msg) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
 
     ros::Time now = ros::Time::now();
     Human* curHuman;
@@ -330,4 +333,14 @@ void AdreamMocapHumanReader::optitrackCallbackTorso(const optitrack::or_pose_est
         ROS_ERROR("[AdreamMocap Torso transfor] %s", ex.what());
 
     }
+    commitSnapshot();
 }
+
+// Reads stream name from its default inputs
+void AdreamMocapHumanReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/optitrack/bodies/Rigid_Body_3", "/optitrack/bodies/Rigid_Body_1", "/optitrack/bodies/Rigid_Body_2", "/pdg/" + name);
+  setFullConfig("/pdg/fullHumanConfig");
+}
+
+PLUGINLIB_EXPORT_CLASS(AdreamMocapHumanReader, ReaderBase)
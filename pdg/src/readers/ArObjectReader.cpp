@@ -6,6 +6,7 @@
  */
 
 #include "pdg/readers/ArObjectReader.h"
+#include <pluginlib/class_list_macros.h>
 
 #include "geometry_msgs/PoseStamped.h"
 #include "tf/transform_listener.h"
@@ -30,11 +31,11 @@ void ArObjectReader::CallbackObj(const visualization_msgs::Marker::ConstPtr& msg
 
   if(activated_)
   {
+    std::lock_guard<std::mutex> lock(lastConfigMutex_);
   	ros::Time now = ros::Time::now();
   	MovableObject* curObject;
 
   	//create a new object with the same id as the message
-    lastConfigMutex_.lock();
   	if (globalLastConfig_.find(msg->ns) == globalLastConfig_.end()) {
   		curObject = new MovableObject(msg->ns);
   		curObject->setName(msg->ns);
@@ -42,7 +43,6 @@ void ArObjectReader::CallbackObj(const visualization_msgs::Marker::ConstPtr& msg
   	} else
   		curObject = globalLastConfig_[msg->ns];
 
-    lastConfigMutex_.unlock();
 
   	//set object position
   	bg::model::point<double, 3, bg::cs::cartesian> objectPosition;
@@ -62,14 +62,19 @@ void ArObjectReader::CallbackObj(const visualization_msgs::Marker::ConstPtr& msg
   	objectOrientation.push_back(pitch);
   	objectOrientation.push_back(yaw);
 
-  	//put the data in the object
-  	curObject->setOrientation(objectOrientation);
-  	curObject->setPosition(objectPosition);
-  	curObject->setTime(now.toNSec());      //Similar to AdreamMoCapHumanReader. Is it better to use time stamp from msg
+  	//put the data in the object, fused with the other readers
+  	setMeasuredPose(curObject, objectPosition, objectOrientation, now.toNSec());      //Similar to AdreamMoCapHumanReader. Is it better to use time stamp from msg
 
-    lastConfigMutex_.lock();
   	globalLastConfig_[msg->ns]=curObject;
-    lastConfigMutex_.unlock();
     lastConfig_[msg->ns]=curObject;
+    commitObjects();
   }
 }
+
+// Reads stream name from its default inputs
+void ArObjectReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "ar_visualization_marker", "/pdg/" + name);
+}
+
+PLUGINLIB_EXPORT_CLASS(ArObjectReader, ReaderBase)
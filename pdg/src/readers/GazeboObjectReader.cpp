@@ -6,6 +6,7 @@
  */
 
 #include "pdg/readers/GazeboObjectReader.h"
+#include <pluginlib/class_list_macros.h>
 
 #include "tf/transform_listener.h"
 #include <math.h>
@@ -29,6 +30,7 @@ void GazeboObjectReader::CallbackObj(const gazebo_msgs::ModelStates::ConstPtr& m
 
   if(activated_)
   {
+    std::lock_guard<std::mutex> lock(lastConfigMutex_);
   	ros::Time now = ros::Time::now();
   	MovableObject* curObject;
   	std::vector<std::string> objectsName = msg->name;
@@ -47,7 +49,6 @@ void GazeboObjectReader::CallbackObj(const gazebo_msgs::ModelStates::ConstPtr& m
   		}
 
   		// If this object is not assigned we have to allocate data.
-      lastConfigMutex_.lock();
   		if (globalLastConfig_.find(objectsName[i]) == globalLastConfig_.end()) {
   		    curObject = new MovableObject(objectsName[i]);
   		    curObject->setRoomId(0);
@@ -56,19 +57,15 @@ void GazeboObjectReader::CallbackObj(const gazebo_msgs::ModelStates::ConstPtr& m
   		} else{
   		    curObject = globalLastConfig_[objectsName[i]];
   		}
-      lastConfigMutex_.unlock();
 
   		std::vector<double> objOrientation;
   		bg::model::point<double, 3, bg::cs::cartesian> objPosition;
 
   		curObject->setId(objectsName[i]);
 
-  		curObject->setTime(now.toNSec());
-
   		objPosition.set<0>(objectsPose[i].position.x);
   		objPosition.set<1>(objectsPose[i].position.y);
   		objPosition.set<2>(objectsPose[i].position.z);
-  		curObject->setPosition(objPosition);
 
 
   		tf::Quaternion q;
@@ -80,12 +77,19 @@ void GazeboObjectReader::CallbackObj(const gazebo_msgs::ModelStates::ConstPtr& m
   		objOrientation.push_back(roll);
   		objOrientation.push_back(pitch);
   		objOrientation.push_back(yaw);
-  		curObject->setOrientation(objOrientation);
+  		setMeasuredPose(curObject, objPosition, objOrientation, now.toNSec());
 
-      lastConfigMutex_.lock();
   		globalLastConfig_[objectsName[i]] = curObject;
-      lastConfigMutex_.unlock();
       lastConfig_[objectsName[i]] = curObject;
   	}
+    commitObjects();
   }
 }
+
+// Reads stream name from its default inputs
+void GazeboObjectReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/gazebo/model_states", "/pdg/" + name);
+}
+
+PLUGINLIB_EXPORT_CLASS(GazeboObjectReader, ReaderBase)
@@ -6,6 +6,7 @@
  */
 
 #include "pdg/readers/GroupHumanReader.h"
+#include <pluginlib/class_list_macros.h>
 
 #include "geometry_msgs/PoseStamped.h"
 #include <sys/time.h>
@@ -21,10 +22,7 @@ GroupHumanReader::GroupHumanReader(bool fullHuman) : HumanReader()
 GroupHumanReader::~GroupHumanReader(){
   if(listener_ != nullptr)
     delete listener_;
-
-  for(std::map<std::string, Human*>::iterator it = lastConfig_.begin() ; it != lastConfig_.end(); ++it){
-      delete it->second;
-  }
+  // Humans of lastConfig_ are deleted by ~HumanReader
 }
 
 void GroupHumanReader::init(ros::NodeHandle* node, std::string topic, std::string param)
@@ -34,7 +32,8 @@ void GroupHumanReader::init(ros::NodeHandle* node, std::string topic, std::strin
   // ******************************************
   // Starts listening to the joint_states
   sub_ = node_->subscribe(topic, 1, &GroupHumanReader::groupTrackCallback, this);
-  listener_ = new tf::TransformListener;
+  // tf is received in the callback queue of node, in order with the tracks when they are replayed
+  listener_ = new tf::TransformListener(*node_, ros::Duration(tf::Transformer::DEFAULT_CACHE_TIME), false);
 }
 
 /*
@@ -46,13 +45,14 @@ void GroupHumanReader::groupTrackCallback(const spencer_tracking_msgs::TrackedGr
     ros::Time now = ros::Time::now();
     std::stringstream humId;
 
+    // Poses are transformed before writeMutex_ is taken, the publisher never waits for tf
+    std::vector<std::pair<std::string, geometry_msgs::PoseStamped> > mapPoses;
+
     try {
         std::string frame;
         frame = msg->header.frame_id;
 
-        //transform from the groupTrack frame to map
-        listener_->waitForTransform("/map", frame,
-                msg->header.stamp, ros::Duration(3.0));
+        //transform from the groupTrack frame to map, not waited for: tracks without it are dropped
         listener_->lookupTransform("/map", frame,
                 msg->header.stamp, transform);
 
@@ -60,8 +60,6 @@ void GroupHumanReader::groupTrackCallback(const spencer_tracking_msgs::TrackedGr
         for (int i = 0; i < msg->groups.size(); i++) {
             spencer_tracking_msgs::TrackedGroup group = msg->groups[i];
             humId << " group" << group.group_id;
-            //create a new human with the same id as the message
-            Human* curHuman = new Human(humId.str());
 
             //get the pose of the agent in the groupTrack frame and transform it to the map frame
             geometry_msgs::PoseStamped groupTrackPose, mapPose;
@@ -72,31 +70,54 @@ void GroupHumanReader::groupTrackCallback(const spencer_tracking_msgs::TrackedGr
             groupTrackPose.header.stamp = msg->header.stamp;
             groupTrackPose.header.frame_id = frame;
             listener_->transformPose("/map", groupTrackPose, mapPose);
-
-            //set human position
-            bg::model::point<double, 3, bg::cs::cartesian> humanPosition;
-            humanPosition.set<0>(mapPose.pose.position.x);
-            humanPosition.set<1>(mapPose.pose.position.y);
-            humanPosition.set<2>(mapPose.pose.position.z);
-
-            //set the human orientation
-            std::vector<double> humanOrientation;
-
-            //transform the pose message
-            humanOrientation.push_back(0.0);
-            humanOrientation.push_back(0.0);
-            humanOrientation.push_back(tf::getYaw(mapPose.pose.orientation));
-
-            //put the data in the human
-            curHuman->setOrientation(humanOrientation);
-            curHuman->setPosition(humanPosition);
-            curHuman->setTime(now.toNSec());
-
-            lastConfig_[humId.str()] = curHuman;
+            mapPoses.push_back(std::make_pair(humId.str(), mapPose));
         }
     } catch (tf::TransformException ex) {
         ROS_ERROR("%s", ex.what());
 
 
     }
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    for (unsigned int i = 0; i < mapPoses.size(); i++) {
+        const geometry_msgs::PoseStamped& mapPose = mapPoses[i].second;
+
+        //create a new human with the same id as the message
+        Human* curHuman;
+        if (lastConfig_.find(mapPoses[i].first) == lastConfig_.end())
+            curHuman = new Human(mapPoses[i].first);
+        else
+            curHuman = lastConfig_[mapPoses[i].first];
+
+        //set human position
+        bg::model::point<double, 3, bg::cs::cartesian> humanPosition;
+        humanPosition.set<0>(mapPose.pose.position.x);
+        humanPosition.set<1>(mapPose.pose.position.y);
+        humanPosition.set<2>(mapPose.pose.position.z);
+
+        //set the human orientation
+        std::vector<double> humanOrientation;
+
+        //transform the pose message
+        humanOrientation.push_back(0.0);
+        humanOrientation.push_back(0.0);
+        humanOrientation.push_back(tf::getYaw(mapPose.pose.orientation));
+
+        //put the data in the human
+        curHuman->setOrientation(humanOrientation);
+        curHuman->setPosition(humanPosition);
+        curHuman->setTime(now.toNSec());
+
+        lastConfig_[mapPoses[i].first] = curHuman;
+    }
+    commitSnapshot();
+}
+
+// Reads stream name from its default inputs
+void GroupHumanReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/spencer/perception/tracked_groups", "/pdg/" + name);
+  setFullConfig("/pdg/fullHumanConfig");
 }
+
+PLUGINLIB_EXPORT_CLASS(GroupHumanReader, ReaderBase)
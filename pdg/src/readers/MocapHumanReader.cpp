@@ -2,6 +2,7 @@
 
 
 #include "pdg/readers/MocapHumanReader.h"
+#include <pluginlib/class_list_macros.h>
 
 #include "geometry_msgs/PoseStamped.h"
 #include <sys/time.h>
@@ -27,7 +28,8 @@ void MocapHumanReader::init(ros::NodeHandle* node, std::string topic, std::strin
   // ******************************************
   // Starts listening to the joint_states
   sub_ = node_->subscribe(topic, 1, &MocapHumanReader::optitrackCallback, this);
-  listener_ = new tf::TransformListener;
+  // tf is received in the callback queue of node, in order with the tracks when they are replayed
+  listener_ = new tf::TransformListener(*node_, ros::Duration(tf::Transformer::DEFAULT_CACHE_TIME), false);
 }
 
 /*
@@ -40,29 +42,21 @@ void MocapHumanReader::optitrackCallback(const spencer_tracking_msgs::TrackedPer
     Human* curHuman;
     std::stringstream humId;
 
+    // Poses are transformed before writeMutex_ is taken, the publisher never waits for tf
+    std::vector<std::pair<std::string, geometry_msgs::PoseStamped> > mapPoses;
+
     try {
         std::string frame;
         frame = msg->header.frame_id;
 
-        //transform from the mocap frame to map
-        listener_->waitForTransform("/map", frame,
-                msg->header.stamp, ros::Duration(3.0));
+        //transform from the mocap frame to map, not waited for: tracks without it are dropped
         listener_->lookupTransform("/map", frame,
                 msg->header.stamp, transform);
 
         //for every agent present in the tracking message
         for (int i = 0; i < msg->tracks.size(); i++) {
-            std::string humanName = "human";
             spencer_tracking_msgs::TrackedPerson person = msg->tracks[i];
             humId << "mocap_human" << person.track_id;
-            //create a new human with the same id as the message
-            if (lastConfig_.find(humId.str()) == lastConfig_.end()) {
-                curHuman = new Human(humId.str());
-                humanName.append(boost::to_string(humId.str()));
-                curHuman->setName(humanName);
-            } else {
-                curHuman = lastConfig_[humId.str()];
-            }
 
             //get the pose of the agent in the optitrack frame and transform it to the map frame
             geometry_msgs::PoseStamped optitrackPose, mapPose;
@@ -71,31 +65,57 @@ void MocapHumanReader::optitrackCallback(const spencer_tracking_msgs::TrackedPer
             optitrackPose.header.stamp = msg->header.stamp;
             optitrackPose.header.frame_id = frame;
             listener_->transformPose("/map", optitrackPose, mapPose);
+            mapPoses.push_back(std::make_pair(humId.str(), mapPose));
+        }
+    } catch (tf::TransformException ex) {
+        ROS_ERROR("%s", ex.what());
 
-            //set human position
-            bg::model::point<double, 3, bg::cs::cartesian> humanPosition;
-            humanPosition.set<0>(mapPose.pose.position.x);
-            humanPosition.set<1>(mapPose.pose.position.y);
-            humanPosition.set<2>(mapPose.pose.position.z);
-
-            //set the human orientation
-            std::vector<double> humanOrientation;
 
-            //transform the pose message
-            humanOrientation.push_back(0.0);
-            humanOrientation.push_back(0.0);
-            humanOrientation.push_back(tf::getYaw(mapPose.pose.orientation));
+    }
 
-            //put the data in the human
-            curHuman->setOrientation(humanOrientation);
-            curHuman->setPosition(humanPosition);
-            curHuman->setTime(now.toNSec());
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    for (unsigned int i = 0; i < mapPoses.size(); i++) {
+        const geometry_msgs::PoseStamped& mapPose = mapPoses[i].second;
 
-            lastConfig_[humId.str()] = curHuman;
+        //create a new human with the same id as the message
+        if (lastConfig_.find(mapPoses[i].first) == lastConfig_.end()) {
+            std::string humanName = "human";
+            curHuman = new Human(mapPoses[i].first);
+            humanName.append(boost::to_string(mapPoses[i].first));
+            curHuman->setName(humanName);
+        } else {
+            curHuman = lastConfig_[mapPoses[i].first];
         }
-    } catch (tf::TransformException ex) {
-        ROS_ERROR("%s", ex.what());
 
+        //set human position
+        bg::model::point<double, 3, bg::cs::cartesian> humanPosition;
+        humanPosition.set<0>(mapPose.pose.position.x);
+        humanPosition.set<1>(mapPose.pose.position.y);
+        humanPosition.set<2>(mapPose.pose.position.z);
+
+        //set the human orientation
+        std::vector<double> humanOrientation;
+
+        //transform the pose message
+        humanOrientation.push_back(0.0);
+        humanOrientation.push_back(0.0);
+        humanOrientation.push_back(tf::getYaw(mapPose.pose.orientation));
+
+        //put the data in the human
+        curHuman->setOrientation(humanOrientation);
+        curHuman->setPosition(humanPosition);
+        curHuman->setTime(now.toNSec());
 
+        lastConfig_[mapPoses[i].first] = curHuman;
     }
+    commitSnapshot();
 }
+
+// Reads stream name from its default inputs
+void MocapHumanReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/optitrack_person/tracked_persons", "/pdg/" + name);
+  setFullConfig("/pdg/fullHumanConfig");
+}
+
+PLUGINLIB_EXPORT_CLASS(MocapHumanReader, ReaderBase)
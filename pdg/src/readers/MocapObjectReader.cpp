@@ -56,18 +56,17 @@ void MocapObjectReader::optitrackCallback(const optitrack::or_pose_estimator_sta
 {
   if(activated_)
   {
+    std::lock_guard<std::mutex> lock(lastConfigMutex_);
     ros::Time now = ros::Time::now();
     MovableObject* curObject;
 
     try {
         //create a new object
-        lastConfigMutex_.lock();
         if (globalLastConfig_.find(id_) == globalLastConfig_.end()) {
             curObject = new MovableObject(id_);
             curObject->setName(id_);
         } else
             curObject = globalLastConfig_[id_];
-        lastConfigMutex_.unlock();
 
         if (msg->pos.size() != 0) {
 
@@ -90,14 +89,10 @@ void MocapObjectReader::optitrackCallback(const optitrack::or_pose_estimator_sta
             objectOrientation.push_back(pitch);
             objectOrientation.push_back(yaw);
 
-            //put the data in the object
-            curObject->setOrientation(objectOrientation);
-            curObject->setPosition(objectPosition);
-            curObject->setTime(now.toNSec());
+            //put the data in the object, fused with the other readers
+            setMeasuredPose(curObject, objectPosition, objectOrientation, now.toNSec());
 
-            lastConfigMutex_.lock();
             globalLastConfig_[id_] = curObject;
-            lastConfigMutex_.unlock();
             lastConfig_[id_] = curObject;
         }
 
@@ -105,5 +100,6 @@ void MocapObjectReader::optitrackCallback(const optitrack::or_pose_estimator_sta
       std::string err = "[Mocap " + id_ + " transfor] " + std::string(ex.what());
       ROS_ERROR("%s", err.c_str());
     }
+    commitObjects();
   }
 }
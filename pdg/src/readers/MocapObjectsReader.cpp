@@ -5,6 +5,7 @@
  */
 
 #include "pdg/readers/MocapObjectsReader.h"
+#include <pluginlib/class_list_macros.h>
 
 #include <ostream>
 #include <sstream>
@@ -51,12 +52,10 @@ void MocapObjectsReader::init(ros::NodeHandle* node,
     std::cout << "[PDG ERROR] Mocap readers parameters not of same length " << std::endl;
 }
 
-void MocapObjectsReader::extract(std::vector<ObjectReader*>& objectReaders)
+// Topics and ids of the objects are given by /pdg/mocapObjectsTopics and /pdg/mocapObjectsIds
+void MocapObjectsReader::initialize(ros::NodeHandle* node, const std::string& name)
 {
-  for(unsigned int i = 0; i < readers_.size(); i++)
-  {
-    objectReaders.push_back(readers_[i]);
-  }
+  init(node, "/pdg/mocapObjectsTopics", "/pdg/mocapObjectsIds", "/pdg/" + name);
 }
 
 void MocapObjectsReader::split(const std::string &txt, std::vector<std::string> &strs, char ch)
@@ -76,3 +75,13 @@ void MocapObjectsReader::setActivation(bool activated)
     readers_[i]->setActivation(activated);
   }
 }
+
+void MocapObjectsReader::updateEntityPose(Entity& newPoseEnt)
+{
+  for(unsigned int i = 0; i < readers_.size(); i++)
+  {
+    readers_[i]->updateEntityPose(newPoseEnt);
+  }
+}
+
+PLUGINLIB_EXPORT_CLASS(MocapObjectsReader, ReaderBase)
@@ -1,66 +1,64 @@
 #include "pdg/readers/MorseHumanReader.h"
+#include <pluginlib/class_list_macros.h>
 
 
 MorseHumanReader::MorseHumanReader(bool fullHuman) : HumanReader(){
   fullHuman_ = fullHuman;
 }
 
-MorseHumanReader::~MorseHumanReader(){
-    for(std::map<std::string, Human*>::iterator it = lastConfig_.begin() ; it != lastConfig_.end(); ++it){
-        delete it->second;
-    }
-}
-
 void MorseHumanReader::init(ros::NodeHandle* node, std::string param)
 {
   std::cout << "[PDG] Initializing MorseHumanReader" << std::endl;
   Reader<Human>::init(node, param);
 }
 
-void MorseHumanReader::updateHumans(tf::TransformListener &listener) {
+void MorseHumanReader::updateHumans(TfSampler &sampler) {
   //update 1st human, this should be extended for multi human
   if(activated_)
-    updateHuman(listener, "morse_human1", "/human_base");
+    updateHuman(sampler, "morse_human1", "/human_base");
 }
 
-void MorseHumanReader::updateHuman(tf::TransformListener &listener, std::string humId, std::string humanBase){
-  tf::StampedTransform transform;
-  Human* curHuman = new Human(humId);
-  //TODO set name with humId
-  curHuman->setName("human1");
+void MorseHumanReader::updateHuman(TfSampler &sampler, std::string humId, std::string humanBase){
+  TfSample_t sample;
   std::vector<double> humanOrientation;
   bg::model::point<double, 3, bg::cs::cartesian> humanPosition;
 
+  sampler.addFrame(humanBase);
+  if (!sampler.getSample(humanBase, sample))
+    return;
 
-  try{
-    ros::Time now = ros::Time::now();
-    listener.waitForTransform("/map", humanBase,
-        now, ros::Duration(3.0));
-        listener.lookupTransform("/map", humanBase,
-        now, transform);
+  std::lock_guard<std::mutex> lock(writeMutex_);
 
-        //Human position
-        humanPosition.set<0>(transform.getOrigin().x());
-        humanPosition.set<1>(transform.getOrigin().y());
-        humanPosition.set<2>(transform.getOrigin().z());
+  Human* curHuman;
+  std::map<std::string, Human*>::iterator it = lastConfig_.find(humId);
+  if (it == lastConfig_.end()) {
+    curHuman = new Human(humId);
+    //TODO set name with humId
+    curHuman->setName("human1");
+    lastConfig_[humId] = curHuman;
+  } else if (sample.stale) {
+    // Keep the last pose and its time
+    return;
+  } else
+    curHuman = it->second;
 
-        //Human orientation
-        //curHuman->orientation.push_back(tf::getRoll(transform.getRotation()));
-        //curHuman->orientation.push_back(tf::getPitch(transform.getRotation()));
-        humanOrientation.push_back(0.0);
-        humanOrientation.push_back(0.0);
-        humanOrientation.push_back(tf::getYaw(transform.getRotation()));
+  //Human position
+  humanPosition.set<0>(sample.transform.getOrigin().x());
+  humanPosition.set<1>(sample.transform.getOrigin().y());
+  humanPosition.set<2>(sample.transform.getOrigin().z());
 
-        curHuman->setOrientation(humanOrientation);
-        curHuman->setPosition(humanPosition);
-        curHuman->setTime(now.toNSec());
+  //Human orientation
+  //curHuman->orientation.push_back(tf::getRoll(transform.getRotation()));
+  //curHuman->orientation.push_back(tf::getPitch(transform.getRotation()));
+  humanOrientation.push_back(0.0);
+  humanOrientation.push_back(0.0);
+  humanOrientation.push_back(tf::getYaw(sample.transform.getRotation()));
 
-        lastConfig_[humId] = curHuman;
+  curHuman->setOrientation(humanOrientation);
+  curHuman->setPosition(humanPosition);
+  curHuman->setTime(sample.time);
 
-  }
-  catch (tf::TransformException ex){
-    ROS_ERROR("%s",ex.what());
-  }
+  commitSnapshot();
 }
 
 //TODO: full human case
@@ -81,3 +79,12 @@ void MorseHumanReader::updateHuman(tf::TransformListener &listener, std::string
       m_LastConfig[101]->skeleton[l_ankle] = msg->position[5]; //Left ankle
   }
 }*/
+
+// Reads stream name from its default inputs
+void MorseHumanReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/pdg/" + name);
+  setFullConfig("/pdg/fullHumanConfig");
+}
+
+PLUGINLIB_EXPORT_CLASS(MorseHumanReader, ReaderBase)
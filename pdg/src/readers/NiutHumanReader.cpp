@@ -17,6 +17,7 @@ void NiutHumanReader::init(ros::NodeHandle* node, std::string topic, std::string
 }
 
 void NiutHumanReader::humanJointCallBack(const niut_msgs::niut_HUMAN_LIST::ConstPtr& msg) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
     std::stringstream id;
     Joint curJoint("", "");
     std::vector<int> trackedJoints;
@@ -77,6 +78,7 @@ void NiutHumanReader::humanJointCallBack(const niut_msgs::niut_HUMAN_LIST::Const
 
         }
     }
+    commitSnapshot();
 }
 
 void NiutHumanReader::updateJoint(int i, int j, Joint& curJoint, std::string toasterId, std::vector<int>& trackedJoints, const niut_msgs::niut_HUMAN_LIST::ConstPtr& msg) {
@@ -6,6 +6,7 @@
  */
 
 #include "pdg/readers/OM2MObjectReader.h"
+#include <pluginlib/class_list_macros.h>
 
 #include "pdg/utility/XmlUtility.h"
 
@@ -100,9 +101,9 @@ vector<struct preFact_t> OM2MObjectReader::readPreFacts(MovableObject* object)
   return preFacts;
 }
 
-void OM2MObjectReader::Publish(struct toasterList_t& list_msg)
+// Called by buildObjects with lastConfigMutex_ held
+void OM2MObjectReader::fillSnapshot(ListFiller& list)
 {
-  lastConfigMutex_.lock();
   for (std::map<std::string, MovableObject *>::iterator it_obj = globalLastConfig_.begin();
        it_obj != globalLastConfig_.end(); ++it_obj)
   {
@@ -110,7 +111,8 @@ void OM2MObjectReader::Publish(struct toasterList_t& list_msg)
     vector<struct preFact_t> preFacts = readPreFacts(it_obj->second);
     for(vector<struct preFact_t>::iterator it = preFacts.begin(); it != preFacts.end(); ++it)
     {
-      toaster_msgs::Fact fact_msg;
+      toaster_msgs::Fact& fact_msg = list.nextFact();
+      resetFact(fact_msg);
       fact_msg.subjectId = it_obj->first;
       fact_msg.time = it_obj->second->getTime();
 
@@ -152,23 +154,20 @@ void OM2MObjectReader::Publish(struct toasterList_t& list_msg)
         fact_msg.propertyType = "measure";
 
       fact_msg.property = it->type;
-
-      list_msg.fact_msg.factList.push_back(fact_msg);
     }
   }
-  lastConfigMutex_.unlock();
 }
 
 void OM2MObjectReader::newValueCallBack(const toaster_msgs::IoTData::ConstPtr& msg) {
   if(activated_)
   {
+    std::lock_guard<std::mutex> lock(lastConfigMutex_);
     ros::Time now = ros::Time::now();
     // OM2M objects are by convention considered movable
     MovableObject* curObject;
     bool is_new = false;
 
     //create a new object with the same id and name as the message
-    lastConfigMutex_.lock();
     if (globalLastConfig_.find(msg->data.key) == globalLastConfig_.end()) {
         curObject = new MovableObject(msg->data.key);
         curObject->setName(msg->data.key);
@@ -177,8 +176,6 @@ void OM2MObjectReader::newValueCallBack(const toaster_msgs::IoTData::ConstPtr& m
     } else
         curObject = (MovableObject*)globalLastConfig_[msg->data.key];
 
-    lastConfigMutex_.unlock();
-
     //set object position at default : 0,0,0
     bg::model::point<double, 3, bg::cs::cartesian> objectPosition;
     objectPosition.set<0>(0);
@@ -206,9 +203,16 @@ void OM2MObjectReader::newValueCallBack(const toaster_msgs::IoTData::ConstPtr& m
     unsigned long micro_sec = msg->header.stamp.sec * 1000000;
     curObject->setTime(micro_sec);
 
-    lastConfigMutex_.lock();
     globalLastConfig_[msg->data.key]=curObject;
-    lastConfigMutex_.unlock();
     lastConfig_[msg->data.key]=curObject;
+    commitObjects();
   }
 }
+
+// Reads stream name from its default inputs
+void OM2MObjectReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/iot2pdg_updates", "/pdg/" + name);
+}
+
+PLUGINLIB_EXPORT_CLASS(OM2MObjectReader, ReaderBase)
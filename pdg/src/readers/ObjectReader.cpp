@@ -1,66 +1,261 @@
 #include "pdg/readers/ObjectReader.h"
 #include <ostream>
+#include <algorithm>
 
 //init static variables
 unsigned int ObjectReader::nbObjects_ = 0;
 std::vector<ObjectReader*> ObjectReader::childs_;
+std::vector<ObjectReader*> ObjectReader::objectReaders_;
 std::map<std::string, MovableObject*> ObjectReader::globalLastConfig_;
 std::mutex ObjectReader::lastConfigMutex_;
+std::atomic<bool> ObjectReader::objectsStale_(false);
+toasterList_t ObjectReader::objectsSnapshot_;
+ListFiller ObjectReader::objectsFiller_;
+OrientationCache ObjectReader::objectsOrientations_;
+std::map<std::string, toaster_msgs::Entity> ObjectReader::handPoses_;
+std::map<std::string, std::vector<ObjectReader::Measure_t> > ObjectReader::measures_;
+std::map<std::string, double> ObjectReader::confidences_;
+double ObjectReader::fusionGate_ = 0.0;
+uint64_t ObjectReader::fusionWindow_ = 500000000;
+PresenceMonitor ObjectReader::objectsPresence_;
+std::vector<std::string> ObjectReader::objectsExpired_;
 unsigned int ObjectReader::nbReaders_ = 0;
 
 ObjectReader::ObjectReader() : Reader<MovableObject>()
 {
   nbLocalObjects_ = 0;
+
+  std::lock_guard<std::mutex> lock(lastConfigMutex_);
   nbReaders_++;
+  objectReaders_.push_back(this);
 }
 
 ObjectReader::~ObjectReader()
 {
+  std::lock_guard<std::mutex> lock(lastConfigMutex_);
   nbReaders_--;
 
+  // Readers are destroyed when their stream is removed: the others do not fuse with its measures anymore
+  childs_.erase(std::remove(childs_.begin(), childs_.end(), this), childs_.end());
+  objectReaders_.erase(std::remove(objectReaders_.begin(), objectReaders_.end(), this), objectReaders_.end());
+
+  for(std::map<std::string, std::vector<Measure_t> >::iterator it = measures_.begin(); it != measures_.end(); )
+  {
+    for(std::vector<Measure_t>::iterator itMeasure = it->second.begin(); itMeasure != it->second.end(); )
+      if(itMeasure->reader == this)
+        itMeasure = it->second.erase(itMeasure);
+      else
+        ++itMeasure;
+
+    // Objects measured by no other reader
+    if(it->second.empty())
+    {
+      confidences_.erase(it->first);
+      it = measures_.erase(it);
+    }
+    else
+      ++it;
+  }
+
+  // Objects read by this reader only are not published anymore
+  for(std::map<std::string, MovableObject*>::iterator it = lastConfig_.begin(); it != lastConfig_.end(); ++it)
+  {
+    if(isSharedObject(it->first))
+      continue;
+
+    std::map<std::string, MovableObject*>::iterator itGlobal = globalLastConfig_.find(it->first);
+    if(itGlobal != globalLastConfig_.end())
+    {
+      delete itGlobal->second;
+      globalLastConfig_.erase(itGlobal);
+    }
+    measures_.erase(it->first);
+    confidences_.erase(it->first);
+  }
+  lastConfig_.clear();
+
   //delete globalLastConfig_ only if there are no more readers
   if(!nbReaders_)
   {
-    lastConfigMutex_.lock();
     for(std::map<std::string, MovableObject*>::iterator it = globalLastConfig_.begin(); it != globalLastConfig_.end(); ++it)
       delete it->second;
-    lastConfigMutex_.unlock();
+    globalLastConfig_.clear();
+    measures_.clear();
+    confidences_.clear();
   }
+
+  commitObjects();
 }
 
-bool ObjectReader::isPresent(std::string id)
+bool ObjectReader::isSharedObject(const std::string& id) const
 {
-  timeval curTime;
-  gettimeofday(&curTime, NULL);
-  unsigned long now = curTime.tv_sec * pow(10,9) + curTime.tv_usec;
-  unsigned long timeThreshold = pow(10,9);
-
-  long timeDif = lastConfig_[id]->getTime() - now;
-
-  if ( fabs(timeDif) < timeThreshold)
+  for(std::vector<ObjectReader*>::const_iterator it = objectReaders_.begin(); it != objectReaders_.end(); ++it)
+    if(*it != this && (*it)->lastConfig_.find(id) != (*it)->lastConfig_.end())
       return true;
-  else
-      return false;
+  return false;
+}
+
+void ObjectReader::commitObjects()
+{
+  objectsStale_ = true;
+  UpdateSignal::notify();
 }
 
-void ObjectReader::Publish(struct toasterList_t& list_msg, struct objectIn_t& objectIn)
+void ObjectReader::buildObjects()
 {
+  objectsFiller_.begin(objectsSnapshot_);
+  objectsOrientations_.begin();
+
   for(std::vector<ObjectReader*>::iterator it = childs_.begin(); it != childs_.end(); ++it)
-    (*it)->Publish(list_msg);
+    (*it)->fillSnapshot(objectsFiller_);
 
-  lastConfigMutex_.lock();
   for (std::map<std::string, MovableObject *>::iterator it = globalLastConfig_.begin();
        it != globalLastConfig_.end(); ++it)
   {
-      // If in hand, modify position:
-      putInHand(objectIn, it->first, it->second, list_msg);
       //Message for object
-      toaster_msgs::Object object_msg;
+      toaster_msgs::Object& object_msg = objectsFiller_.nextObject();
+      resetObject(object_msg);
       fillValue(it->second, object_msg);
-      fillEntity(it->second, object_msg.meEntity);
-      list_msg.object_msg.objectList.push_back(object_msg);
+      objectsOrientations_.fillEntity(it->second, object_msg.meEntity);
+
+      // Objects measured by the readers are present with the confidence of their fused position
+      std::map<std::string, double>::iterator itConfidence = confidences_.find(it->first);
+      if (itConfidence != confidences_.end())
+      {
+        toaster_msgs::Fact& fact_msg = objectsFiller_.nextFact();
+        fillPresenceFact(fact_msg, it->first, it->second->getTime(), true);
+        fact_msg.confidence = itConfidence->second;
+      }
+  }
+}
+
+uint64_t ObjectReader::Publish(ListFiller& list, struct objectIn_t& objectIn, PresenceMonitor::Clock::time_point now)
+{
+  // Objects are rebuilt if no writer holds lastConfigMutex_, the previous ones are published otherwise
+  bool fresh = false;
+  if (objectsStale_)
+  {
+    std::unique_lock<std::mutex> lock(lastConfigMutex_, std::try_to_lock);
+    if (lock.owns_lock())
+    {
+      objectsStale_ = false;
+      buildObjects();
+      fresh = true;
+    }
+    else
+      UpdateSignal::notify();
+  }
+
+  uint64_t newest = 0;
+  const toasterList_t& snapshot = objectsSnapshot_;
+
+  objectsPresence_.expire(now, objectsExpired_);
+
+  for (std::vector<toaster_msgs::Object>::const_iterator it = snapshot.object_msg.objectList.begin();
+       it != snapshot.object_msg.objectList.end(); ++it)
+  {
+      // Objects in hand are moved by the hand, they stay present
+      if (!objectsPresence_.touch(it->meEntity.id, it->meEntity.time, now) &&
+          objectIn.Agent_.find(it->meEntity.id) == objectIn.Agent_.end())
+        continue;
+
+      toaster_msgs::Object& object_msg = list.nextObject();
+      object_msg = *it;
+      newest = std::max(newest, (uint64_t)object_msg.meEntity.time);
+
+      // If in hand, modify position:
+      putInHand(objectIn, object_msg, list);
+  }
+
+  for (std::vector<toaster_msgs::Fact>::const_iterator it = snapshot.fact_msg.factList.begin();
+       it != snapshot.fact_msg.factList.end(); ++it)
+    if (it->property != "isPresent" || objectsPresence_.isPresent(it->subjectId))
+      list.nextFact() = *it;
+
+  for (std::vector<std::string>::const_iterator it = objectsExpired_.begin(); it != objectsExpired_.end(); ++it)
+    if (!objectsPresence_.isPresent(*it))
+      fillPresenceFact(list.nextFact(), *it, objectsPresence_.getTime(*it), false);
+  objectsExpired_.clear();
+
+  // Entities removed from the snapshot are forgotten
+  objectsPresence_.prune();
+
+  return fresh ? newest : 0;
+}
+
+void ObjectReader::updateEntityPose(Entity& newPoseEnt)
+{
+  std::string id = newPoseEnt.getId();
+
+  std::lock_guard<std::mutex> lock(lastConfigMutex_);
+  for (std::map<std::string, MovableObject*>::iterator it = lastConfig_.begin(); it != lastConfig_.end(); ++it)
+      Reader<MovableObject>::updateEntityPose(newPoseEnt, it->first, (Entity*)it->second);
+
+  // newPoseEnt id is reset once it was applied, the requested pose replaces the one of a hand
+  if(newPoseEnt.getId() == "")
+  {
+    handPoses_.erase(id);
+    commitObjects();
+  }
+}
+
+void ObjectReader::setFusion(double gate, double window)
+{
+  std::lock_guard<std::mutex> lock(lastConfigMutex_);
+  fusionGate_ = gate;
+  fusionWindow_ = window > 0.0 ? window * 1e9 : 0;
+}
+
+void ObjectReader::setMeasuredPose(MovableObject* object, const bg::model::point<double, 3, bg::cs::cartesian>& position,
+                                   const std::vector<double>& orientation, uint64_t time)
+{
+  std::vector<Measure_t>& measures = measures_[object->getId()];
+  std::vector<Measure_t>::iterator itMeasure = measures.begin();
+  while (itMeasure != measures.end() && itMeasure->reader != this)
+    ++itMeasure;
+  if (itMeasure == measures.end())
+  {
+    measures.push_back(Measure_t());
+    itMeasure = measures.end() - 1;
+    itMeasure->reader = this;
+  }
+
+  itMeasure->time = time;
+  itMeasure->position.x = position.get<0>();
+  itMeasure->position.y = position.get<1>();
+  itMeasure->position.z = position.get<2>();
+  itMeasure->position.sigma = sigma_;
+  itMeasure->orientation = orientation;
+
+  // Measures of the readers which do not see the object anymore are dropped
+  for (itMeasure = measures.begin(); itMeasure != measures.end(); )
+    if (itMeasure->time + fusionWindow_ < time)
+      itMeasure = measures.erase(itMeasure);
+    else
+      ++itMeasure;
+
+  // The gate is centred on the freshest measure, the most precise one if several are as fresh
+  unsigned int anchor = 0;
+  std::vector<EntityFusion::Position_t> positions(1, measures[0].position);
+  for (unsigned int i = 1; i < measures.size(); i++)
+  {
+    positions.push_back(measures[i].position);
+    if (measures[i].time > measures[anchor].time ||
+        (measures[i].time == measures[anchor].time && measures[i].position.sigma < measures[anchor].position.sigma))
+      anchor = i;
   }
-  lastConfigMutex_.unlock();
+
+  EntityFusion::Position_t fused;
+  EntityFusion::combine(positions, anchor, fusionGate_, fused);
+
+  bg::model::point<double, 3, bg::cs::cartesian> fusedPosition;
+  fusedPosition.set<0>(fused.x);
+  fusedPosition.set<1>(fused.y);
+  fusedPosition.set<2>(fused.z);
+  object->setPosition(fusedPosition);
+  object->setOrientation(measures[anchor].orientation);
+  object->setTime(time);
+  confidences_[object->getId()] = EntityFusion::confidence(fused.sigma);
 }
 
 void ObjectReader::increaseNbObjects()
@@ -69,9 +264,9 @@ void ObjectReader::increaseNbObjects()
   nbLocalObjects_++;
 }
 
-toaster_msgs::Fact ObjectReader::DefaultFactMsg(string id, MovableObject* object, struct objectIn_t& objectIn)
+void ObjectReader::DefaultFactMsg(toaster_msgs::Fact& fact_msg, const string& id, uint64_t time, struct objectIn_t& objectIn)
 {
-  toaster_msgs::Fact fact_msg;
+  resetFact(fact_msg);
 
   //Fact message
   fact_msg.property = "IsInHand";
@@ -82,22 +277,27 @@ toaster_msgs::Fact ObjectReader::DefaultFactMsg(string id, MovableObject* object
   fact_msg.targetOwnerId = objectIn.Agent_[id];
   fact_msg.confidence = 1.0;
   fact_msg.factObservability = 0.8;
-  fact_msg.time = object->getTime();
+  fact_msg.time = time;
   fact_msg.valueType = 0;
   fact_msg.stringValue = "true";
-
-  return fact_msg;
 }
 
-void ObjectReader::putInHand(struct objectIn_t& objectIn, string id, MovableObject* object, struct toasterList_t& list_msg)
+void ObjectReader::putInHand(struct objectIn_t& objectIn, toaster_msgs::Object& object_msg, ListFiller& list)
 {
+  std::string id = object_msg.meEntity.id;
+  std::map<std::string, toaster_msgs::Entity>::iterator itHand = handPoses_.find(id);
+
   if (objectIn.Agent_.find(id) != objectIn.Agent_.end())
   {
+    // Objects in hand are moved on the published message, not in globalLastConfig_
+    Entity object(id);
+    object.setName(object_msg.meEntity.name);
+
     bool addFactHand = true;
-    if (!putAtJointPosition(object, objectIn.Agent_[id], objectIn.Hand_[id],
-                            list_msg.human_msg, false)) // try to put in human, why should we set it as simu ?
-      if (!putAtJointPosition(object, objectIn.Agent_[id], objectIn.Hand_[id],
-                              list_msg.robot_msg, false)) // try to put in robot, why should we set it as simu ?
+    if (!putAtJointPosition(&object, objectIn.Agent_[id], objectIn.Hand_[id],
+                            list.list().human_msg, false)) // try to put in human, why should we set it as simu ?
+      if (!putAtJointPosition(&object, objectIn.Agent_[id], objectIn.Hand_[id],
+                              list.list().robot_msg, false)) // try to put in robot, why should we set it as simu ?
       {
         ROS_INFO("[pdg][put_in_hand] couldn't find joint %s for agent %s \n",
                  objectIn.Hand_[id].c_str(), objectIn.Agent_[id].c_str());
@@ -106,8 +306,20 @@ void ObjectReader::putInHand(struct objectIn_t& objectIn, string id, MovableObje
 
     if (addFactHand)
     {
-      toaster_msgs::Fact fact_msg= DefaultFactMsg(id, object, objectIn);
-      list_msg.fact_msg.factList.push_back(fact_msg);
+      fillEntity(&object, object_msg.meEntity);
+      handPoses_[id] = object_msg.meEntity;
+
+      DefaultFactMsg(list.nextFact(), id, object_msg.meEntity.time, objectIn);
     }
+    else if (itHand != handPoses_.end())
+      object_msg.meEntity = itHand->second;
+  }
+  else if (itHand != handPoses_.end())
+  {
+    // Released objects stay where the hand left them until they are updated
+    if (itHand->second.time >= object_msg.meEntity.time)
+      object_msg.meEntity = itHand->second;
+    else
+      handPoses_.erase(itHand);
   }
 }
@@ -1,4 +1,5 @@
 #include "pdg/readers/Pr2RobotReader.h"
+#include <pluginlib/class_list_macros.h>
 
 Pr2RobotReader::Pr2RobotReader(bool fullRobot)  : RobotReader(){
     fullRobot_ = fullRobot;
@@ -16,7 +17,9 @@ void Pr2RobotReader::init(ros::NodeHandle* node, std::string param) {
   //TODO: setname with id
   curRobot->setName("PR2_ROBOT");
 
+  std::lock_guard<std::mutex> lock(writeMutex_);
   lastConfig_["pr2"] = curRobot;
+  commitSnapshot();
 }
 
 
@@ -46,74 +49,67 @@ void Pr2RobotReader::init(ros::NodeHandle* node, std::string param) {
     pr2JointsName_.push_back("l_gripper_joint");
 }*/
 
-void Pr2RobotReader::updateRobot(tf::TransformListener &listener)
+void Pr2RobotReader::updateRobot(TfSampler &sampler)
 {
   if((fullRobot_ == true) && (activated_ == true))
   {
+    std::lock_guard<std::mutex> lock(writeMutex_);
     Robot* curRobot = lastConfig_["pr2"];
-    Joint* curJoint = new Joint("pr2_base_link", "pr2");
-    curJoint->setName("base_link");
 
     // We start with base:
-    setRobotJointLocation(listener, curJoint);
-
-    curRobot->setOrientation(curJoint->getOrientation());
-    curRobot->setPosition(curJoint->getPosition());
-    curRobot->setTime(curJoint->getTime());
-
-    delete curJoint;
+    bool updated = setRobotJointLocation(sampler, "base_link", curRobot);
 
     //Then other joints if needed
     if (fullRobot_ && initJointsName_) {
         for (unsigned int i = 0; i < pr2JointsName_.size(); i++) {
-            curJoint = curRobot->skeleton_[pr2JointsName_[i]];
+            Joint* curJoint = curRobot->skeleton_[pr2JointsName_[i]];
             curJoint->setName(pr2JointsName_[i]);
-            setRobotJointLocation(listener, curJoint);
+            if (setRobotJointLocation(sampler, pr2JointsName_[i], curJoint))
+                updated = true;
         }
     }
+
+    // Frames not updated since the last publication are not new data
+    if (updated)
+        commitSnapshot();
   }
 }
 
-void Pr2RobotReader::setRobotJointLocation(tf::TransformListener &listener, Joint* joint) {
-    tf::StampedTransform transform;
+bool Pr2RobotReader::setRobotJointLocation(TfSampler &sampler, const std::string& jointName, Entity* entity) {
+    TfSample_t sample;
     std::string jointId = "/";
     std::vector<double> jointOrientation;
     bg::model::point<double, 3, bg::cs::cartesian> jointPosition;
-    jointId.append(joint->getName());
+    jointId.append(jointName);
 
     ROS_DEBUG("current joint %s \n", jointId.c_str());
 
-    try {
-        ros::Time now = ros::Time::now();
-        ros::Time last = ros::Time(0);
-        listener.waitForTransform("/map", jointId,
-                last, ros::Duration(0.0));
-        listener.lookupTransform("/map", jointId,
-                last, transform);
-
-        //Joint position
-        jointPosition.set<0>(transform.getOrigin().x());
-        jointPosition.set<1>(transform.getOrigin().y());
-        jointPosition.set<2>(transform.getOrigin().z());
-
-        //Joint orientation
-        //curRobot->orientation.push_back(tf::getRoll(transform.getRotation()));
-        //curRobot->orientation.push_back(tf::getPitch(transform.getRotation()));
-        jointOrientation.push_back(0.0);
-        jointOrientation.push_back(0.0);
-        jointOrientation.push_back(tf::getYaw(transform.getRotation()));
-
-        joint->setTime(now.toNSec());
-        joint->setPosition(jointPosition);
-        joint->setOrientation(jointOrientation);
-
-    } catch (tf::TransformException ex) {
-        ROS_ERROR("%s", ex.what());
-    }
+    // Frames are resolved by the sampler, a stale frame keeps its last pose and time
+    sampler.addFrame(jointId);
+    if (!sampler.getSample(jointId, sample) || sample.stale || sample.time == entity->getTime())
+        return false;
+
+    //Joint position
+    jointPosition.set<0>(sample.transform.getOrigin().x());
+    jointPosition.set<1>(sample.transform.getOrigin().y());
+    jointPosition.set<2>(sample.transform.getOrigin().z());
+
+    //Joint orientation
+    //curRobot->orientation.push_back(tf::getRoll(transform.getRotation()));
+    //curRobot->orientation.push_back(tf::getPitch(transform.getRotation()));
+    jointOrientation.push_back(0.0);
+    jointOrientation.push_back(0.0);
+    jointOrientation.push_back(tf::getYaw(sample.transform.getRotation()));
+
+    entity->setTime(sample.time);
+    entity->setPosition(jointPosition);
+    entity->setOrientation(jointOrientation);
+    return true;
 }
 
 void Pr2RobotReader::pr2JointStateCallBack(const sensor_msgs::JointState::ConstPtr & msg) 
 {
+    std::lock_guard<std::mutex> lock(writeMutex_);
 	if((fullRobot_ == true) && (activated_ == true))
 	{
 		if (!initJointsName_) 
@@ -142,13 +138,17 @@ void Pr2RobotReader::pr2JointStateCallBack(const sensor_msgs::JointState::ConstP
    
     }
 	}
+    commitSnapshot();
 }
 
 
 //Destructor
 
-Pr2RobotReader::~Pr2RobotReader() {
-    for (std::map<std::string, Robot*>::iterator it = lastConfig_.begin(); it != lastConfig_.end(); ++it) {
-        delete it->second;
-    }
+// Reads stream name from its default inputs
+void Pr2RobotReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/pdg/" + name);
+  setFullConfig("/pdg/fullRobotConfig");
 }
+
+PLUGINLIB_EXPORT_CLASS(Pr2RobotReader, ReaderBase)
@@ -0,0 +1,122 @@
+#include "pdg/readers/ReaderRegistry.h"
+
+// Streams of pdg, named by their activation parameter, and their readers
+static const char* streamTypes_[][2] = {
+  {"groupHuman", "pdg/GroupHumanReader"},
+  {"morseHuman", "pdg/MorseHumanReader"},
+  {"mocapHuman", "pdg/MocapHumanReader"},
+  {"adreamMocapHuman", "pdg/AdreamMocapHumanReader"},
+  {"toasterSimuHuman", "pdg/ToasterSimuHumanReader"},
+  {"pr2Robot", "pdg/Pr2RobotReader"},
+  {"spencerRobot", "pdg/SpencerRobotReader"},
+  {"toasterSimuRobot", "pdg/ToasterSimuRobotReader"},
+  {"arObjectReader", "pdg/ArObjectReader"},
+  {"OM2MObjectReader", "pdg/OM2MObjectReader"},
+  {"gazeboObjectReader", "pdg/GazeboObjectReader"},
+  {"mocapObjectReader", "pdg/MocapObjectsReader"},
+  {"toasterSimuObject", "pdg/ToasterSimuObjectReader"}
+};
+
+static const unsigned int nbStreamTypes_ = sizeof(streamTypes_) / sizeof(streamTypes_[0]);
+
+ReaderRegistry::ReaderRegistry(ros::NodeHandle& node) : node_(node), loader_("pdg", "ReaderBase")
+{
+}
+
+ReaderRegistry::~ReaderRegistry()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!streams_.empty())
+    destroy(streams_.end() - 1);
+}
+
+void ReaderRegistry::load()
+{
+  std::vector<std::string> names;
+  if (node_.getParam("/pdg/readers", names))
+  {
+    for (std::vector<std::string>::iterator it = names.begin(); it != names.end(); ++it)
+      setStream(*it, true);
+  }
+  else
+  {
+    for (unsigned int i = 0; i < nbStreamTypes_; i++)
+    {
+      bool activated = false;
+      node_.getParam(std::string("/pdg/") + streamTypes_[i][0], activated);
+      if (activated)
+        setStream(streamTypes_[i][0], true);
+    }
+  }
+
+  if (streams_.empty())
+    ROS_WARN("[pdg] no stream configured, streams can be added with pdg/manage_stream");
+}
+
+std::string ReaderRegistry::getType(const std::string& name) const
+{
+  std::string type;
+  if (node_.getParam("/pdg/readerTypes/" + name, type))
+    return type;
+
+  for (unsigned int i = 0; i < nbStreamTypes_; i++)
+    if (name == streamTypes_[i][0])
+      return streamTypes_[i][1];
+  return "";
+}
+
+bool ReaderRegistry::setStream(const std::string& name, bool activated)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<Stream_t>::iterator it = streams_.begin();
+  while (it != streams_.end() && it->name != name)
+    ++it;
+
+  if (!activated)
+  {
+    if (it != streams_.end())
+      destroy(it);
+    return true;
+  }
+
+  if (it != streams_.end())
+    return true;
+
+  std::string type = getType(name);
+  if (type == "")
+  {
+    ROS_WARN("[pdg] unknown stream %s, its reader can be given by /pdg/readerTypes/%s", name.c_str(), name.c_str());
+    return false;
+  }
+
+  Stream_t stream;
+  stream.name = name;
+  try
+  {
+    stream.reader = loader_.createInstance(type);
+  }
+  catch (pluginlib::PluginlibException& ex)
+  {
+    ROS_ERROR("[pdg] cannot create the reader %s of stream %s: %s", type.c_str(), name.c_str(), ex.what());
+    return false;
+  }
+
+  // A copy of the node handle keeps the subscriptions of the reader, to shut them down with it
+  stream.node.reset(new ros::NodeHandle(node_));
+  stream.reader->initialize(stream.node.get(), name);
+  stream.reader->setActivation(true);
+  streams_.push_back(stream);
+
+  ROS_INFO("[pdg] stream %s read by %s", name.c_str(), type.c_str());
+  return true;
+}
+
+void ReaderRegistry::destroy(std::vector<Stream_t>::iterator stream)
+{
+  // Waits for the callbacks of the reader in progress, none is called after
+  stream->node->shutdown();
+  stream->reader.reset();
+  ROS_INFO("[pdg] stream %s removed", stream->name.c_str());
+  streams_.erase(stream);
+}
@@ -6,6 +6,7 @@
  */
 
 #include "pdg/readers/SpencerRobotReader.h"
+#include <pluginlib/class_list_macros.h>
 
 SpencerRobotReader::SpencerRobotReader() : RobotReader() {
     fullRobot_ = false;
@@ -19,7 +20,9 @@ void SpencerRobotReader::init(ros::NodeHandle* node, std::string param) {
   //TODO: setname with id
   curRobot->setName("spencer");
   initJointsName();
+  std::lock_guard<std::mutex> lock(writeMutex_);
   lastConfig_["spencer"] = curRobot;
+  commitSnapshot();
 }
 
 // Maybe get this from a config file?
@@ -28,57 +31,56 @@ void SpencerRobotReader::initJointsName() {
     spencerJointsName_.push_back("base_link");
 }
 
-void SpencerRobotReader::updateRobot(tf::TransformListener &listener)
+void SpencerRobotReader::updateRobot(TfSampler &sampler)
 {
   if((fullRobot_ == true) && (activated_ == true))
   {
+    std::lock_guard<std::mutex> lock(writeMutex_);
     Robot* curRobot = lastConfig_["spencer"];
-    Joint* curJoint = new Joint("spencer_base_link", "spencer");
-    curJoint->setName(spencerJointsName_[0]);
 
-    // We start with base:
-    setRobotJointLocation(listener, curJoint);
-
-    curRobot->setOrientation(curJoint->getOrientation());
-    curRobot->setPosition(curJoint->getPosition());
-    curRobot->setTime(curJoint->getTime());
+    // We start with base, not committed again while its frame is not updated
+    if (setRobotJointLocation(sampler, spencerJointsName_[0], curRobot))
+        commitSnapshot();
 
     //printf("spencer robot: %f, %f, %f\n", curRobot->getPosition().get<0>(), curRobot->getPosition().get<1>(), curRobot->getPosition().get<2>());
-
-    delete curJoint;
   }
 }
 
-void SpencerRobotReader::setRobotJointLocation(tf::TransformListener &listener, Joint* joint) {
-    tf::StampedTransform transform;
+bool SpencerRobotReader::setRobotJointLocation(TfSampler &sampler, const std::string& jointName, Entity* entity) {
+    TfSample_t sample;
     std::string jointId = "/";
     std::vector<double> jointOrientation;
     bg::model::point<double, 3, bg::cs::cartesian> jointPosition;
-    jointId.append(joint->getName());
-    try {
-        ros::Time now = ros::Time::now();
-        listener.waitForTransform("/map", jointId,
-                now, ros::Duration(3.0));
-        listener.lookupTransform("/map", jointId,
-                now, transform);
-
-        //Joint position
-        jointPosition.set<0>(transform.getOrigin().x());
-        jointPosition.set<1>(transform.getOrigin().y());
-        jointPosition.set<2>(transform.getOrigin().z());
-
-        //Joint orientation
-        //curRobot->orientation.push_back(tf::getRoll(transform.getRotation()));
-        //curRobot->orientation.push_back(tf::getPitch(transform.getRotation()));
-        jointOrientation.push_back(0.0);
-        jointOrientation.push_back(0.0);
-        jointOrientation.push_back(tf::getYaw(transform.getRotation()));
-
-        joint->setTime(now.toNSec());
-        joint->setPosition(jointPosition);
-        joint->setOrientation(jointOrientation);
-
-    } catch (tf::TransformException ex) {
-        ROS_ERROR("%s", ex.what());
-    }
+    jointId.append(jointName);
+
+    // Frames are resolved by the sampler, a stale frame keeps its last pose and time
+    sampler.addFrame(jointId);
+    if (!sampler.getSample(jointId, sample) || sample.stale || sample.time == entity->getTime())
+        return false;
+
+    //Joint position
+    jointPosition.set<0>(sample.transform.getOrigin().x());
+    jointPosition.set<1>(sample.transform.getOrigin().y());
+    jointPosition.set<2>(sample.transform.getOrigin().z());
+
+    //Joint orientation
+    //curRobot->orientation.push_back(tf::getRoll(transform.getRotation()));
+    //curRobot->orientation.push_back(tf::getPitch(transform.getRotation()));
+    jointOrientation.push_back(0.0);
+    jointOrientation.push_back(0.0);
+    jointOrientation.push_back(tf::getYaw(sample.transform.getRotation()));
+
+    entity->setTime(sample.time);
+    entity->setPosition(jointPosition);
+    entity->setOrientation(jointOrientation);
+    return true;
+}
+
+// Reads stream name from its default inputs
+void SpencerRobotReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/pdg/" + name);
+  setFullConfig("/pdg/fullRobotConfig");
 }
+
+PLUGINLIB_EXPORT_CLASS(SpencerRobotReader, ReaderBase)
@@ -6,11 +6,14 @@
  */
 
 #include "pdg/readers/ToasterSimuHumanReader.h"
+#include <pluginlib/class_list_macros.h>
 #include "tf/transform_datatypes.h"
 
 ToasterSimuHumanReader::ToasterSimuHumanReader(bool fullHuman) : HumanReader()
 {
   fullHuman_ = fullHuman;
+  // toaster_simu humans are always published
+  filterPresence_ = false;
 }
 
 void ToasterSimuHumanReader::init(ros::NodeHandle* node, std::string param)
@@ -22,32 +25,31 @@ void ToasterSimuHumanReader::init(ros::NodeHandle* node, std::string param)
   sub_ = node_->subscribe("/toaster_simu/humanList", 1, &ToasterSimuHumanReader::humanJointStateCallBack, this);
 }
 
-void ToasterSimuHumanReader::Publish(struct toasterList_t& list_msg)
+void ToasterSimuHumanReader::fillSnapshot(ListFiller& list)
 {
   if(activated_)
   {
     for (std::map<std::string, Human*>::iterator it = lastConfig_.begin(); it != lastConfig_.end(); ++it) {
         //Human
-        toaster_msgs::Human human_msg;
-        fillEntity(it->second, human_msg.meAgent.meEntity);
-
-        human_msg.meAgent.skeletonJoint.clear();
-        human_msg.meAgent.skeletonNames.clear();
-
-        for (std::map<std::string, Joint*>::iterator itJoint = lastConfig_[it->first]->skeleton_.begin(); itJoint != lastConfig_[it->first]->skeleton_.end(); ++itJoint) {
-            toaster_msgs::Joint joint_msg;
-            human_msg.meAgent.skeletonNames.push_back(itJoint->first);
-            fillEntity((itJoint->second), joint_msg.meEntity);
+        toaster_msgs::Human& human_msg = list.nextHuman();
+        human_msg.age = 0;
+        resetAgent(human_msg.meAgent, it->second->skeleton_.size());
+        orientations_.fillEntity(it->second, human_msg.meAgent.meEntity);
+
+        unsigned int i = 0;
+        for (std::map<std::string, Joint*>::iterator itJoint = it->second->skeleton_.begin(); itJoint != it->second->skeleton_.end(); ++itJoint, ++i) {
+            toaster_msgs::Joint& joint_msg = human_msg.meAgent.skeletonJoint[i];
+            human_msg.meAgent.skeletonNames[i] = itJoint->first;
+            orientations_.fillEntity((itJoint->second), joint_msg.meEntity);
             joint_msg.jointOwner = it->first;
-
-            human_msg.meAgent.skeletonJoint.push_back(joint_msg);
+            joint_msg.position = 0.0;
         }
-        list_msg.human_msg.humanList.push_back(human_msg);
     }
   }
 }
 
 void ToasterSimuHumanReader::humanJointStateCallBack(const toaster_msgs::HumanListStamped::ConstPtr& msg) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
     //std::cout << "[area_manager][DEBUG] new data for human received with time " << msg->humanList[0].meAgent.meEntity.time  << std::endl;
     Human * curHuman;
     double roll, pitch, yaw;
@@ -132,4 +134,14 @@ void ToasterSimuHumanReader::humanJointStateCallBack(const toaster_msgs::HumanLi
             }
         }
     }
+    commitSnapshot();
 }
+
+// Reads stream name from its default inputs
+void ToasterSimuHumanReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/pdg/" + name);
+  setFullConfig("/pdg/fullHumanConfig");
+}
+
+PLUGINLIB_EXPORT_CLASS(ToasterSimuHumanReader, ReaderBase)
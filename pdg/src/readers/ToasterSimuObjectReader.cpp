@@ -6,6 +6,7 @@
  */
 
 #include "pdg/readers/ToasterSimuObjectReader.h"
+#include <pluginlib/class_list_macros.h>
 #include "tf/transform_datatypes.h"
 
 ToasterSimuObjectReader::ToasterSimuObjectReader() : ObjectReader() {
@@ -25,12 +26,12 @@ void ToasterSimuObjectReader::objectStateCallBack(const toaster_msgs::ObjectList
     //std::cout << "[area_manager][DEBUG] new data for object received" << std::endl;
   if(activated_)
   {
+    std::lock_guard<std::mutex> lock(lastConfigMutex_);
     MovableObject* curObject;
     double roll, pitch, yaw;
     for (unsigned int i = 0; i < msg->objectList.size(); i++) {
 
         // If this object is not assigned we have to allocate data.
-        lastConfigMutex_.lock();
         if (globalLastConfig_.find(msg->objectList[i].meEntity.id) == globalLastConfig_.end()) {
             curObject = new MovableObject(msg->objectList[i].meEntity.id);
             curObject->setRoomId(0);
@@ -38,7 +39,6 @@ void ToasterSimuObjectReader::objectStateCallBack(const toaster_msgs::ObjectList
             increaseNbObjects();
         } else
             curObject = globalLastConfig_[msg->objectList[i].meEntity.id];
-        lastConfigMutex_.unlock();
 
         std::vector<double> objOrientation;
         bg::model::point<double, 3, bg::cs::cartesian> objPosition;
@@ -63,12 +63,19 @@ void ToasterSimuObjectReader::objectStateCallBack(const toaster_msgs::ObjectList
         objOrientation.push_back(yaw);
         curObject->setOrientation(objOrientation);
 
-        lastConfigMutex_.lock();
         if (globalLastConfig_[msg->objectList[i].meEntity.id] == NULL)
             globalLastConfig_[curObject->getId()] = curObject;
-        lastConfigMutex_.unlock();
         if (lastConfig_[msg->objectList[i].meEntity.id] == NULL)
             lastConfig_[curObject->getId()] = curObject;
     }
+    commitObjects();
   }
 }
+
+// Reads stream name from its default inputs
+void ToasterSimuObjectReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/pdg/" + name);
+}
+
+PLUGINLIB_EXPORT_CLASS(ToasterSimuObjectReader, ReaderBase)
@@ -6,6 +6,7 @@
  */
 
 #include "pdg/readers/ToasterSimuRobotReader.h"
+#include <pluginlib/class_list_macros.h>
 #include "tf/transform_datatypes.h"
 
 ToasterSimuRobotReader::ToasterSimuRobotReader(bool fullRobot) : RobotReader()
@@ -22,6 +23,7 @@ void ToasterSimuRobotReader::init(ros::NodeHandle* node, std::string param) {
 }
 
 void ToasterSimuRobotReader::robotJointStateCallBack(const toaster_msgs::RobotListStamped::ConstPtr& msg) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
     //std::cout << "[area_manager][DEBUG] new data for robot received" << std::endl;
 
     Robot* curRobot;
@@ -104,4 +106,14 @@ void ToasterSimuRobotReader::robotJointStateCallBack(const toaster_msgs::RobotLi
             }
         }
     }
+    commitSnapshot();
 }
+
+// Reads stream name from its default inputs
+void ToasterSimuRobotReader::initialize(ros::NodeHandle* node, const std::string& name)
+{
+  init(node, "/pdg/" + name);
+  setFullConfig("/pdg/fullRobotConfig");
+}
+
+PLUGINLIB_EXPORT_CLASS(ToasterSimuRobotReader, ReaderBase)
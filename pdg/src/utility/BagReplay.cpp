@@ -0,0 +1,62 @@
+#include "pdg/utility/BagReplay.h"
+
+#include <algorithm>
+
+#include <topic_tools/shape_shifter.h>
+
+bool BagReplay::open(ros::NodeHandle& node, const std::string& path, const std::vector<std::string>& topics)
+{
+  node_ = &node;
+
+  try
+  {
+    bag_.open(path, rosbag::bagmode::Read);
+  }
+  catch (rosbag::BagException& ex)
+  {
+    ROS_ERROR("[pdg] cannot open bag %s: %s", path.c_str(), ex.what());
+    return false;
+  }
+
+  if (!topics.empty())
+    view_.reset(new rosbag::View(bag_, rosbag::TopicQuery(topics)));
+  else
+  {
+    // pdg outputs recorded with the inputs are not replayed, nor the clock and the logs:
+    // the replay sets the time itself
+    std::vector<std::string> inputs;
+    rosbag::View all(bag_);
+    std::vector<const rosbag::ConnectionInfo*> connections = all.getConnections();
+    for (std::vector<const rosbag::ConnectionInfo*>::iterator it = connections.begin(); it != connections.end(); ++it)
+      if ((*it)->topic.compare(0, 5, "/pdg/") != 0 &&
+          (*it)->topic != "/clock" && (*it)->topic != "/rosout" && (*it)->topic != "/rosout_agg" &&
+          std::find(inputs.begin(), inputs.end(), (*it)->topic) == inputs.end())
+        inputs.push_back((*it)->topic);
+    view_.reset(new rosbag::View(bag_, rosbag::TopicQuery(inputs)));
+  }
+
+  next_ = view_->begin();
+  ROS_INFO("[pdg] replaying %u messages of %s, %f s", view_->size(), path.c_str(),
+           (view_->getEndTime() - view_->getBeginTime()).toSec());
+  return true;
+}
+
+void BagReplay::replayUntil(const ros::Time& time, ros::CallbackQueue* queue)
+{
+  for (; view_ && next_ != view_->end() && next_->getTime() <= time; ++next_)
+  {
+    topic_tools::ShapeShifter::ConstPtr msg = next_->instantiate<topic_tools::ShapeShifter>();
+    if (!msg)
+      continue;
+
+    std::map<std::string, ros::Publisher>::iterator itPub = publishers_.find(next_->getTopic());
+    if (itPub == publishers_.end())
+      itPub = publishers_.insert(std::make_pair(next_->getTopic(), msg->advertise(*node_, next_->getTopic(), 1000))).first;
+
+    // Subscribers of the process get the message in their queue at once, the readers receive it at its recording time
+    ros::Time::setNow(next_->getTime());
+    itPub->second.publish(msg);
+    queue->callAvailable();
+    nbMessages_++;
+  }
+}
@@ -0,0 +1,241 @@
+#include "pdg/utility/EntityFusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+static toaster_msgs::Entity& entityOf(toaster_msgs::Human& human) { return human.meAgent.meEntity; }
+static toaster_msgs::Entity& entityOf(toaster_msgs::Robot& robot) { return robot.meAgent.meEntity; }
+
+// Moves the joints with the base, the skeleton keeps its shape
+static void moveJoints(toaster_msgs::Agent& agent, double dx, double dy, double dz)
+{
+  for (std::vector<toaster_msgs::Joint>::iterator it = agent.skeletonJoint.begin(); it != agent.skeletonJoint.end(); ++it)
+  {
+    it->meEntity.pose.position.x += dx;
+    it->meEntity.pose.position.y += dy;
+    it->meEntity.pose.position.z += dz;
+  }
+}
+
+static void moveJoints(toaster_msgs::Human& human, double dx, double dy, double dz) { moveJoints(human.meAgent, dx, dy, dz); }
+static void moveJoints(toaster_msgs::Robot& robot, double dx, double dy, double dz) { moveJoints(robot.meAgent, dx, dy, dz); }
+
+static double distance(const toaster_msgs::Entity& a, const toaster_msgs::Entity& b)
+{
+  double dx = a.pose.position.x - b.pose.position.x;
+  double dy = a.pose.position.y - b.pose.position.y;
+  double dz = a.pose.position.z - b.pose.position.z;
+  return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+void EntityFusion::addSource(unsigned int first, unsigned int end, double sigma)
+{
+  if (first >= end)
+    return;
+
+  Source_t source;
+  source.first = first;
+  source.end = end;
+  source.sigma = sigma;
+  sources_.push_back(source);
+}
+
+void EntityFusion::fuse(std::vector<toaster_msgs::Human>& list, std::vector<toaster_msgs::Fact>& facts) { fuseList(list, facts); }
+void EntityFusion::fuse(std::vector<toaster_msgs::Robot>& list, std::vector<toaster_msgs::Fact>& facts) { fuseList(list, facts); }
+
+template <typename M>
+void EntityFusion::fuseList(std::vector<M>& list, std::vector<toaster_msgs::Fact>& facts)
+{
+  cluster_.assign(list.size(), -1);
+  source_.assign(list.size(), -1);
+  anchors_.clear();
+  keptIds_.clear();
+  order_.clear();
+
+  for (unsigned int s = 0; s < sources_.size(); s++)
+    for (unsigned int i = std::min(sources_[s].first, (unsigned int)list.size()); i < std::min(sources_[s].end, (unsigned int)list.size()); i++)
+    {
+      source_[i] = s;
+      order_.push_back(i);
+    }
+
+  // Clusters are centred on their freshest entity, the most precise one if several are as fresh
+  std::stable_sort(order_.begin(), order_.end(), [this, &list](unsigned int a, unsigned int b)
+  {
+    uint64_t timeA = entityOf(list[a]).time, timeB = entityOf(list[b]).time;
+    return timeA > timeB || (timeA == timeB && sources_[source_[a]].sigma < sources_[source_[b]].sigma);
+  });
+
+  for (std::vector<unsigned int>::iterator itOrder = order_.begin(); itOrder != order_.end(); ++itOrder)
+  {
+    unsigned int i = *itOrder;
+    if (cluster_[i] != -1)
+      continue;
+
+    int cluster = anchors_.size();
+    cluster_[i] = cluster;
+    members_.assign(1, i);
+    const toaster_msgs::Entity& freshest = entityOf(list[i]);
+
+    // At most one entity of each other stream: the one with the same id, or else the closest in the gate
+    for (unsigned int s = 0; s < sources_.size(); s++)
+    {
+      if ((int)s == source_[i])
+        continue;
+
+      int associated = -1;
+      double closest = gate_;
+      for (unsigned int j = std::min(sources_[s].first, (unsigned int)list.size()); j < std::min(sources_[s].end, (unsigned int)list.size()); j++)
+      {
+        if (cluster_[j] != -1)
+          continue;
+
+        const toaster_msgs::Entity& entity = entityOf(list[j]);
+        if (entity.id == freshest.id)
+        {
+          associated = j;
+          break;
+        }
+
+        double dist = distance(freshest, entity);
+        if (gate_ > 0.0 && dist < closest)
+        {
+          associated = j;
+          closest = dist;
+        }
+      }
+
+      if (associated == -1)
+        continue;
+
+      cluster_[associated] = cluster;
+      members_.push_back(associated);
+    }
+
+    // Entities of the streams which stopped are fused out without moving the others,
+    // the entity of the most precise stream among the fresh ones is kept
+    unsigned int kept = i;
+    positions_.clear();
+    for (std::vector<unsigned int>::iterator itMember = members_.begin(); itMember != members_.end(); ++itMember)
+    {
+      const toaster_msgs::Entity& entity = entityOf(list[*itMember]);
+      if (window_ > 0 && (uint64_t)entity.time + window_ < (uint64_t)freshest.time)
+        continue;
+
+      Position_t position;
+      position.x = entity.pose.position.x;
+      position.y = entity.pose.position.y;
+      position.z = entity.pose.position.z;
+      position.sigma = sources_[source_[*itMember]].sigma;
+      positions_.push_back(position);
+      if (position.sigma < sources_[source_[kept]].sigma)
+        kept = *itMember;
+    }
+    anchors_.push_back(kept);
+
+    // Fused ids are not published anymore, unless they are kept in another cluster
+    for (std::vector<unsigned int>::iterator itMember = members_.begin(); itMember != members_.end(); ++itMember)
+      if (*itMember != kept && keptIds_.find(entityOf(list[*itMember]).id) == keptIds_.end())
+        keptIds_[entityOf(list[*itMember]).id] = -1.0;
+
+    uint64_t time = freshest.time;
+    Position_t fused;
+    combine(positions_, 0, gate_, fused);
+    toaster_msgs::Entity& anchor = entityOf(list[kept]);
+    moveJoints(list[kept], fused.x - anchor.pose.position.x, fused.y - anchor.pose.position.y, fused.z - anchor.pose.position.z);
+    anchor.pose.position.x = fused.x;
+    anchor.pose.position.y = fused.y;
+    anchor.pose.position.z = fused.z;
+    anchor.time = time;
+    keptIds_[anchor.id] = confidence(fused.sigma);
+  }
+
+  // Removes the entities fused in an anchor
+  typename std::vector<M>::iterator itKept = list.begin();
+  for (unsigned int i = 0; i < list.size(); i++)
+  {
+    if (cluster_[i] != -1 && anchors_[cluster_[i]] != i)
+      continue;
+
+    if (itKept != list.begin() + i)
+      std::swap(*itKept, list[i]);
+    ++itKept;
+  }
+  list.erase(itKept, list.end());
+
+  fuseFacts(facts);
+}
+
+void EntityFusion::fuseFacts(std::vector<toaster_msgs::Fact>& facts)
+{
+  factIds_.clear();
+
+  std::vector<toaster_msgs::Fact>::iterator itKept = facts.begin();
+  for (std::vector<toaster_msgs::Fact>::iterator it = facts.begin(); it != facts.end(); ++it)
+  {
+    if (it->property == "isPresent")
+    {
+      std::map<std::string, double>::iterator itId = keptIds_.find(it->subjectId);
+      if (itId != keptIds_.end())
+      {
+        // Fused id, or absent for a stream while another one sees it
+        if (itId->second < 0.0 || it->stringValue != "true")
+          continue;
+
+        // Same id seen by several streams
+        bool& seen = factIds_[it->subjectId];
+        if (seen)
+          continue;
+
+        seen = true;
+        it->confidence = itId->second;
+      }
+    }
+
+    if (itKept != it)
+      std::swap(*itKept, *it);
+    ++itKept;
+  }
+  facts.erase(itKept, facts.end());
+}
+
+unsigned int EntityFusion::combine(const std::vector<Position_t>& positions, double gate, Position_t& fused)
+{
+  unsigned int anchor = 0;
+  for (unsigned int i = 1; i < positions.size(); i++)
+    if (positions[i].sigma < positions[anchor].sigma)
+      anchor = i;
+
+  combine(positions, anchor, gate, fused);
+  return anchor;
+}
+
+void EntityFusion::combine(const std::vector<Position_t>& positions, unsigned int anchor, double gate, Position_t& fused)
+{
+  double sumWeights = 0.0;
+  double x = 0.0, y = 0.0, z = 0.0;
+  for (unsigned int i = 0; i < positions.size(); i++)
+  {
+    double dx = positions[i].x - positions[anchor].x;
+    double dy = positions[i].y - positions[anchor].y;
+    double dz = positions[i].z - positions[anchor].z;
+    if (gate > 0.0 && sqrt(dx * dx + dy * dy + dz * dz) >= gate)
+      continue;
+
+    double weight = 1.0 / std::max(positions[i].sigma * positions[i].sigma, 1e-12);
+    sumWeights += weight;
+    x += weight * positions[i].x;
+    y += weight * positions[i].y;
+    z += weight * positions[i].z;
+  }
+
+  fused.x = x / sumWeights;
+  fused.y = y / sumWeights;
+  fused.z = z / sumWeights;
+  fused.sigma = 1.0 / sqrt(sumWeights);
+}
+
+double EntityFusion::confidence(double sigma)
+{
+  return exp(-std::max(sigma, 0.0));
+}
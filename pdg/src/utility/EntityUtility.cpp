@@ -3,6 +3,8 @@
 //tf
 #include <tf/transform_broadcaster.h>
 
+#include <limits>
+
 ros::ServiceClient* setPoseClient_;
 
 void EntityUtility_setClient(ros::ServiceClient* m_setPoseClient)
@@ -31,6 +33,88 @@ void fillEntity(Entity* srcEntity, toaster_msgs::Entity& msgEntity) {
     msgEntity.pose.orientation.w = q[3];
 }
 
+void OrientationCache::fillEntity(Entity* srcEntity, toaster_msgs::Entity& msgEntity) {
+    msgEntity.id = srcEntity->getId();
+    msgEntity.time = srcEntity->getTime();
+    msgEntity.name = srcEntity->getName();
+    msgEntity.pose.position.x = srcEntity->position_.get<0>();
+    msgEntity.pose.position.y = srcEntity->position_.get<1>();
+    msgEntity.pose.position.z = srcEntity->position_.get<2>();
+    msgEntity.inArea.clear();
+
+    // Members rather than getters, which return copies
+    const std::vector<double>& orientation = srcEntity->orientation_;
+    if (next_ == slots_.size()) {
+        Slot_t slot;
+        // NaN never matches, the first orientation is always converted
+        slot.roll = slot.pitch = slot.yaw = std::numeric_limits<double>::quiet_NaN();
+        slots_.push_back(slot);
+    }
+
+    Slot_t& slot = slots_[next_++];
+    if (orientation[0] != slot.roll || orientation[1] != slot.pitch || orientation[2] != slot.yaw) {
+        tf::Quaternion q;
+        q.setRPY(orientation[0], orientation[1], orientation[2]);
+
+        slot.roll = orientation[0];
+        slot.pitch = orientation[1];
+        slot.yaw = orientation[2];
+        slot.quaternion.x = q[0];
+        slot.quaternion.y = q[1];
+        slot.quaternion.z = q[2];
+        slot.quaternion.w = q[3];
+    }
+
+    msgEntity.pose.orientation = slot.quaternion;
+}
+
+void resetFact(toaster_msgs::Fact& msgFact) {
+    // Strings keep their memory when cleared
+    msgFact.property.clear();
+    msgFact.propertyType.clear();
+    msgFact.subProperty.clear();
+    msgFact.subjectId.clear();
+    msgFact.targetId.clear();
+    msgFact.subjectOwnerId.clear();
+    msgFact.targetOwnerId.clear();
+    msgFact.valueType = 0;
+    msgFact.factObservability = 0.0;
+    msgFact.doubleValue = 0.0;
+    msgFact.stringValue.clear();
+    msgFact.confidence = 0.0;
+    msgFact.time = 0;
+    msgFact.timeStart = 0;
+    msgFact.timeEnd = 0;
+}
+
+void fillPresenceFact(toaster_msgs::Fact& msgFact, const std::string& id, uint64_t time, bool present) {
+    resetFact(msgFact);
+
+    msgFact.property = "isPresent";
+    msgFact.subjectId = id;
+    msgFact.stringValue = present ? "true" : "false";
+    msgFact.confidence = 0.90;
+    msgFact.factObservability = 1.0;
+    msgFact.time = time;
+    msgFact.valueType = 0;
+}
+
+void resetObject(toaster_msgs::Object& msgObject) {
+    msgObject.supportFurniture = 0;
+    msgObject.container = 0;
+    msgObject.containedObjects.clear();
+    msgObject.aboveObjects.clear();
+    msgObject.closeObjects.clear();
+}
+
+void resetAgent(toaster_msgs::Agent& msgAgent, unsigned int nbJoints) {
+    msgAgent.mobility = 0;
+    msgAgent.busyHands.clear();
+    msgAgent.hasObjects.clear();
+    msgAgent.skeletonNames.resize(nbJoints);
+    msgAgent.skeletonJoint.resize(nbJoints);
+}
+
 void updateEntity(Entity& newPoseEnt, Entity* storedEntity) {
     //ROS_INFO("UPDATE entity");
     storedEntity->position_ = newPoseEnt.getPosition();
@@ -0,0 +1,89 @@
+#include "pdg/utility/LatencyHistogram.h"
+
+#include <sstream>
+
+const double LatencyHistogram::BIN_LIMITS[LatencyHistogram::NB_BINS - 1] = {1.0, 2.0, 5.0, 10.0, 20.0, 50.0, 100.0, 200.0, 500.0};
+
+static diagnostic_msgs::KeyValue keyValue(const std::string& key, double value)
+{
+  diagnostic_msgs::KeyValue keyValue;
+  std::stringstream ss;
+  ss << value;
+  keyValue.key = key;
+  keyValue.value = ss.str();
+  return keyValue;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+void LatencyHistogram::add(double latency)
+{
+  double ms = latency * 1000.0;
+  unsigned int bin = 0;
+  while (bin < NB_BINS - 1 && ms > BIN_LIMITS[bin])
+    bin++;
+
+  counts_[bin]++;
+  nb_++;
+  sum_ += ms;
+  if (ms > max_)
+    max_ = ms;
+}
+
+void LatencyHistogram::reset()
+{
+  for (unsigned int bin = 0; bin < NB_BINS; bin++)
+    counts_[bin] = 0;
+  nb_ = 0;
+  sum_ = 0.0;
+  max_ = 0.0;
+}
+
+double LatencyHistogram::getPercentile(double ratio) const
+{
+  unsigned long nb = 0;
+  for (unsigned int bin = 0; bin < NB_BINS - 1; bin++)
+  {
+    nb += counts_[bin];
+    if (nb >= ratio * nb_)
+      return BIN_LIMITS[bin];
+  }
+  return max_;
+}
+
+void LatencyHistogram::fillStatus(const std::string& name, diagnostic_msgs::DiagnosticStatus& status) const
+{
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "pdg: " + name;
+  status.hardware_id = "pdg";
+  status.values.clear();
+
+  if (nb_ == 0)
+  {
+    status.message = "no data";
+    return;
+  }
+
+  std::stringstream ss;
+  ss << "mean " << sum_ / nb_ << " ms, max " << max_ << " ms";
+  status.message = ss.str();
+
+  status.values.push_back(keyValue("count", nb_));
+  status.values.push_back(keyValue("mean_ms", sum_ / nb_));
+  status.values.push_back(keyValue("max_ms", max_));
+  status.values.push_back(keyValue("p50_ms", getPercentile(0.5)));
+  status.values.push_back(keyValue("p95_ms", getPercentile(0.95)));
+
+  for (unsigned int bin = 0; bin < NB_BINS; bin++)
+  {
+    std::stringstream key;
+    if (bin < NB_BINS - 1)
+      key << "under_" << BIN_LIMITS[bin] << "_ms";
+    else
+      key << "over_" << BIN_LIMITS[NB_BINS - 2] << "_ms";
+    status.values.push_back(keyValue(key.str(), counts_[bin]));
+  }
+}
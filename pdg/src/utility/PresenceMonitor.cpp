@@ -0,0 +1,80 @@
+#include "pdg/utility/PresenceMonitor.h"
+
+void PresenceMonitor::setTimeout(double timeout)
+{
+  if (timeout > 0.0)
+    timeout_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout));
+  else
+    timeout_ = Clock::duration::zero();
+}
+
+bool PresenceMonitor::touch(const std::string& id, uint64_t time, Clock::time_point now)
+{
+  std::map<std::string, Presence_t>::iterator it = entities_.find(id);
+  if (it == entities_.end())
+  {
+    Presence_t presence;
+    presence.time = time;
+    presence.present = false;
+    it = entities_.insert(std::make_pair(id, presence)).first;
+  }
+  else if (it->second.time == time)
+  {
+    it->second.touched = true;
+    return it->second.present;
+  }
+
+  it->second.time = time;
+  if (timeout_ > Clock::duration::zero())
+  {
+    it->second.deadline = now + timeout_;
+    deadlines_.push(Deadline_t(it->second.deadline, id));
+  }
+  else
+    it->second.deadline = Clock::time_point::max();
+
+  it->second.present = true;
+  it->second.touched = true;
+  return true;
+}
+
+void PresenceMonitor::expire(Clock::time_point now, std::vector<std::string>& expired)
+{
+  while (!deadlines_.empty() && deadlines_.top().first <= now)
+  {
+    // Deadlines replaced by a later update are skipped
+    std::map<std::string, Presence_t>::iterator it = entities_.find(deadlines_.top().second);
+    if (it != entities_.end() && it->second.present && it->second.deadline == deadlines_.top().first)
+    {
+      it->second.present = false;
+      expired.push_back(it->first);
+    }
+    deadlines_.pop();
+  }
+}
+
+void PresenceMonitor::prune()
+{
+  for (std::map<std::string, Presence_t>::iterator it = entities_.begin(); it != entities_.end(); )
+  {
+    if (!it->second.touched && (!it->second.present || timeout_ == Clock::duration::zero()))
+      it = entities_.erase(it);
+    else
+    {
+      it->second.touched = false;
+      ++it;
+    }
+  }
+}
+
+bool PresenceMonitor::isPresent(const std::string& id) const
+{
+  std::map<std::string, Presence_t>::const_iterator it = entities_.find(id);
+  return it != entities_.end() && it->second.present;
+}
+
+uint64_t PresenceMonitor::getTime(const std::string& id) const
+{
+  std::map<std::string, Presence_t>::const_iterator it = entities_.find(id);
+  return it != entities_.end() ? it->second.time : 0;
+}
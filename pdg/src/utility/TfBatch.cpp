@@ -0,0 +1,119 @@
+#include "pdg/utility/TfBatch.h"
+
+// Number of batches after which the frame ids of an entity not added anymore are dropped
+#define TFBATCH_FRAME_LIFETIME 300
+
+void TfBatch::begin(const ros::Time& stamp)
+{
+  size_ = 0;
+  stamp_ = stamp;
+
+  if (++batch_ % TFBATCH_FRAME_LIFETIME != 0)
+    return;
+
+  prune(entityFrames_);
+  prune(agentFrames_);
+  for (std::map<std::string, Frames_t>::iterator it = jointFrames_.begin(); it != jointFrames_.end(); )
+  {
+    prune(it->second);
+    if (it->second.empty())
+      it = jointFrames_.erase(it);
+    else
+      ++it;
+  }
+}
+
+void TfBatch::prune(Frames_t& frames)
+{
+  for (Frames_t::iterator it = frames.begin(); it != frames.end(); )
+  {
+    if (batch_ - it->second.batch >= TFBATCH_FRAME_LIFETIME)
+      it = frames.erase(it);
+    else
+      ++it;
+  }
+}
+
+const std::string& TfBatch::getFrame(Frames_t& frames, const std::string& key, const std::string& prefix, const std::string& suffix)
+{
+  Frames_t::iterator it = frames.find(key);
+  if (it == frames.end())
+  {
+    Frame_t frame;
+    frame.id = prefix + key + suffix;
+    it = frames.insert(std::make_pair(key, frame)).first;
+  }
+
+  it->second.batch = batch_;
+  return it->second.id;
+}
+
+void TfBatch::add(const std::string& frame, const geometry_msgs::Pose& pose)
+{
+  if (size_ == transforms_.size())
+  {
+    if (spare_.empty())
+    {
+      transforms_.push_back(geometry_msgs::TransformStamped());
+      transforms_.back().header.frame_id = "map";
+    }
+    else
+    {
+      transforms_.push_back(std::move(spare_.back()));
+      spare_.pop_back();
+    }
+  }
+
+  // Assignments reuse the memory of the transform of the previous loop
+  geometry_msgs::TransformStamped& transform = transforms_[size_++];
+  transform.header.stamp = stamp_;
+  transform.child_frame_id = frame;
+  transform.transform.translation.x = pose.position.x;
+  transform.transform.translation.y = pose.position.y;
+  transform.transform.translation.z = pose.position.z;
+  transform.transform.rotation = pose.orientation;
+}
+
+void TfBatch::addEntity(const toaster_msgs::Entity& entity)
+{
+  add(getFrame(entityFrames_, entity.id, "/", ""), entity.pose);
+}
+
+void TfBatch::addAgent(const toaster_msgs::Agent& agent, bool withJoints)
+{
+  const std::string& id = agent.meEntity.id;
+  add(getFrame(agentFrames_, id, "", "/base"), agent.meEntity.pose);
+
+  if (!withJoints || agent.skeletonJoint.empty())
+    return;
+
+  Frames_t& joints = jointFrames_[id];
+  for (std::vector<toaster_msgs::Joint>::const_iterator itJoint = agent.skeletonJoint.begin();
+       itJoint != agent.skeletonJoint.end(); ++itJoint)
+  {
+    Frames_t::iterator itFrame = joints.find(itJoint->meEntity.id);
+    if (itFrame == joints.end())
+    {
+      Frame_t frame;
+      frame.id = "/" + id + "/" + itJoint->meEntity.id;
+      itFrame = joints.insert(std::make_pair(itJoint->meEntity.id, frame)).first;
+    }
+
+    itFrame->second.batch = batch_;
+    add(itFrame->second.id, itJoint->meEntity.pose);
+  }
+}
+
+void TfBatch::send(tf::TransformBroadcaster& tf_br)
+{
+  if (size_ == 0)
+    return;
+
+  // The broadcaster takes a whole vector: transforms of a larger batch are set aside, not destroyed
+  while (transforms_.size() > size_)
+  {
+    spare_.push_back(std::move(transforms_.back()));
+    transforms_.pop_back();
+  }
+  tf_br.sendTransform(transforms_);
+}
@@ -0,0 +1,128 @@
+#include "pdg/utility/TfSampler.h"
+
+#include <vector>
+
+TfSampler::TfSampler(ros::NodeHandle& node, double rate, double staleTimeout, bool spinThread, const std::string& fixedFrame)
+  : listener_(node, ros::Duration(tf::Transformer::DEFAULT_CACHE_TIME), spinThread),
+    fixedFrame_(fixedFrame), period_(1.0 / rate), staleTimeout_(staleTimeout), running_(false)
+{
+}
+
+TfSampler::~TfSampler()
+{
+  stop();
+}
+
+void TfSampler::start()
+{
+  if (running_)
+    return;
+  running_ = true;
+  thread_ = boost::thread(&TfSampler::run, this);
+}
+
+void TfSampler::stop()
+{
+  if (!running_)
+    return;
+  thread_.interrupt();
+  thread_.join();
+  running_ = false;
+}
+
+void TfSampler::addFrame(const std::string& frame)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  frames_.insert(frame);
+}
+
+bool TfSampler::getSample(const std::string& frame, TfSample_t& sample) const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  std::map<std::string, TfSample_t>::const_iterator it = samples_.find(frame);
+  if (it == samples_.end())
+    return false;
+
+  sample = it->second;
+  return true;
+}
+
+void TfSampler::run()
+{
+  try
+  {
+    while (ros::ok())
+    {
+      ros::WallTime start = ros::WallTime::now();
+      sample();
+
+      // Interruption point, so that stop() does not wait for the next sampling
+      ros::WallDuration left = ros::WallDuration(period_.toSec()) - (ros::WallTime::now() - start);
+      boost::this_thread::sleep(boost::posix_time::microseconds(left > ros::WallDuration(0.0) ? left.toNSec() / 1000 : 0));
+    }
+  }
+  catch (boost::thread_interrupted&)
+  {
+  }
+}
+
+void TfSampler::sample()
+{
+  std::vector<std::string> frames;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    frames.assign(frames_.begin(), frames_.end());
+  }
+
+  // Lookups of the latest transforms never wait, frames not available are kept stale
+  ros::Time now = ros::Time::now();
+  std::map<std::string, tf::StampedTransform> resolved;
+  for (std::vector<std::string>::iterator it = frames.begin(); it != frames.end(); ++it)
+  {
+    if (!listener_.canTransform(fixedFrame_, *it, ros::Time(0)))
+      continue;
+
+    try
+    {
+      listener_.lookupTransform(fixedFrame_, *it, ros::Time(0), resolved[*it]);
+    }
+    catch (tf::TransformException& ex)
+    {
+      ROS_DEBUG("[pdg] %s", ex.what());
+      resolved.erase(*it);
+    }
+  }
+
+  // All samples are replaced at once
+  boost::mutex::scoped_lock lock(mutex_);
+  for (std::vector<std::string>::iterator it = frames.begin(); it != frames.end(); ++it)
+  {
+    std::map<std::string, tf::StampedTransform>::iterator itResolved = resolved.find(*it);
+    std::map<std::string, TfSample_t>::iterator itSample = samples_.find(*it);
+
+    if (itResolved == resolved.end())
+    {
+      if (itSample != samples_.end() && !itSample->second.stale)
+      {
+        itSample->second.stale = true;
+        ROS_WARN("[pdg] frame %s is not available, keeping its last pose", it->c_str());
+      }
+      continue;
+    }
+
+    TfSample_t& sample = samples_[*it];
+    const tf::StampedTransform& transform = itResolved->second;
+
+    // Static transforms have no stamp, they are never stale
+    bool isStatic = transform.stamp_.isZero();
+    bool stale = !isStatic && now - transform.stamp_ > staleTimeout_;
+    if (stale && itSample != samples_.end() && !itSample->second.stale)
+      ROS_WARN("[pdg] frame %s is older than %f s", it->c_str(), staleTimeout_.toSec());
+
+    // The time of a new pose is its stamp, a stale pose keeps its time
+    if (itSample == samples_.end() || transform.stamp_ != sample.transform.stamp_ || isStatic)
+      sample.time = isStatic ? now.toNSec() : transform.stamp_.toNSec();
+    sample.transform = transform;
+    sample.stale = stale;
+  }
+}
@@ -0,0 +1,28 @@
+#include "pdg/utility/UpdateSignal.h"
+
+std::mutex UpdateSignal::mutex_;
+std::condition_variable UpdateSignal::condition_;
+bool UpdateSignal::pending_ = false;
+
+void UpdateSignal::notify()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_)
+      return;
+    pending_ = true;
+  }
+  condition_.notify_one();
+}
+
+bool UpdateSignal::waitUntil(const std::chrono::steady_clock::time_point& deadline)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  return condition_.wait_until(lock, deadline, [] { return pending_; });
+}
+
+void UpdateSignal::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_ = false;
+}
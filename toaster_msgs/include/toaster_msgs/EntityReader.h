@@ -9,6 +9,9 @@
 #define	ENTITYREADER_H
 
 #include <ros/ros.h>
+#include <chrono>
+#include <map>
+#include <string>
 
 template <typename T>
 class EntityReader {
@@ -18,28 +21,48 @@ public:
     EntityReader(bool fullConfig) {fullConfig_ = fullConfig; }
     ~EntityReader() {}
 
-    bool isPresent(std::string id);
+    // True if the time of entity id changed less than timeout s ago, on the steady clock
+    bool isPresent(const std::string& id, double timeout = 1.0) const;
 
-    void clear() { lastConfig_.clear(); }
+    void clear() { lastConfig_.clear(); arrivals_.clear(); }
 
     ros::Subscriber sub_;
     bool fullConfig_;
+
+protected:
+    // Called by the callbacks for each entity received at now, before its time is set
+    void touch(const std::string& id, unsigned long time, std::chrono::steady_clock::time_point now);
+
+private:
+    struct Arrival_t {
+        unsigned long time;
+        std::chrono::steady_clock::time_point arrival; // of the last time change
+    };
+
+    std::map<std::string, Arrival_t> arrivals_;
 };
 
 template <typename T>
-bool EntityReader<T>::isPresent(std::string id) {
-    timeval curTime;
-    gettimeofday(&curTime, NULL);
-    unsigned long now = curTime.tv_sec * pow(10, 9) + curTime.tv_usec;
-    unsigned long timeThreshold = pow(10, 9);
-    //std::cout << "current time: " << now <<  "  human time: " << m_LastTime << std::endl;
-    long timeDif = lastConfig_[id]->getTime() - now;
-    //std::cout << "time dif: " << timeDif << std::endl;
-
-    if (fabs(timeDif) < timeThreshold)
-        return true;
-    else
+bool EntityReader<T>::isPresent(const std::string& id, double timeout) const {
+    typename std::map<std::string, Arrival_t>::const_iterator it = arrivals_.find(id);
+    if (it == arrivals_.end())
         return false;
+
+    return std::chrono::steady_clock::now() - it->second.arrival < std::chrono::duration<double>(timeout);
+}
+
+template <typename T>
+void EntityReader<T>::touch(const std::string& id, unsigned long time, std::chrono::steady_clock::time_point now) {
+    typename std::map<std::string, Arrival_t>::iterator it = arrivals_.find(id);
+    if (it == arrivals_.end()) {
+        Arrival_t arrival;
+        arrival.time = time;
+        arrival.arrival = now;
+        arrivals_[id] = arrival;
+    } else if (it->second.time != time) {
+        it->second.time = time;
+        it->second.arrival = now;
+    }
 }
 
 #endif	/* ENTITYREADER_H */
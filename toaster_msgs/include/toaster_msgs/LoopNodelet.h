@@ -0,0 +1,46 @@
+/*
+ * File:   LoopNodelet.h
+ *
+ * Nodelet running the loop of a toaster node, Run(node, privateNode), in its own thread.
+ * Nodes of the same manager exchange their lists by pointer, without serialization.
+ * The loop calls the callbacks of node's queue as the standalone node does with the
+ * global one: each nodelet has its own queue so that its callbacks keep running in its loop.
+ * Packages using it depend on nodelet and pluginlib.
+ */
+
+#ifndef LOOPNODELET_H
+#define	LOOPNODELET_H
+
+#include <nodelet/nodelet.h>
+#include <ros/callback_queue.h>
+#include <boost/thread/thread.hpp>
+
+template <int (*Run)(ros::NodeHandle&, ros::NodeHandle&)>
+class LoopNodelet : public nodelet::Nodelet {
+public:
+    virtual ~LoopNodelet() {
+        // node.ok() turns false, the loop returns at its next iteration
+        node_.shutdown();
+        privateNode_.shutdown();
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+private:
+    virtual void onInit() {
+        node_ = getNodeHandle();
+        node_.setCallbackQueue(&queue_);
+        privateNode_ = getPrivateNodeHandle();
+        privateNode_.setCallbackQueue(&queue_);
+
+        thread_ = boost::thread(Run, boost::ref(node_), boost::ref(privateNode_));
+    }
+
+    // Declared first, destroyed after the node handles using it
+    ros::CallbackQueue queue_;
+    ros::NodeHandle node_;
+    ros::NodeHandle privateNode_;
+    boost::thread thread_;
+};
+
+#endif /* LOOPNODELET_H */
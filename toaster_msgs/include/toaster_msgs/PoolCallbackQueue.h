@@ -0,0 +1,68 @@
+/*
+ * File:   PoolCallbackQueue.h
+ *
+ * Callback queue whose callbacks are called by the workers of a ThreadPool.
+ * Each callback added posts a job to the pool, so callbacks are called as soon
+ * as a worker is idle, without threads of their own.
+ * The pool should have at least one worker thread and outlive the queue.
+ */
+
+#ifndef POOLCALLBACKQUEUE_H
+#define	POOLCALLBACKQUEUE_H
+
+#include <ros/callback_queue.h>
+#include <condition_variable>
+#include <mutex>
+
+#include "toaster_msgs/ThreadPool.h"
+
+class PoolCallbackQueue : public ros::CallbackQueueInterface {
+public:
+    explicit PoolCallbackQueue(ThreadPool& pool) : pool_(pool), nbJobs_(0) {
+    }
+
+    // Waits for the jobs posted, which find the queue disabled
+    virtual ~PoolCallbackQueue() {
+        queue_.disable();
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (nbJobs_ != 0)
+            idle_.wait(lock);
+    }
+
+    virtual void addCallback(const ros::CallbackInterfacePtr& callback, uint64_t owner_id = 0) {
+        queue_.addCallback(callback, owner_id);
+        post();
+    }
+
+    // Also waits for the callbacks of owner_id in progress
+    virtual void removeByID(uint64_t owner_id) {
+        queue_.removeByID(owner_id);
+    }
+
+private:
+    void post() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            nbJobs_++;
+        }
+        pool_.post(std::bind(&PoolCallbackQueue::callOne, this));
+    }
+
+    void callOne() {
+        // Callbacks asking to be called again are added back to queue_
+        if (queue_.callOne() == ros::CallbackQueue::TryAgain)
+            post();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--nbJobs_ == 0)
+            idle_.notify_all();
+    }
+
+    ThreadPool& pool_;
+    ros::CallbackQueue queue_;
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    unsigned int nbJobs_;
+};
+
+#endif	/* POOLCALLBACKQUEUE_H */
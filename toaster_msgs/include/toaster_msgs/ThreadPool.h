@@ -0,0 +1,138 @@
+/*
+ * File:   ThreadPool.h
+ *
+ * Fixed size pool of worker threads shared by the toaster nodes.
+ * run() hands out task indexes to the workers and to the calling thread,
+ * and returns once every task is done. Workers are kept alive between
+ * calls so that a loop iteration does not pay for thread creation.
+ * post() queues jobs that idle workers run in the background, tasks of
+ * run() being handed out first.
+ */
+
+#ifndef THREADPOOL_H
+#define	THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    typedef std::function<void(unsigned int) > Task_t;
+    typedef std::function<void() > Job_t;
+
+    // nbThreads counts the calling thread: a pool of 1 runs everything inline.
+    explicit ThreadPool(unsigned int nbThreads) : task_(NULL), nbTasks_(0), nextTask_(0), pendingTasks_(0), stop_(false) {
+        for (unsigned int i = 1; i < nbThreads; ++i)
+            workers_.push_back(std::thread(&ThreadPool::workerLoop, this));
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wakeUp_.notify_all();
+        for (unsigned int i = 0; i < workers_.size(); ++i)
+            workers_[i].join();
+    }
+
+    unsigned int size() const {
+        return workers_.size() + 1;
+    }
+
+    // Calls task(i) for i in [0, nbTasks) and blocks until all calls returned.
+    // Not reentrant: only one thread may call run() at a time.
+    void run(unsigned int nbTasks, const Task_t& task) {
+        if (workers_.empty() || nbTasks < 2) {
+            for (unsigned int i = 0; i < nbTasks; ++i)
+                task(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = &task;
+            nbTasks_ = nbTasks;
+            nextTask_ = 0;
+            pendingTasks_ = nbTasks;
+        }
+        wakeUp_.notify_all();
+
+        runTasks();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (pendingTasks_ != 0)
+            done_.wait(lock);
+        task_ = NULL;
+    }
+
+    // Queues job for the first idle worker and returns.
+    // Without worker thread, jobs are never run. Jobs still queued when the pool is destroyed are dropped.
+    void post(const Job_t& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(job);
+        }
+        wakeUp_.notify_one();
+    }
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void runTasks() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (hasTask()) {
+            unsigned int index = nextTask_++;
+            const Task_t* task = task_;
+            lock.unlock();
+            (*task)(index);
+            lock.lock();
+            if (--pendingTasks_ == 0)
+                done_.notify_all();
+        }
+    }
+
+    bool hasTask() const {
+        return task_ != NULL && nextTask_ < nbTasks_;
+    }
+
+    void workerLoop() {
+        while (true) {
+            Job_t job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                while (!stop_ && !hasTask() && jobs_.empty())
+                    wakeUp_.wait(lock);
+                if (stop_)
+                    return;
+                if (!hasTask()) {
+                    job = jobs_.front();
+                    jobs_.pop_front();
+                }
+            }
+            if (job)
+                job();
+            else
+                runTasks();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    std::condition_variable done_;
+
+    const Task_t* task_;
+    unsigned int nbTasks_;
+    unsigned int nextTask_;
+    unsigned int pendingTasks_;
+    std::deque<Job_t> jobs_;
+    bool stop_;
+};
+
+#endif	/* THREADPOOL_H */
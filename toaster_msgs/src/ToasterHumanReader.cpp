@@ -19,7 +19,10 @@ void ToasterHumanReader::humanJointStateCallBack(const toaster_msgs::HumanListSt
     double roll, pitch, yaw;
     Human * curHuman;
 
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
     for (unsigned int i = 0; i < msg->humanList.size(); i++) {
+        touch(msg->humanList[i].meAgent.meEntity.id, msg->humanList[i].meAgent.meEntity.time, now);
 
         // If this human is not assigned we have to allocate data.
         if (lastConfig_.find(msg->humanList[i].meAgent.meEntity.id) == lastConfig_.end()) {
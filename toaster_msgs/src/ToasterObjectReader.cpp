@@ -19,7 +19,10 @@ void ToasterObjectReader::objectStateCallBack(const toaster_msgs::ObjectListStam
     Object* curObject;
     double roll, pitch, yaw;
 
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
     for (unsigned int i = 0; i < msg->objectList.size(); i++) {
+        touch(msg->objectList[i].meEntity.id, msg->objectList[i].meEntity.time, now);
 
         // If this object is not assigned we have to allocate data.
         if (lastConfig_.find(msg->objectList[i].meEntity.id) == lastConfig_.end()) {
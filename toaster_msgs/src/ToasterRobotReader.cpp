@@ -19,7 +19,10 @@ void ToasterRobotReader::robotJointStateCallBack(const toaster_msgs::RobotListSt
     double roll, pitch, yaw;
     Robot* curRobot;
 
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
     for (unsigned int i = 0; i < msg->robotList.size(); i++) {
+        touch(msg->robotList[i].meAgent.meEntity.id, msg->robotList[i].meAgent.meEntity.time, now);
 
         // If this robot is not assigned we have to allocate data.
         if (lastConfig_.find(msg->robotList[i].meAgent.meEntity.id) == lastConfig_.end()) {
@@ -0,0 +1,16 @@
+#include "ros/ros.h"
+
+#ifndef VISUALIZERNODE_H
+#define VISUALIZERNODE_H
+
+namespace toaster_visualizer
+{
+
+// Loop of toaster_visualizer, run by the toaster_visualizer executable and by the
+// toaster_visualizer/VisualizerNodelet nodelet. Publishes the markers until node is shut down,
+// callbacks run on the queue of node.
+int run(ros::NodeHandle& node, ros::NodeHandle& privateNode);
+
+}
+
+#endif /* VISUALIZERNODE_H */
@@ -0,0 +1,12 @@
+#include "VisualizerNode.h"
+
+/**
+ * Main function using class run
+ */
+int main(int argc, char **argv) {
+    ros::init(argc, argv, "Run");
+    ros::NodeHandle node;
+    ros::NodeHandle privateNode("~");
+
+    return toaster_visualizer::run(node, privateNode);
+}
@@ -0,0 +1,13 @@
+#include <pluginlib/class_list_macros.h>
+#include <toaster_msgs/LoopNodelet.h>
+
+#include "VisualizerNode.h"
+
+namespace toaster_visualizer
+{
+
+typedef LoopNodelet<&run> VisualizerNodelet;
+
+}
+
+PLUGINLIB_EXPORT_CLASS(toaster_visualizer::VisualizerNodelet, nodelet::Nodelet)
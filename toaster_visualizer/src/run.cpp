@@ -24,9 +24,13 @@
 #include "markerCreator.h"
 
 #include "visualizer.h"
+#include "VisualizerNode.h"
 
 #include <tinyxml.h>
 #include <tf/transform_listener.h>
+#include <ros/callback_queue.h>
+
+namespace toaster_visualizer {
 
 //nameMarker rpoportionnal scale
 
@@ -529,27 +533,30 @@ public:
         pub_human.publish(human_list);
         pub_robot.publish(robot_list);
         pub_movingTwrd.publish(arrow_list);
-
-        ros::spinOnce();
     }
 };
 
 /**
- * Main function using class run
+ * Loop using class run
  */
-int main(int argc, char **argv) {
-    ros::init(argc, argv, "Run");
-    ros::NodeHandle node;
+int run(ros::NodeHandle& node, ros::NodeHandle& privateNode) {
     ROS_INFO("[toaster-visu] launched");
 
-    Run c = Run(node);
+    // Callbacks are bound to c, it is not copied
+    Run c(node);
 
     ros::Rate loop_rate(30);
 
-    while (ros::ok()) {
+    // Global queue for the executable, queue of the nodelet otherwise
+    ros::CallbackQueue* queue = static_cast<ros::CallbackQueue*>(node.getCallbackQueue());
+
+    while (node.ok()) {
         c.send();
+        queue->callAvailable();
         loop_rate.sleep();
     }
 
     return 0;
 }
+
+} // namespace toaster_visualizer